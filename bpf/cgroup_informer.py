@@ -31,12 +31,30 @@ parser.add_argument(
 parser.add_argument(
     "-H", "--header", action="store_true", help="print table header at start"
 )
+parser.add_argument(
+    "-C",
+    "--cgroup",
+    type=str,
+    help="only report forks in a comma separated list of cgroup v2 directories, including the cgroups below them (default: all)",
+)
 parser.add_argument(
     "--evbufmain",
     type=int,
     help="page count for main event buffer (default: 8)",
     default=8,
 )
+parser.add_argument(
+    "--wakeupfill",
+    type=int,
+    help="percentage of the main event buffer that has to be filled before the consumer is woken up, 0 to wake it up for every event (default: 25)",
+    default=25,
+)
+parser.add_argument(
+    "--wakeuptime",
+    type=int,
+    help="milliseconds after which the consumer is woken up regardless of --wakeupfill (default: 10)",
+    default=10,
+)
 parser.add_argument(
     "--perfbuf",
     action="store_true",
@@ -65,7 +83,20 @@ if args.perfbuf:
         "ringbuf_output\(([^,]+),([^,]+),[^;]+", r"perf_submit(ctx, \1, \2)", bpf_text
     )
 
+bpf_text = bpf_text.replace("FILTER_BY_CGROUP", "1" if args.cgroup is not None else "0")
+bpf_text = bpf_text.replace(
+    "CGROUP_FILTER_SIZE",
+    str(len(args.cgroup.split(","))) if args.cgroup is not None else "1",
+)
+bpf_text = bpf_text.replace("TRACK_EXITS", "0")  # only cgroup-informer-core keeps track of the exits
 bpf_text = bpf_text.replace("RB_PAGES_EVENT_MAIN", str(args.evbufmain))
+bpf_text = bpf_text.replace(
+    "RB_WAKEUP_BYTES",
+    "0"
+    if args.perfbuf
+    else str(args.evbufmain * os.sysconf("SC_PAGE_SIZE") * args.wakeupfill // 100),
+)
+bpf_text = bpf_text.replace("RB_WAKEUP_NS", str(args.wakeuptime * 1000000))
 
 if args.printonly:
     print(bpf_text)
@@ -77,6 +108,10 @@ b = BPF(text=bpf_text)
 if args.compileonly:
     exit(0)
 
+if args.cgroup is not None:
+    for i, cgroup in enumerate(args.cgroup.split(",")):
+        b["log_cgroups"][i] = cgroup
+
 SizeTimeSec = 20  # maybe a '-' followed by up to 19 digits, a '.' and 3 digits
 SizeTimeNsec = 3  # 3 digits
 SizeTime = (
@@ -124,6 +159,10 @@ if args.header:
 
 while True:
     try:
-        b.perf_buffer_poll(100) if args.perfbuf else b.ring_buffer_poll(100)
+        if args.perfbuf:
+            b.perf_buffer_poll(100)
+        else:
+            b.ring_buffer_poll(100)
+            b.ring_buffer_consume()  # records submitted without wakeup
     except KeyboardInterrupt:
         exit()
@@ -0,0 +1,121 @@
+// CO-RE version of testdir/cgroup_informer.cpp, loaded by native/cgroup-informer-core through its libbpf skeleton.
+#include "vmlinux.h"
+
+#include <bpf/bpf_helpers.h>
+
+#define CGROUP_FILTER_MAX 64
+
+const volatile u32 cgroup_filter_size = 0; // 0: report the forks in all cgroups
+const volatile u64 rb_wakeup_bytes = 8192; // 0 to wake up the consumer for every record
+const volatile u64 rb_wakeup_ns = 10000000;
+const volatile bool track_exits = false;
+
+enum event_type_t
+{
+    TYPE_FORK = 'F',
+    TYPE_EXIT = 'E'
+};
+
+struct event_main_t
+{
+    u64 time;
+    u32 ppid; // 0 for exits
+    u32 pid;
+    u64 cgroupid;
+    u8 type;
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_RINGBUF);
+    __uint(max_entries, 8 * 4096); // set to --evbufmain pages before loading
+} event_main SEC(".maps");
+
+// cgroup v2 directories to report the forks in, including all cgroups below them
+struct
+{
+    __uint(type, BPF_MAP_TYPE_CGROUP_ARRAY);
+    __uint(max_entries, 1); // set to cgroup_filter_size before loading
+    __type(key, u32);
+    __type(value, u32);
+} log_cgroups SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} last_wakeup SEC(".maps");
+
+// the child is in the cgroup of the parent, which is the current task
+static bool CheckToLog()
+{
+    if (cgroup_filter_size == 0)
+        return true;
+
+    #pragma unroll
+    for (int i = 0; i < CGROUP_FILTER_MAX; i++)
+    {
+        if (i >= cgroup_filter_size)
+            break;
+        if (bpf_current_task_under_cgroup(&log_cgroups, i) == 1)
+            return true;
+    }
+    return false;
+}
+
+// same as in fileaccess.bpf.c
+static u64 WakeupFlags(u32 size)
+{
+    if (rb_wakeup_bytes == 0)
+        return 0;
+
+    int zero = 0;
+    u64 now = bpf_ktime_get_ns();
+    u64* last = bpf_map_lookup_elem(&last_wakeup, &zero);
+
+    if (last == NULL) // will not fail, BPF wants the check though
+        return 0;
+
+    if (bpf_ringbuf_query(&event_main, BPF_RB_AVAIL_DATA) + size >= rb_wakeup_bytes || now - *last >= rb_wakeup_ns)
+    {
+        *last = now;
+        return BPF_RB_FORCE_WAKEUP;
+    }
+    return BPF_RB_NO_WAKEUP;
+}
+
+SEC("tp/sched/sched_process_fork")
+int tracepoint_sched_process_fork(struct trace_event_raw_sched_process_fork *args)
+{
+    if (!CheckToLog())
+        return 0;
+
+    struct event_main_t event = {};
+    event.time = bpf_ktime_get_ns();
+    event.ppid = args->parent_pid;
+    event.pid = args->child_pid;
+    event.cgroupid = bpf_get_current_cgroup_id();
+    event.type = TYPE_FORK;
+    bpf_ringbuf_output(&event_main, &event, sizeof(event), WakeupFlags(sizeof(event)));
+    return 0;
+}
+
+// called for every thread like the fork tracepoint, the exiting task is the current one
+SEC("tp/sched/sched_process_exit")
+int tracepoint_sched_process_exit(struct trace_event_raw_sched_process_template *args)
+{
+    if (!track_exits || !CheckToLog())
+        return 0;
+
+    struct event_main_t event = {};
+    event.time = bpf_ktime_get_ns();
+    event.pid = args->pid;
+    event.cgroupid = bpf_get_current_cgroup_id();
+    event.type = TYPE_EXIT;
+    bpf_ringbuf_output(&event_main, &event, sizeof(event), WakeupFlags(sizeof(event)));
+    return 0;
+}
+
+char LICENSE[] SEC("license") = "GPL";
@@ -0,0 +1,1299 @@
+// CO-RE version of testdir/bpf.cpp, compiled once with clang and loaded by native/fileaccess-core through its libbpf skeleton.
+// Keep the maps and records in sync with testdir/bpf.cpp, the consumers are shared.
+// The compile time switches of the BCC version are read-only globals here, set before loading. The verifier treats them as
+// constants and drops the disabled code. Buffer sizes have compile time maximums, map sizes are set before loading.
+#include "vmlinux.h"
+
+#include <bpf/bpf_core_read.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+
+#define PATH_DEPTH_MAX 32
+#define FILENAME_BUFSIZE_MAX 256
+#define PATH_BUFSIZE_MAX 16384 // power of two
+#define PATH_FILTER_BYTES 256 // data of LPM trie keys is limited to 256 bytes, so are the prefixes
+#define CGROUP_FILTER_MAX 64
+#define AGGREGATE_BUCKETS 8 // requested sizes < 16, < 256, ..., < 16^7, >= 16^7 bytes
+
+#define IS_ERR_VALUE(x) ((unsigned long)(void *)(x) >= (unsigned long)-4095)
+#define S_IFMT 00170000
+#define S_IFDIR 0040000
+#define READ 0
+#define WRITE 1
+
+// options, see the macros of testdir/bpf.cpp
+const volatile bool filter_by_pid = false;
+const volatile bool include_child_processes = false;
+const volatile bool filter_by_uid = false;
+const volatile bool filter_by_gid = false;
+const volatile bool filter_by_path = false;
+const volatile u32 cgroup_filter_size = 0; // 0: no cgroup filter
+const volatile bool log_deletes = true;
+const volatile bool log_reads = true;
+const volatile bool log_writes = true;
+const volatile bool aggregate_readwrites = false;
+const volatile bool submit_readwrites = true;
+const volatile bool track_page_cache = false;
+const volatile u32 path_depth = 10; // <= PATH_DEPTH_MAX
+const volatile u32 filename_bufsize = 64; // <= FILENAME_BUFSIZE_MAX
+const volatile u32 path_bufsize = 2048; // power of two >= 3 * path_depth * filename_bufsize, <= PATH_BUFSIZE_MAX
+const volatile bool path_cache_enabled = true;
+const volatile u64 rb_wakeup_bytes = 8192; // 0 to wake up the consumer for every record
+const volatile u64 rb_wakeup_ns = 10000000;
+
+extern int LINUX_KERNEL_VERSION __kconfig;
+
+// from fs/internal.h
+struct open_flags
+{
+    int open_flag;
+    umode_t mode;
+    int acc_mode;
+    int intent;
+    int lookup_flags;
+};
+
+// other layouts of kernel structs, resolved by CO-RE
+struct file_ref___new
+{
+    atomic_long_t refcnt;
+} __attribute__((preserve_access_index));
+
+struct file___new // 6.13+, the reference count is 0 for one reference
+{
+    struct file_ref___new f_ref;
+} __attribute__((preserve_access_index));
+
+struct file___old
+{
+    atomic_long_t f_count;
+} __attribute__((preserve_access_index));
+
+struct renamedata___new // 5.12+
+{
+    struct dentry *old_dentry;
+    struct dentry *new_dentry;
+} __attribute__((preserve_access_index));
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 10240);
+    __type(key, pid_t);
+    __type(value, u8);
+} log_pids SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 10240);
+    __type(key, u32);
+    __type(value, u8);
+} log_uids SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 10240);
+    __type(key, u32);
+    __type(value, u8);
+} log_gids SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_CGROUP_ARRAY);
+    __uint(max_entries, 1); // set to cgroup_filter_size before loading
+    __type(key, u32);
+    __type(value, u32);
+} log_cgroups SEC(".maps");
+
+struct path_filter_key_t
+{
+    u32 prefixlen; // bits
+    char data[PATH_FILTER_BYTES];
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LPM_TRIE);
+    __uint(max_entries, 256);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+    __type(key, struct path_filter_key_t);
+    __type(value, u8);
+} log_paths SEC(".maps");
+
+struct path_filter_scratch_t
+{
+    u32 prefixlen;
+    char data[PATH_FILTER_BYTES + FILENAME_BUFSIZE_MAX];
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, struct path_filter_scratch_t);
+} path_filter_scratch SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} global_handle_uid SEC(".maps");
+
+// LRU maps like in testdir/bpf.cpp, their sizes are set before loading
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 65536);
+    __type(key, struct file*);
+    __type(value, u64);
+} opened SEC(".maps");
+
+struct saved_inode_t
+{
+    u64 inode_uid;
+    u32 opened_handles;
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} global_inode_uid SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 65536);
+    __type(key, unsigned long);
+    __type(value, struct saved_inode_t);
+} inodes SEC(".maps");
+
+enum map_index_t
+{
+    MAP_OPENED = 0,
+    MAP_INODES = 1,
+    MAP_SAVE = 2,
+    MAP_SAVE_DELETE = 3,
+    MAP_AGGREGATES = 4,
+    MAP_BLOCK_REQUESTS = 5
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 12);
+    __type(key, int);
+    __type(value, u64);
+} map_stats SEC(".maps");
+
+enum event_type_t
+{
+    TYPE_OPEN = 'O',
+    TYPE_CLOSE = 'C',
+    TYPE_READ = 'R',
+    TYPE_WRITE = 'W',
+    TYPE_DELETE = 'U',
+    TYPE_READ_AGGREGATE = 'r',
+    TYPE_WRITE_AGGREGATE = 'w',
+    TYPE_BLOCK = 'B'
+};
+
+struct event_main_t
+{
+    u64 time_start;
+    u64 time_end;
+    u32 pid;
+    u64 utime_start;
+    u64 utime_end;
+    u64 stime_start;
+    u64 stime_end;
+    u64 inode_uid;
+    u8 type;
+    s64 result;
+    u64 handle_uid;
+    u64 offset;
+    u64 size;
+    u64 flags;
+};
+
+struct event_read_t
+{
+    struct event_main_t event;
+    u64 cache_hits;
+    u64 cache_misses;
+};
+
+struct event_path_t
+{
+    struct event_main_t event;
+    u64 path_id;
+    u16 path_length[3];
+    u16 path_reference;
+    char data[PATH_BUFSIZE_MAX + FILENAME_BUFSIZE_MAX];
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, struct event_path_t);
+} path_scratch SEC(".maps");
+
+struct path_key_t
+{
+    struct dentry* dentry;
+    struct vfsmount* mnt;
+};
+
+struct path_cache_t
+{
+    u64 path_id;
+    u64 epoch;
+    struct dentry* parent;
+    u64 name_hash_len;
+    unsigned long ino;
+    u32 generation;
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 16384); // set to --pathcache before loading
+    __type(key, struct path_key_t);
+    __type(value, struct path_cache_t);
+} path_cache SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} global_path_id SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} path_epoch SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 1024);
+    __type(key, u64);
+    __type(value, u8);
+} renaming_directory SEC(".maps"); // threads in a vfs_rename of a directory
+
+enum path_cache_stat_t
+{
+    PATH_CACHE_HITS = 0,
+    PATH_CACHE_MISSES = 1
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 2);
+    __type(key, int);
+    __type(value, u64);
+} path_cache_stats SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_RINGBUF);
+    __uint(max_entries, 8 * 4096); // set to --evbufmain pages before loading
+} event_main SEC(".maps");
+
+enum lost_index_t
+{
+    LOST_EVENT_MAIN = 0
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} lost_events SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, int);
+    __type(value, u64);
+} last_wakeup SEC(".maps");
+
+struct io_aggregate_t
+{
+    u64 time_first;
+    u64 time_last;
+    u64 ops;
+    u64 errors;
+    u64 bytes;
+    u64 offset_start;
+    u64 offset_end;
+    u64 busy;
+    u64 utime;
+    u64 stime;
+    u32 histogram[AGGREGATE_BUCKETS];
+    u64 cache_hits;
+    u64 cache_misses;
+};
+
+struct handle_aggregate_t
+{
+    struct io_aggregate_t io[2]; // reads, writes
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 65536);
+    __type(key, u64);
+    __type(value, struct handle_aggregate_t);
+} aggregates SEC(".maps");
+
+struct event_aggregate_t
+{
+    struct event_main_t event;
+    u64 offset_end;
+    u64 busy;
+    u64 errors;
+    u32 histogram[AGGREGATE_BUCKETS];
+    u64 cache_hits;
+    u64 cache_misses;
+};
+
+struct save_t
+{
+    union
+    {
+        struct file* open_fp; // unused, keeps the union layout of the BCC version
+        struct dentry* dentry; // unlink
+        struct
+        { // close
+            unsigned long inode; // if -1, handle is not actually freed as there are other references to it
+            bool unlinked_inode;
+        };
+    };
+
+    struct file *fp;
+    struct event_main_t event;
+    u32 cache_accessed;
+    u32 cache_added;
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 10240);
+    __type(key, u64);
+    __type(value, struct save_t);
+} save SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 10240);
+    __type(key, u64);
+    __type(value, unsigned long);
+} save_delete SEC(".maps");
+
+static void Increment(void* map, int index)
+{
+    u64* value = bpf_map_lookup_elem(map, &index);
+    if (value != NULL)
+        __sync_fetch_and_add(value, 1);
+}
+
+static void CountInsert(int map, long res)
+{
+    if (res == 0)
+        Increment(&map_stats, 2 * map);
+}
+
+static void CountDelete(int map, long res)
+{
+    if (res == 0)
+        Increment(&map_stats, 2 * map + 1);
+}
+
+static u64 WakeupFlags(u32 size)
+{
+    if (rb_wakeup_bytes == 0)
+        return 0;
+
+    int zero = 0;
+    u64 now = bpf_ktime_get_ns();
+    u64* last = bpf_map_lookup_elem(&last_wakeup, &zero);
+
+    if (last == NULL) // will not fail, BPF wants the check though
+        return 0;
+
+    if (bpf_ringbuf_query(&event_main, BPF_RB_AVAIL_DATA) + size >= rb_wakeup_bytes || now - *last >= rb_wakeup_ns)
+    {
+        *last = now;
+        return BPF_RB_FORCE_WAKEUP;
+    }
+    return BPF_RB_NO_WAKEUP;
+}
+
+static void Submit(void* data, u32 size)
+{
+    if (bpf_ringbuf_output(&event_main, data, size, WakeupFlags(size)) != 0)
+        Increment(&lost_events, LOST_EVENT_MAIN);
+}
+
+static long FileCount(struct file* file)
+{
+    if (bpf_core_field_exists(((struct file___new*)file)->f_ref))
+        return BPF_CORE_READ((struct file___new*)file, f_ref.refcnt.counter) + 1;
+    return BPF_CORE_READ((struct file___old*)file, f_count.counter);
+}
+
+static void PrepareMainEvent(struct event_main_t* event)
+{
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
+
+    event->time_start = bpf_ktime_get_ns();
+    event->pid = bpf_get_current_pid_tgid() >> 32;
+    event->utime_start = BPF_CORE_READ(task, utime);
+    event->stime_start = BPF_CORE_READ(task, stime);
+}
+
+static void SetEventFileStuff(struct event_main_t* event, struct file* file)
+{
+    int zero = 0;
+    unsigned long inode = BPF_CORE_READ(file, f_inode, i_ino);
+    struct saved_inode_t* saved_inode = bpf_map_lookup_elem(&inodes, &inode);
+
+    if (saved_inode == NULL)
+    {
+        struct saved_inode_t new_saved_inode = {};
+        u64* p_global_inode_uid = bpf_map_lookup_elem(&global_inode_uid, &zero);
+        if (p_global_inode_uid != NULL) // will not fail, BPF wants the check though
+            event->inode_uid = new_saved_inode.inode_uid = ++(*p_global_inode_uid);
+        new_saved_inode.opened_handles = 1; // new inode also means new handle
+        CountInsert(MAP_INODES, bpf_map_update_elem(&inodes, &inode, &new_saved_inode, BPF_NOEXIST));
+    }
+    else
+        event->inode_uid = saved_inode->inode_uid;
+
+    u64* saved_handle = bpf_map_lookup_elem(&opened, &file);
+    if (saved_handle == NULL)
+    { // new handle, generate a new uid, check inode
+        u64 new_saved_handle = 0;
+
+        u64* p_global_handle_uid = bpf_map_lookup_elem(&global_handle_uid, &zero);
+        if (p_global_handle_uid != NULL) // will not fail, BPF wants the check though
+            event->handle_uid = new_saved_handle = ++(*p_global_handle_uid);
+
+        CountInsert(MAP_OPENED, bpf_map_update_elem(&opened, &file, &new_saved_handle, BPF_NOEXIST));
+
+        if (saved_inode != NULL)
+            saved_inode->opened_handles++;
+    }
+    else // handle known, just take saved information
+        event->handle_uid = *saved_handle;
+
+    event->offset = BPF_CORE_READ(file, f_pos);
+    event->flags = BPF_CORE_READ(file, f_flags);
+}
+
+static void FinalizeMainEvent(struct event_main_t* event)
+{
+    struct task_struct *task = (struct task_struct *)bpf_get_current_task();
+
+    event->time_end = bpf_ktime_get_ns();
+    event->utime_end = BPF_CORE_READ(task, utime);
+    event->stime_end = BPF_CORE_READ(task, stime);
+}
+
+static void FinalizeAndSubmitMainEvent(struct event_main_t* event)
+{
+    FinalizeMainEvent(event);
+    Submit(event, sizeof(*event));
+}
+
+static void AggregateReadWrite(struct event_main_t* event, u64 cache_hits, u64 cache_misses)
+{
+    struct handle_aggregate_t* aggregate = bpf_map_lookup_elem(&aggregates, &event->handle_uid);
+
+    if (aggregate == NULL)
+    {
+        struct handle_aggregate_t empty = {};
+        CountInsert(MAP_AGGREGATES, bpf_map_update_elem(&aggregates, &event->handle_uid, &empty, BPF_NOEXIST)); // fails if another cpu was faster, which is fine
+        aggregate = bpf_map_lookup_elem(&aggregates, &event->handle_uid);
+        if (aggregate == NULL) // map full
+            return;
+    }
+
+    struct io_aggregate_t* io = &aggregate->io[0];
+    if (event->type == TYPE_WRITE)
+        io = &aggregate->io[1];
+
+    u32 bucket = 0;
+    #pragma unroll
+    for (int i = 1; i < AGGREGATE_BUCKETS; i++)
+    {
+        if (event->size >= (1ULL << (4 * i)))
+            bucket = i;
+    }
+
+    __sync_fetch_and_add(&io->ops, 1);
+    if (event->result < 0)
+        __sync_fetch_and_add(&io->errors, 1);
+    else
+        __sync_fetch_and_add(&io->bytes, event->result);
+    __sync_fetch_and_add(&io->busy, event->time_end - event->time_start);
+    __sync_fetch_and_add(&io->utime, event->utime_end - event->utime_start);
+    __sync_fetch_and_add(&io->stime, event->stime_end - event->stime_start);
+    __sync_fetch_and_add(&io->histogram[bucket & (AGGREGATE_BUCKETS - 1)], 1);
+    if (track_page_cache)
+    {
+        __sync_fetch_and_add(&io->cache_hits, cache_hits);
+        __sync_fetch_and_add(&io->cache_misses, cache_misses);
+    }
+
+    // not atomic, concurrent operations on the same handle may rarely widen the ranges less than they should
+    u64 end = event->offset + (event->result > 0 ? event->result : 0);
+    if (io->time_first == 0 || event->offset < io->offset_start)
+        io->offset_start = event->offset;
+    if (end > io->offset_end)
+        io->offset_end = end;
+    if (io->time_first == 0)
+        io->time_first = event->time_start;
+    io->time_last = event->time_end;
+}
+
+static void SubmitAggregates(struct event_main_t* close)
+{
+    struct handle_aggregate_t* aggregate = bpf_map_lookup_elem(&aggregates, &close->handle_uid);
+
+    if (aggregate == NULL)
+        return;
+
+    struct event_aggregate_t record = {};
+    record.event = *close; // pid, inode, handle and flags
+
+    #pragma unroll
+    for (int i = 0; i < 2; i++)
+    {
+        struct io_aggregate_t* io = &aggregate->io[i];
+        if (io->ops == 0)
+            continue;
+
+        record.event.type = (i == 0) ? TYPE_READ_AGGREGATE : TYPE_WRITE_AGGREGATE;
+        record.event.time_start = io->time_first;
+        record.event.time_end = io->time_last;
+        record.event.utime_start = 0;
+        record.event.utime_end = io->utime;
+        record.event.stime_start = 0;
+        record.event.stime_end = io->stime;
+        record.event.result = io->ops;
+        record.event.offset = io->offset_start;
+        record.event.size = io->bytes;
+        record.offset_end = io->offset_end;
+        record.busy = io->busy;
+        record.errors = io->errors;
+        __builtin_memcpy(record.histogram, io->histogram, sizeof(record.histogram));
+        record.cache_hits = io->cache_hits;
+        record.cache_misses = io->cache_misses;
+        Submit(&record, sizeof(record));
+    }
+
+    CountDelete(MAP_AGGREGATES, bpf_map_delete_elem(&aggregates, &close->handle_uid));
+}
+
+// copies the names from entry up to the root to data at offset, returns the new offset
+static u32 CopyDentries(struct event_path_t* record, u32 offset, struct dentry* entry)
+{
+    #pragma unroll
+    for (int i = 0; i < PATH_DEPTH_MAX; i++)
+    {
+        if (i >= path_depth || !entry)
+            break;
+
+        int copied_size = bpf_probe_read_kernel_str(&record->data[offset & (path_bufsize - 1) & (PATH_BUFSIZE_MAX - 1)], filename_bufsize, BPF_CORE_READ(entry, d_name.name));
+
+        if (copied_size <= 0)
+            break;
+
+        offset += copied_size;
+        struct dentry* parent = BPF_CORE_READ(entry, d_parent);
+        entry = (parent != entry) ? parent : NULL; // the root is its own parent
+    }
+
+    return offset;
+}
+
+// checks the path of entry (up to the root of its filesystem, like the 'F' path) against the allowed prefixes
+static bool PathAllowed(struct dentry* entry)
+{
+    int zero = 0;
+    struct path_filter_scratch_t* key = bpf_map_lookup_elem(&path_filter_scratch, &zero);
+
+    if (key == NULL) // will not fail, BPF wants the check though
+        return false;
+
+    // the names come file first, so collect the dentries and copy them in reverse
+    struct dentry* dentries[PATH_DEPTH_MAX] = {};
+    #pragma unroll
+    for (int i = 0; i < PATH_DEPTH_MAX; i++)
+    {
+        if (i >= path_depth)
+            break;
+        struct dentry* parent = BPF_CORE_READ(entry, d_parent);
+        if (parent == entry) // the root is its own parent, its name "/" is not part of the path
+            break;
+        dentries[i] = entry;
+        entry = parent;
+    }
+
+    u32 offset = 0;
+    #pragma unroll
+    for (int i = PATH_DEPTH_MAX - 1; i >= 0; i--)
+    {
+        if (dentries[i] == NULL || offset >= PATH_FILTER_BYTES)
+            continue;
+
+        key->data[offset & (PATH_FILTER_BYTES - 1)] = '/';
+        offset++;
+        if (offset >= PATH_FILTER_BYTES)
+            continue;
+
+        int copied_size = bpf_probe_read_kernel_str(&key->data[offset & (PATH_FILTER_BYTES - 1)], filename_bufsize, BPF_CORE_READ(dentries[i], d_name.name));
+        if (copied_size > 1)
+            offset += copied_size - 1; // without the null
+    }
+
+    if (offset > PATH_FILTER_BYTES)
+        offset = PATH_FILTER_BYTES;
+    key->prefixlen = offset * 8;
+    return bpf_map_lookup_elem(&log_paths, key) != NULL;
+}
+
+// finalizes event and submits it together with the paths in one record, without file only a reference to path_id is sent
+// returns false if the record could not be submitted
+static bool FinalizeAndSubmitPathEvent(struct event_main_t* event, u64 path_id, struct dentry* file, struct dentry* mnt_root, struct dentry* sb_root)
+{
+    int zero = 0;
+    struct event_path_t* record = bpf_map_lookup_elem(&path_scratch, &zero);
+
+    if (record == NULL) // will not fail, BPF wants the check though
+        return false;
+
+    record->path_id = path_id;
+    record->path_reference = (path_id != 0 && file == NULL);
+
+    u32 offset = CopyDentries(record, 0, file);
+    record->path_length[0] = offset;
+    u32 next = CopyDentries(record, offset, mnt_root);
+    record->path_length[1] = next - offset;
+    offset = CopyDentries(record, next, sb_root);
+    record->path_length[2] = offset - next;
+
+    FinalizeMainEvent(event);
+    record->event = *event;
+
+    if (offset > path_bufsize)
+        offset = path_bufsize;
+    u32 length = __builtin_offsetof(struct event_path_t, data) + offset;
+    int res = bpf_ringbuf_output(&event_main, record, length, WakeupFlags(length));
+    if (res != 0)
+        Increment(&lost_events, LOST_EVENT_MAIN);
+    return res == 0;
+}
+
+// finalizes and submits an open event, the paths are only sent if they are not known in user space yet
+static void FinalizeAndSubmitOpenEvent(struct event_main_t* event, struct file* fp)
+{
+    struct dentry* dentry = BPF_CORE_READ(fp, f_path.dentry);
+    struct vfsmount* mnt = BPF_CORE_READ(fp, f_path.mnt);
+    struct dentry* mnt_root = BPF_CORE_READ(mnt, mnt_root);
+    struct dentry* sb_root = BPF_CORE_READ(mnt, mnt_sb, s_root);
+
+    if (!path_cache_enabled)
+    {
+        FinalizeAndSubmitPathEvent(event, 0, dentry, mnt_root, sb_root);
+        return;
+    }
+
+    int zero = 0;
+    struct path_key_t key = {};
+    key.dentry = dentry;
+    key.mnt = mnt;
+
+    struct path_cache_t current = {};
+    u64* epoch = bpf_map_lookup_elem(&path_epoch, &zero);
+    if (epoch != NULL) // will not fail, BPF wants the check though
+        current.epoch = *epoch;
+    current.parent = BPF_CORE_READ(dentry, d_parent);
+    current.name_hash_len = BPF_CORE_READ(dentry, d_name.hash_len);
+    current.ino = BPF_CORE_READ(dentry, d_inode, i_ino);
+    current.generation = BPF_CORE_READ(dentry, d_inode, i_generation);
+
+    struct path_cache_t* cached = bpf_map_lookup_elem(&path_cache, &key);
+    if (cached != NULL && cached->epoch == current.epoch && cached->parent == current.parent && cached->name_hash_len == current.name_hash_len
+        && cached->ino == current.ino && cached->generation == current.generation)
+    {
+        Increment(&path_cache_stats, PATH_CACHE_HITS);
+        FinalizeAndSubmitPathEvent(event, cached->path_id, NULL, NULL, NULL);
+        return;
+    }
+
+    Increment(&path_cache_stats, PATH_CACHE_MISSES);
+    u64* p_global_path_id = bpf_map_lookup_elem(&global_path_id, &zero);
+    if (p_global_path_id != NULL) // will not fail, BPF wants the check though
+        current.path_id = __sync_fetch_and_add(p_global_path_id, 1) + 1; // misses on other cpus increment it at the same time
+
+    // cached only once the paths are in the ring buffer, opens on other cpus must not reference them before
+    if (FinalizeAndSubmitPathEvent(event, current.path_id, dentry, mnt_root, sb_root))
+        bpf_map_update_elem(&path_cache, &key, &current, BPF_ANY);
+}
+
+static bool CheckToLog()
+{
+    if (filter_by_pid)
+    {
+        pid_t pid = (bpf_get_current_pid_tgid() >> 32);
+        if (bpf_map_lookup_elem(&log_pids, &pid) == NULL)
+            return false;
+    }
+
+    if (filter_by_uid)
+    {
+        u32 uid = (bpf_get_current_uid_gid() & 0xFFFFFFFF);
+        if (bpf_map_lookup_elem(&log_uids, &uid) == NULL)
+            return false;
+    }
+
+    if (filter_by_gid)
+    {
+        u32 gid = (bpf_get_current_uid_gid() >> 32);
+        if (bpf_map_lookup_elem(&log_gids, &gid) == NULL)
+            return false;
+    }
+
+    if (cgroup_filter_size != 0)
+    {
+        bool in_cgroup = false;
+        #pragma unroll
+        for (int i = 0; i < CGROUP_FILTER_MAX; i++)
+        {
+            if (i >= cgroup_filter_size)
+                break;
+            if (bpf_current_task_under_cgroup(&log_cgroups, i) == 1)
+            {
+                in_cgroup = true;
+                break;
+            }
+        }
+
+        if (!in_cgroup)
+            return false;
+    }
+
+    return true;
+}
+
+static void do_open(bool insert, struct file* fp)
+{
+    if (!CheckToLog())
+        return;
+
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t saved = {};
+    saved.fp = fp;
+    PrepareMainEvent(&saved.event);
+    saved.event.type = TYPE_OPEN;
+    if (insert || bpf_map_lookup_elem(&save, &id) == NULL)
+        CountInsert(MAP_SAVE, bpf_map_update_elem(&save, &id, &saved, BPF_NOEXIST));
+    else
+        bpf_map_update_elem(&save, &id, &saved, BPF_ANY);
+}
+
+// if fp is NULL, the FP saved in open is used
+static void do_ret_open(s64 result, struct file* fp)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+
+    if (saved == NULL)
+        return;
+
+    if (fp != NULL)
+        saved->fp = fp;
+
+    if (!saved->fp || IS_ERR_VALUE(saved->fp))
+        saved->fp = NULL;
+
+    // failed opens have no path to match, files not matching are not tracked, so their reads, writes and closes are ignored
+    if (filter_by_path && (saved->fp == NULL || !PathAllowed(BPF_CORE_READ(saved->fp, f_path.dentry))))
+    {
+        CountDelete(MAP_SAVE, bpf_map_delete_elem(&save, &id));
+        return;
+    }
+
+    if (saved->fp)
+        SetEventFileStuff(&saved->event, saved->fp);
+
+    saved->event.result = result;
+    if (saved->fp)
+        FinalizeAndSubmitOpenEvent(&saved->event, saved->fp);
+    else
+        FinalizeAndSubmitPathEvent(&saved->event, 0, NULL, NULL, NULL);
+    CountDelete(MAP_SAVE, bpf_map_delete_elem(&save, &id));
+}
+
+// used for do_filp_open, do_file_open_root
+SEC("kprobe")
+int BPF_KPROBE(open_without_file)
+{
+    do_open(true, NULL);
+    return 0;
+}
+
+SEC("kretprobe")
+int BPF_KRETPROBE(ret_open_returning_file, struct file* fp)
+{
+    do_ret_open(IS_ERR_VALUE(fp) ? (s64)fp : 0, fp);
+    return 0;
+}
+
+// used for vfs_open and the filesystem specific open functions
+SEC("kprobe")
+int BPF_KPROBE(open_with_file, void *unused, struct file *file)
+{
+    do_open(false, file);
+    return 0;
+}
+
+SEC("kretprobe")
+int BPF_KRETPROBE(ret_open_without_file, int ret)
+{
+    do_ret_open(ret, NULL);
+    return 0;
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_filp_close, struct file *file)
+{
+    if (!CheckToLog())
+        return 0;
+
+    u64* saved_handle = bpf_map_lookup_elem(&opened, &file);
+
+    if (saved_handle != NULL)
+    {
+        u64 id = bpf_get_current_pid_tgid();
+        struct save_t saved = {};
+        if (FileCount(file) <= 1)
+        {
+            saved.inode = BPF_CORE_READ(file, f_inode, i_ino);
+            saved.unlinked_inode = (BPF_CORE_READ(file, f_inode, i_nlink) == 0);
+        }
+        else
+            saved.inode = (unsigned long)-1;
+        saved.fp = file;
+        PrepareMainEvent(&saved.event);
+        SetEventFileStuff(&saved.event, file);
+        saved.event.type = TYPE_CLOSE;
+        CountInsert(MAP_SAVE, bpf_map_update_elem(&save, &id, &saved, BPF_NOEXIST));
+    }
+
+    return 0;
+}
+
+SEC("kretprobe")
+int BPF_KRETPROBE(retprobe_filp_close, int ret)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+
+    if (saved != NULL)
+    {
+        saved->event.result = ret;
+
+        if (saved->event.result == 0 && saved->inode != (unsigned long)-1)
+        {
+            CountDelete(MAP_OPENED, bpf_map_delete_elem(&opened, &saved->fp));
+            struct saved_inode_t* saved_inode = bpf_map_lookup_elem(&inodes, &saved->inode);
+
+            if (saved_inode != NULL) // should always be the case
+            {
+                if (--saved_inode->opened_handles == 0 && saved->unlinked_inode)
+                    CountDelete(MAP_INODES, bpf_map_delete_elem(&inodes, &saved->inode));
+            }
+
+            if (aggregate_readwrites)
+                SubmitAggregates(&saved->event);
+        }
+
+        FinalizeAndSubmitMainEvent(&saved->event);
+        CountDelete(MAP_SAVE, bpf_map_delete_elem(&save, &id));
+    }
+
+    return 0;
+}
+
+SEC("kprobe")
+int probe_vfs_unlink(struct pt_regs *ctx)
+{
+    // 5.12 added the user namespace (later mnt_idmap) as first argument
+    struct dentry *dentry = (struct dentry *)((LINUX_KERNEL_VERSION < KERNEL_VERSION(5, 12, 0)) ? PT_REGS_PARM2(ctx) : PT_REGS_PARM3(ctx));
+    u64 id = bpf_get_current_pid_tgid();
+    unsigned long inode = BPF_CORE_READ(dentry, d_inode, i_ino);
+    struct saved_inode_t* saved_inode = NULL;
+
+    if (BPF_CORE_READ(dentry, d_inode, i_nlink) <= 1)
+    { // unlink potentially deletes file
+        saved_inode = bpf_map_lookup_elem(&inodes, &inode);
+
+        if (saved_inode != NULL && saved_inode->opened_handles == 0) // also it's one of "our" inodes that have no handles anymore, so we have to delete it, if unlink is successful
+            CountInsert(MAP_SAVE_DELETE, bpf_map_update_elem(&save_delete, &id, &inode, BPF_NOEXIST));
+    }
+
+    if (log_deletes && CheckToLog() && (!filter_by_path || PathAllowed(dentry)))
+    {
+        if (saved_inode == NULL)
+            saved_inode = bpf_map_lookup_elem(&inodes, &inode);
+
+        struct save_t saved = {};
+        PrepareMainEvent(&saved.event);
+        saved.event.type = TYPE_DELETE;
+        saved.dentry = dentry; // still referenced by the caller when vfs_unlink returns, the path is read then
+
+        if (saved_inode != NULL)
+            saved.event.inode_uid = saved_inode->inode_uid;
+        else
+            saved.event.inode_uid = (u64)-inode;
+
+        CountInsert(MAP_SAVE, bpf_map_update_elem(&save, &id, &saved, BPF_NOEXIST));
+    }
+
+    return 0;
+}
+
+SEC("kretprobe")
+int BPF_KRETPROBE(retprobe_vfs_unlink, int ret)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    unsigned long* saved_inode = bpf_map_lookup_elem(&save_delete, &id);
+
+    if (saved_inode != NULL)
+    {
+        if (ret == 0) // unlink succeeded
+            CountDelete(MAP_INODES, bpf_map_delete_elem(&inodes, saved_inode));
+
+        CountDelete(MAP_SAVE_DELETE, bpf_map_delete_elem(&save_delete, &id));
+    }
+
+    if (!log_deletes)
+        return 0;
+
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+
+    if (saved != NULL)
+    {
+        saved->event.result = ret;
+        FinalizeAndSubmitPathEvent(&saved->event, 0, saved->dentry, NULL, BPF_CORE_READ(saved->dentry, d_sb, s_root));
+        CountDelete(MAP_SAVE, bpf_map_delete_elem(&save, &id));
+    }
+
+    return 0;
+}
+
+static void IncrementPathEpoch()
+{
+    int zero = 0;
+    u64* epoch = bpf_map_lookup_elem(&path_epoch, &zero);
+    if (epoch != NULL) // will not fail, BPF wants the check though
+        __sync_fetch_and_add(epoch, 1);
+}
+
+static void CheckRenamedDirectory(struct dentry* dentry)
+{
+    struct inode* inode = BPF_CORE_READ(dentry, d_inode);
+
+    if (inode != NULL && (BPF_CORE_READ(inode, i_mode) & S_IFMT) == S_IFDIR)
+    {
+        u64 id = bpf_get_current_pid_tgid();
+        u8 one = 1;
+        IncrementPathEpoch();
+        bpf_map_update_elem(&renaming_directory, &id, &one, BPF_ANY);
+    }
+}
+
+// invalidates the path cache when a directory is renamed and again when it returns, only attached with the path cache
+SEC("kprobe")
+int probe_vfs_rename(struct pt_regs *ctx)
+{
+    if (LINUX_KERNEL_VERSION < KERNEL_VERSION(5, 12, 0))
+    {
+        CheckRenamedDirectory((struct dentry *)PT_REGS_PARM2(ctx));
+        CheckRenamedDirectory((struct dentry *)PT_REGS_PARM4(ctx));
+    }
+    else
+    {
+        struct renamedata___new *rd = (struct renamedata___new *)PT_REGS_PARM1(ctx);
+        CheckRenamedDirectory(BPF_CORE_READ(rd, old_dentry));
+        CheckRenamedDirectory(BPF_CORE_READ(rd, new_dentry)); // RENAME_EXCHANGE
+    }
+    return 0;
+}
+
+SEC("kretprobe")
+int retprobe_vfs_rename(struct pt_regs *ctx)
+{
+    u64 id = bpf_get_current_pid_tgid();
+
+    if (bpf_map_lookup_elem(&renaming_directory, &id) != NULL)
+    {
+        IncrementPathEpoch();
+        bpf_map_delete_elem(&renaming_directory, &id);
+    }
+    return 0;
+}
+
+static int do_readwrite(struct file* file, size_t size, loff_t* pos, u8 type)
+{
+    if (!CheckToLog())
+        return 0;
+
+    u64* saved_handle = bpf_map_lookup_elem(&opened, &file);
+
+    if (saved_handle != NULL)
+    {
+        struct save_t saved = {};
+        PrepareMainEvent(&saved.event);
+        SetEventFileStuff(&saved.event, file);
+        saved.event.type = type;
+        saved.event.size = size;
+        loff_t offset = 0;
+        bpf_probe_read_kernel(&offset, sizeof(offset), pos); // pos is NULL for streams
+        saved.event.offset = offset;
+
+        u64 id = bpf_get_current_pid_tgid();
+        CountInsert(MAP_SAVE, bpf_map_update_elem(&save, &id, &saved, BPF_NOEXIST));
+    }
+
+    return 0;
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_vfs_write, struct file *file, const char *buf, size_t count, loff_t *pos)
+{
+    return do_readwrite(file, count, pos, TYPE_WRITE);
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_vfs_read, struct file *file, char *buf, size_t count, loff_t *pos)
+{
+    return do_readwrite(file, count, pos, TYPE_READ);
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_do_iter_write, struct file *file, struct iov_iter *iter, loff_t *pos)
+{ // covers vfs_iter_write, vfs_writev
+    return do_readwrite(file, BPF_CORE_READ(iter, count), pos, TYPE_WRITE);
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_do_iter_read, struct file *file, struct iov_iter *iter, loff_t *pos)
+{ // covers vfs_iter_read, vfs_readv
+    return do_readwrite(file, BPF_CORE_READ(iter, count), pos, TYPE_READ);
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_do_iter_readv_writev, struct file *file, struct iov_iter *iter, loff_t *pos, int type)
+{ // for kernel 6+ instead of do_iter_read / do_iter_write
+    if (log_reads && type == READ)
+        return do_readwrite(file, BPF_CORE_READ(iter, count), pos, TYPE_READ);
+    else if (log_writes && type == WRITE)
+        return do_readwrite(file, BPF_CORE_READ(iter, count), pos, TYPE_WRITE);
+    return 0;
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_vfs_iocb_iter_write, struct file *file, struct kiocb *iocb, struct iov_iter *iter)
+{
+    return do_readwrite(file, BPF_CORE_READ(iter, count), &iocb->ki_pos, TYPE_WRITE);
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_vfs_iocb_iter_read, struct file *file, struct kiocb *iocb, struct iov_iter *iter)
+{
+    return do_readwrite(file, BPF_CORE_READ(iter, count), &iocb->ki_pos, TYPE_READ);
+}
+
+SEC("kretprobe")
+int BPF_KRETPROBE(retprobe_readwrites, long ret)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+
+    if (saved != NULL)
+    {
+        u64 cache_misses = saved->cache_added;
+        u64 cache_hits = 0;
+        if (saved->cache_accessed > saved->cache_added) // readahead may add more pages than the read accesses
+            cache_hits = saved->cache_accessed - saved->cache_added;
+
+        saved->event.result = ret;
+        FinalizeMainEvent(&saved->event);
+        if (aggregate_readwrites)
+            AggregateReadWrite(&saved->event, cache_hits, cache_misses);
+        if (submit_readwrites && track_page_cache && saved->event.type == TYPE_READ)
+        {
+            struct event_read_t record = {};
+            record.event = saved->event;
+            record.cache_hits = cache_hits;
+            record.cache_misses = cache_misses;
+            Submit(&record, sizeof(record));
+        }
+        else if (submit_readwrites)
+            Submit(&saved->event, sizeof(saved->event));
+        CountDelete(MAP_SAVE, bpf_map_delete_elem(&save, &id));
+    }
+
+    return 0;
+}
+
+// same as in testdir/bpf.cpp, only attached with track_block_io
+struct block_request_t
+{
+    struct event_main_t event;
+    unsigned int remaining; // bytes not completed yet
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 10240);
+    __type(key, struct request*);
+    __type(value, struct block_request_t);
+} block_requests SEC(".maps");
+
+SEC("kprobe")
+int BPF_KPROBE(probe_block_issue, struct request *rq)
+{
+    struct block_request_t request = {};
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+
+    if (saved != NULL && (saved->event.type == TYPE_READ || saved->event.type == TYPE_WRITE))
+    {
+        request.event.pid = saved->event.pid;
+        request.event.inode_uid = saved->event.inode_uid;
+        request.event.handle_uid = saved->event.handle_uid;
+    }
+    else
+    {
+        struct address_space* mapping = BPF_CORE_READ(rq, bio, bi_io_vec, bv_page, mapping);
+        if (mapping == NULL || ((unsigned long)mapping & 1)) // anonymous pages (direct I/O of another task)
+            return 0;
+        unsigned long inode = BPF_CORE_READ(mapping, host, i_ino);
+        struct saved_inode_t* saved_inode = bpf_map_lookup_elem(&inodes, &inode);
+        if (saved_inode == NULL)
+            return 0;
+        request.event.inode_uid = saved_inode->inode_uid;
+    }
+
+    request.event.type = TYPE_BLOCK;
+    request.event.time_start = bpf_ktime_get_ns();
+    request.event.offset = BPF_CORE_READ(rq, __sector) << 9;
+    request.event.flags = BPF_CORE_READ(rq, cmd_flags);
+    request.remaining = BPF_CORE_READ(rq, __data_len);
+    CountInsert(MAP_BLOCK_REQUESTS, bpf_map_update_elem(&block_requests, &rq, &request, BPF_NOEXIST));
+    return 0;
+}
+
+SEC("raw_tp/block_rq_complete")
+int BPF_PROG(raw_tracepoint_block_rq_complete, struct request *rq, int error, unsigned int nr_bytes)
+{
+    struct block_request_t* request = bpf_map_lookup_elem(&block_requests, &rq);
+
+    if (request == NULL)
+        return 0;
+
+    request->event.time_end = bpf_ktime_get_ns();
+    if (request->event.result == 0)
+        request->event.result = error;
+    request->event.size += nr_bytes;
+    request->remaining = (nr_bytes < request->remaining) ? request->remaining - nr_bytes : 0;
+    if (request->remaining != 0)
+        return 0; // more parts follow
+
+    Submit(&request->event, sizeof(request->event));
+    CountDelete(MAP_BLOCK_REQUESTS, bpf_map_delete_elem(&block_requests, &rq));
+    return 0;
+}
+
+// same as in testdir/bpf.cpp, attached to folio_mark_accessed / filemap_add_folio or mark_page_accessed / add_to_page_cache_lru
+SEC("kprobe")
+int BPF_KPROBE(probe_page_accessed)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+    if (saved != NULL && saved->event.type == TYPE_READ)
+        saved->cache_accessed++;
+    return 0;
+}
+
+SEC("kprobe")
+int BPF_KPROBE(probe_page_added)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    struct save_t* saved = bpf_map_lookup_elem(&save, &id);
+    if (saved != NULL && saved->event.type == TYPE_READ)
+        saved->cache_added++;
+    return 0;
+}
+
+// called for every exiting thread, drops what it left in the maps and removes it from the pid filter
+SEC("tp/sched/sched_process_exit")
+int tracepoint_sched_process_exit(struct trace_event_raw_sched_process_template *args)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    CountDelete(MAP_SAVE, bpf_map_delete_elem(&save, &id));
+    CountDelete(MAP_SAVE_DELETE, bpf_map_delete_elem(&save_delete, &id));
+
+    if (filter_by_pid)
+    {
+        pid_t pid = args->pid;
+        bpf_map_delete_elem(&log_pids, &pid);
+    }
+    return 0;
+}
+
+// only attached with the pid filter and include_child_processes
+SEC("tp/sched/sched_process_fork")
+int tracepoint_sched_process_fork(struct trace_event_raw_sched_process_fork *args)
+{
+    pid_t pid = args->parent_pid;
+
+    if (bpf_map_lookup_elem(&log_pids, &pid) != NULL)
+    {
+        u8 one = 1;
+        pid = args->child_pid;
+        bpf_map_update_elem(&log_pids, &pid, &one, BPF_NOEXIST);
+    }
+
+    return 0;
+}
+
+char LICENSE[] SEC("license") = "GPL";
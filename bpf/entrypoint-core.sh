@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# no kernel headers needed, the programs are precompiled
+if [ ! -d /sys/kernel/tracing/events ] && [ ! -d /sys/kernel/debug/tracing/events ]; then
+    mount -t tracefs none /sys/kernel/tracing 2>/dev/null || mount -t debugfs none /sys/kernel/debug
+fi
+
+# cgroup-informer-core ARGS starts the cgroup informer, anything else is passed to fileaccess-core
+if [ "$1" == "cgroup-informer-core" ]; then
+    shift
+    echo "Starting cgroup-informer-core..."
+    exec ./cgroup-informer-core "$@"
+fi
+
+echo "Starting fileaccess-core..."
+echo "Your container args are: $@"
+
+exec ./fileaccess-core "$@"
@@ -1,9 +1,10 @@
-from time import time_ns
+from time import monotonic_ns, time_ns
 from bcc import BPF
 import argparse
 import ctypes
 import os
 import re
+import resource
 import sys
 
 # read bpf file and extract the relevant code
@@ -20,8 +21,9 @@ group.add_argument('-i', '--id', type=str, help='filter by comma separated list
 group.add_argument('-p', '--program', type=str, help='commandline to call program that is going to be logged')
 group.add_argument('-u', '--user', type=str, help='filter by comma separated list of UIDs or user names')
 group.add_argument('-g', '--group', type=str, help='filter by comma separated list of GIDs or group names')
+group.add_argument('-C', '--cgroup', type=str, help='filter by comma separated list of cgroup v2 directories (e.g. /sys/fs/cgroup/kubepods.slice/...), including the cgroups below them')
 
-parser.add_argument('-P', '--path', type=str, help='filter by comma separated list of paths (provided by script, not BPF)')
+parser.add_argument('-P', '--path', type=str, help='filter by comma separated list of path prefixes, matched against the path inside the filesystem (at most 256 bytes)')
 parser.add_argument('-o', '--operations', type=str, help='specifies which operations to log (default: OCRWU)', default='OCRWU')
 parser.add_argument('-c', '--includechildren', action='store_true', help='also include child processes')
 parser.add_argument('-O', '--output', type=str, help='file to direct output to (will be overwritten) (default: stdout)')
@@ -33,9 +35,20 @@ parser.add_argument('--depth', type=int, help='depth of loop unrolling, equals s
 parser.add_argument('--bufsize', type=int, help='size of the path buffer, maximum supported size per path part (default: 64)', default=64)
 parser.add_argument('--delimiter', type=str, help='delimiter of output fields (default comma)', default=',')
 parser.add_argument('--pathoutput', type=int, help='number of characters for path output (default 240)', default=240)
+parser.add_argument('--pathcache', type=int, help='entries of the kernel cache of already sent paths, 0 to send the paths with every open (default: 16384)', default=16384)
+parser.add_argument('--handles', type=int, help='entries of the kernel maps of open handles, least recently used ones are evicted (default: 65536)', default=65536)
+parser.add_argument('--inodes', type=int, help='entries of the kernel map of inodes, least recently used ones are evicted (default: 65536)', default=65536)
+parser.add_argument('--inflight', type=int, help='entries of the kernel maps of calls between entry and return, least recently used ones are evicted (default: 10240)', default=10240)
+parser.add_argument('--mapstats', type=int, help='print the usage of the kernel maps every N seconds, 0 for only at exit (default: 0)', default=0)
+parser.add_argument('--aggregate', action='store_true', help='additionally sum up reads and writes per handle in the kernel, output as r / w events at close')
+parser.add_argument('--aggregateonly', action='store_true', help='like --aggregate, but without the individual R / W events')
+parser.add_argument('--pagecache', action='store_true', help='count the page cache hits and misses (pages) of reads, output in the path column of R events as hits:misses and appended to the r aggregates')
+parser.add_argument('--blockio', action='store_true', help='also log the block requests of the traced handles / inodes as B events with their device service time')
 parser.add_argument('--evbufmain', type=int, help='page count for main event buffer (default: 8)', default=8)
-parser.add_argument('--evbufpath', type=int, help='page count for path event buffer (default: 8)', default=8)
+parser.add_argument('--wakeupfill', type=int, help='percentage of the main event buffer that has to be filled before the consumer is woken up, 0 to wake it up for every event (default: 25)', default=25)
+parser.add_argument('--wakeuptime', type=int, help='milliseconds after which the consumer is woken up regardless of --wakeupfill (default: 10)', default=10)
 parser.add_argument('--perfbuf', action='store_true', help='use perf buf instead of ring buf output (might be needed on older kernels)')
+parser.add_argument('--fentry', action='store_true', help='use fentry / fexit instead of kprobes for the functions called most and task local storage instead of a hash map (needs BTF and kernel 5.12+, falls back to kprobes)')
 parser.add_argument('--usermodepathfilter', action='store_true', help='filter by path (-P/--path) in usermode (Python) instead of BPF code (might be needed for older kernels)')
 
 parser.add_argument('--printonly', action='store_true', help='only prints the final BPF program (after all options have been applied), does not execute it')
@@ -44,6 +57,8 @@ parser.add_argument('--compileonly', action='store_true', help='only compiles th
 args = parser.parse_args()
 
 args.operations = args.operations.upper()
+if args.blockio:
+    args.operations += 'B'
 
 if args.output:
     sys.stdout = open(args.output, 'w')
@@ -53,6 +68,8 @@ pid_filter = (args.program is not None or args.id is not None)
 bpf_text = bpf_text.replace('FILTER_BY_PID', '1' if pid_filter else '0')
 bpf_text = bpf_text.replace('FILTER_BY_UID', '1' if args.user is not None else '0')
 bpf_text = bpf_text.replace('FILTER_BY_GID', '1' if args.group is not None else '0')
+bpf_text = bpf_text.replace('FILTER_BY_CGROUP', '1' if args.cgroup is not None else '0')
+bpf_text = bpf_text.replace('CGROUP_FILTER_SIZE', str(len(args.cgroup.split(','))) if args.cgroup is not None else '1')
 
 bpf_text = bpf_text.replace('FILTER_BY_PATH', '1' if args.path is not None and not args.usermodepathfilter else '0')
 
@@ -60,6 +77,16 @@ bpf_text = bpf_text.replace('INCLUDE_CHILD_PROCESSES', '1' if args.includechildr
 bpf_text = bpf_text.replace('LOG_DELETES', '1' if args.operations.find('U') >= 0 else '0')
 bpf_text = bpf_text.replace('LOG_READS', '1' if args.operations.find('R') >= 0 else '0')
 bpf_text = bpf_text.replace('LOG_WRITES', '1' if args.operations.find('W') >= 0 else '0')
+bpf_text = bpf_text.replace('AGGREGATE_READWRITES', '1' if args.aggregate or args.aggregateonly else '0')
+bpf_text = bpf_text.replace('SUBMIT_READWRITES', '0' if args.aggregateonly else '1')
+bpf_text = bpf_text.replace('TRACK_PAGE_CACHE', '1' if args.pagecache else '0')
+bpf_text = bpf_text.replace('TRACK_BLOCK_IO', '1' if args.blockio else '0')
+
+if args.fentry and (args.perfbuf or not BPF.support_kfunc()):
+    print('fentry not supported' + (' with --perfbuf' if args.perfbuf else '') + ', using kprobes.', file=sys.stderr)
+    args.fentry = False
+bpf_text = bpf_text.replace('USE_FENTRY', '1' if args.fentry else '0')
+bpf_text = bpf_text.replace('FILESYSTEM_OPENS', '1' if args.filesystems is not None else '0')
 
 if args.perfbuf:
     bpf_text = re.sub('BPF_RINGBUF_OUTPUT\(([^,]+)[^;]+', r'BPF_PERF_OUTPUT(\1)', bpf_text)
@@ -67,8 +94,14 @@ if args.perfbuf:
 
 bpf_text = bpf_text.replace('PATH_DEPTH', str(args.depth))
 bpf_text = bpf_text.replace('FILENAME_BUFSIZE', str(args.bufsize))
+bpf_text = bpf_text.replace('PATH_BUFSIZE', str(1 << (3 * args.depth * args.bufsize - 1).bit_length())) # power of two for masking in BPF
+bpf_text = bpf_text.replace('PATH_CACHE_SIZE', str(args.pathcache))
+bpf_text = bpf_text.replace('HANDLE_MAP_SIZE', str(args.handles))
+bpf_text = bpf_text.replace('INODE_MAP_SIZE', str(args.inodes))
+bpf_text = bpf_text.replace('SAVE_MAP_SIZE', str(args.inflight))
 bpf_text = bpf_text.replace('RB_PAGES_EVENT_MAIN', str(args.evbufmain))
-bpf_text = bpf_text.replace('RB_PAGES_EVENT_PATH', str(args.evbufpath))
+bpf_text = bpf_text.replace('RB_WAKEUP_BYTES', '0' if args.perfbuf else str(args.evbufmain * os.sysconf('SC_PAGE_SIZE') * args.wakeupfill // 100))
+bpf_text = bpf_text.replace('RB_WAKEUP_NS', str(args.wakeuptime * 1000000))
 
 if args.printonly:
     print(bpf_text)
@@ -97,19 +130,22 @@ if args.filesystems is not None:
             pass
 else:
     print('Attaching to all filesystems.', file=sys.stderr)
-    b.attach_kprobe(event='vfs_open', fn_name='open_with_file')
-    b.attach_kprobe(event='do_filp_open', fn_name='open_without_file')
+    if not args.fentry: # else attached automatically as fentry
+        b.attach_kprobe(event='vfs_open', fn_name='open_with_file')
+        b.attach_kprobe(event='do_filp_open', fn_name='open_without_file')
     b.attach_kprobe(event='do_file_open_root', fn_name='open_without_file')
 
 # generally attach to the generic functions returns as after the internal (fs specific) opens the file struct might not be fully populated
 # also there is no drawback using the generic functions here since the internal ones pass through those anyway
-b.attach_kretprobe(event='vfs_open', fn_name='ret_open_without_file')
-b.attach_kretprobe(event='do_filp_open', fn_name='ret_open_returning_file')
+if not args.fentry: # else attached automatically as fexit
+    b.attach_kretprobe(event='vfs_open', fn_name='ret_open_without_file')
+    b.attach_kretprobe(event='do_filp_open', fn_name='ret_open_returning_file')
 b.attach_kretprobe(event='do_file_open_root', fn_name='ret_open_returning_file')
 
 if args.operations.find('R') >= 0:
-    b.attach_kretprobe(event='vfs_read', fn_name='retprobe__readwrites')
-    b.attach_kprobe(event='vfs_read', fn_name='probe__vfs_read')
+    if not args.fentry:
+        b.attach_kretprobe(event='vfs_read', fn_name='retprobe__readwrites')
+        b.attach_kprobe(event='vfs_read', fn_name='probe__vfs_read')
 
     try: # on newer kernels those functions don't exist and attaching will raise an exception; ignoring it is fine
         b.attach_kretprobe(event='do_iter_read', fn_name='retprobe__readwrites')
@@ -124,8 +160,9 @@ if args.operations.find('R') >= 0:
         pass
 
 if args.operations.find('W') >= 0:
-    b.attach_kretprobe(event='vfs_write', fn_name='retprobe__readwrites')
-    b.attach_kprobe(event='vfs_write', fn_name='probe__vfs_write')
+    if not args.fentry:
+        b.attach_kretprobe(event='vfs_write', fn_name='retprobe__readwrites')
+        b.attach_kprobe(event='vfs_write', fn_name='probe__vfs_write')
         
     try: # on newer kernels those functions don't exist and attaching will raise an exception; ignoring it is fine
         b.attach_kretprobe(event='do_iter_write', fn_name='retprobe__readwrites')
@@ -146,6 +183,19 @@ if args.operations.find('R') >= 0 or args.operations.find('W') >= 0:
     except:
         pass
 
+if args.pagecache and args.operations.find('R') >= 0:
+    # folio_mark_accessed / filemap_add_folio replaced mark_page_accessed / add_to_page_cache_lru (5.16+), which call them if they still exist
+    for functions, fn_name in [(['folio_mark_accessed', 'mark_page_accessed'], 'probe__page_accessed'), (['filemap_add_folio', 'add_to_page_cache_lru'], 'probe__page_added')]:
+        for function in functions:
+            if len(BPF.get_kprobe_functions(('^%s$' % function).encode())) > 0:
+                b.attach_kprobe(event=function, fn_name=fn_name)
+                break
+        else:
+            print('Page cache tracking: none of %s found.' % ', '.join(functions), file=sys.stderr)
+
+if args.blockio: # the raw tracepoint of the completion is attached automatically
+    b.attach_kprobe(event='blk_mq_start_request', fn_name='probe__block_issue')
+
 if args.id is not None:
     pids = [int(pid) for pid in args.id.split(',')]
     try:
@@ -202,8 +252,20 @@ if args.group is not None:
         for g in gids:
             b['log_gids'][ctypes.c_uint32(g)] = ctypes.c_uint32(1)
 
+if args.cgroup is not None:
+    for i, cgroup in enumerate(args.cgroup.split(',')):
+        b['log_cgroups'][i] = cgroup
+
 if args.path is not None:
     args.path = args.path.split(',')
+    if not args.usermodepathfilter: # prefixes of the LPM trie log_paths, at most 256 bytes
+        log_paths = b['log_paths']
+        for p in args.path:
+            data = p.encode('utf-8')[:256]
+            key = log_paths.Key()
+            key.prefixlen = len(data) * 8
+            key.data = data
+            log_paths[key] = ctypes.c_uint8(1)
 
 # output configuration
 SizeTimeSec    =  20                                # maybe a '-' followed by up to 19 digits, a '.' and 3 digits
@@ -235,47 +297,112 @@ OffFlags       = OffSize       + SizeSize       + 1
 OffPath        = OffFlags      + SizeFlags      + 1
 SizeEntry      = OffPath       + SizePath       + 1
 
-# dictionary of handle_uid to path to concat the different path parts coming from the transmit_path callback
-open_pathes = dict()
-
-# dictionary of handle_uid to array of events that are saved here until the path for the handle_uid is fully transmitted (only then we can correctly output the open event)
-saved_events = dict()
-
-# dictionary of inode to path to concat the different path parts coming from the transmit_path callback, same as the two dicts above
-delete_pathes = dict()
-saved_delete_event = dict()
-
 # set of handles to filter for (according to -p / --path if used)
 allowed_handles = set()
 
 rtdelta = None
 
+# user space mirror of struct event_main_t and struct event_path_t
+class EventMain(ctypes.Structure):
+    _fields_ = [
+        ('time_start', ctypes.c_uint64),
+        ('time_end', ctypes.c_uint64),
+        ('pid', ctypes.c_uint32),
+        ('utime_start', ctypes.c_uint64),
+        ('utime_end', ctypes.c_uint64),
+        ('stime_start', ctypes.c_uint64),
+        ('stime_end', ctypes.c_uint64),
+        ('inode_uid', ctypes.c_uint64),
+        ('type', ctypes.c_uint8),
+        ('result', ctypes.c_int64),
+        ('handle_uid', ctypes.c_uint64),
+        ('offset', ctypes.c_uint64),
+        ('size', ctypes.c_uint64),
+        ('flags', ctypes.c_uint64)]
+
+# tail of struct event_aggregate_t
+class EventAggregate(ctypes.Structure):
+    _fields_ = [
+        ('offset_end', ctypes.c_uint64),
+        ('busy', ctypes.c_uint64),
+        ('errors', ctypes.c_uint64),
+        ('histogram', ctypes.c_uint32 * 8),
+        ('cache_hits', ctypes.c_uint64),
+        ('cache_misses', ctypes.c_uint64)]
+
+# tail of struct event_read_t
+class EventRead(ctypes.Structure):
+    _fields_ = [
+        ('cache_hits', ctypes.c_uint64),
+        ('cache_misses', ctypes.c_uint64)]
+
+PathIdOffset = ctypes.sizeof(EventMain)
+PathLengthOffset = PathIdOffset + 8
+PathReferenceOffset = PathLengthOffset + 3 * 2
+PathDataOffset = PathReferenceOffset + 2
+
+# path id -> path of the paths cached by the BPF program, only the first open of a path carries it
+known_paths = dict()
+unknown_path_references = 0
+
+# one path of event_path_t: null terminated dentry names from the file up to the root
+def join_dentries(data):
+    return ''.join('/' + name for name in reversed(data.decode('utf-8', 'replace').split('\0')[:-1]) if name != '/')
+
+def read_paths(data, size):
+    global unknown_path_references
+    path_id = ctypes.c_uint64.from_address(data + PathIdOffset).value
+    if ctypes.c_uint16.from_address(data + PathReferenceOffset).value != 0:
+        if path_id not in known_paths:
+            unknown_path_references += 1
+            return '::'
+        return known_paths[path_id]
+
+    lengths = (ctypes.c_uint16 * 3).from_address(data + PathLengthOffset)
+    raw = ctypes.string_at(data + PathDataOffset, size - PathDataOffset)
+    paths = []
+    offset = 0
+    for length in lengths:
+        paths.append(join_dentries(raw[offset:offset + length]))
+        offset += length
+    path = ':'.join(paths)
+    if path_id != 0:
+        known_paths[path_id] = path
+    return path
+
+# the path column of r / w events: highest offset accessed, ns spent, errors and the histogram of requested sizes (< 16, < 256, ...),
+# with --pagecache followed by the page cache hits and misses
+def read_aggregate(data):
+    aggregate = EventAggregate.from_buffer_copy(ctypes.string_at(data + ctypes.sizeof(EventMain), ctypes.sizeof(EventAggregate)))
+    path = '%d:%d:%d:%s' % (aggregate.offset_end, aggregate.busy, aggregate.errors, '/'.join(str(count) for count in aggregate.histogram))
+    if args.pagecache:
+        path += ':%d:%d' % (aggregate.cache_hits, aggregate.cache_misses)
+    return path
+
+# the path column of R events with --pagecache: page cache hits and misses
+def read_cache(data):
+    read = EventRead.from_buffer_copy(ctypes.string_at(data + ctypes.sizeof(EventMain), ctypes.sizeof(EventRead)))
+    return '%d:%d' % (read.cache_hits, read.cache_misses)
+
 # output function
-def output_event(event):
+def output_event(event, path):
     global rtdelta
 
     if rtdelta is None:
         rtdelta = time_ns() - event.time_end
 
-    path = ''
-
     time_start = event.time_start + rtdelta
     time_end = event.time_end + rtdelta
 
     unlink_ok = False
 
     if chr(event.type) == 'O':
-        if event.handle_uid in open_pathes:
-            path = open_pathes[event.handle_uid].pathes['F'] + ':' + open_pathes[event.handle_uid].pathes['M'] + ':' + open_pathes[event.handle_uid].pathes['S']
-            del open_pathes[event.handle_uid]
         if args.usermodepathfilter and args.path is not None:
             for p in args.path:
                 if path.startswith(p):
                     allowed_handles.add(event.handle_uid)
                     break
     elif chr(event.type) == 'U':
-        path = delete_pathes[event.inode_uid].pathes['F'] + ':' + delete_pathes[event.inode_uid].pathes['M'] + ':' + delete_pathes[event.inode_uid].pathes['S']
-        del delete_pathes[event.inode_uid]
         if args.usermodepathfilter and args.path is not None:
             for p in args.path:
                 if path.startswith(p):
@@ -285,7 +412,7 @@ def output_event(event):
     if len(path) > SizePath:
         path = path[:SizePath]
 
-    if args.operations.find(chr(event.type)) >= 0 and (not args.usermodepathfilter or (args.path is None or event.handle_uid in allowed_handles or unlink_ok)):
+    if args.operations.find(chr(event.type).upper()) >= 0 and (not args.usermodepathfilter or (args.path is None or event.handle_uid in allowed_handles or unlink_ok)):
         #print(time_start, time_end, event.pid, event.utime_start, event.utime_end, event.stime_start, event.stime_end, event.inode_uid, chr(event.type), event.result, event.handle_uid, event.offset, event.size, event.flags, path, sep=args.delimiter)
         time_start = time_start // 1000000
         time_end = time_end // 1000000
@@ -313,53 +440,33 @@ def output_event(event):
     if chr(event.type) == 'C' and args.path:
         allowed_handles.discard(event.handle_uid)
 
-class PathData:
-    def __init__(self) -> None:
-        self.pathes = {'F': '', 'M': '', 'S': ''}
-        self.ready = 0
-
-# BPF event callbacks
-def handle_path(cpu, data, size):
-    event = b['event_transmit_path'].event(data)
-    pathes = open_pathes if chr(event.event_type) == 'O' else delete_pathes
-    saved = saved_events if chr(event.event_type) == 'O' else saved_delete_event
-    #print('transmit_path:', event.filename, event.uid, event.final, event.last, chr(event.event_type), chr(event.path_type), file=sys.stderr)
-
-    if event.last == 0:
-        if event.filename != b'/':
-            if event.uid not in pathes:
-                pathes[event.uid] = PathData()
-
-            pathes[event.uid].pathes[chr(event.path_type)] = '/' + event.filename.decode('utf-8') + pathes[event.uid].pathes[chr(event.path_type)]
-    else:
-        if event.uid not in pathes:
-            pathes[event.uid] = PathData()
-        pathes[event.uid].ready |= event.final
-        if event.final == 1 and event.uid in saved:
-            #print('transmit_path:', event.filename, event.uid, event.last, chr(event.event_type), event.uid in pathes)#, file=sys.stderr)
-            for e in saved[event.uid]:
-                output_event(e)
-            del saved[event.uid]
+# time between the end of an event and its arrival in user space, to weigh the wakeup settings against the consumer cpu time
+events = 0
+latency_sum = 0
+latency_max = 0
 
+# BPF event callback, opens and unlinks come with their paths, aggregates with their details
 def handle_main(cpu, data, size):
-    event = b['event_main'].event(data)
-    #print('transmit_main:', chr(event.type), event.handle_uid, file=sys.stderr)
-
-    if chr(event.type) == 'U' and (not event.inode_uid in delete_pathes or delete_pathes[event.inode_uid].ready == 0):
-        saved_delete_event[event.inode_uid] = [event]
-    elif chr(event.type) == 'O' and (not event.handle_uid in open_pathes or open_pathes[event.handle_uid].ready == 0):
-        saved_events[event.handle_uid] = [event]
-    elif event.handle_uid in saved_events:
-        saved_events[event.handle_uid].append(event)
+    global events, latency_sum, latency_max
+    event = EventMain.from_buffer_copy(ctypes.string_at(data, ctypes.sizeof(EventMain)))
+    if chr(event.type) not in 'rw': # the end of an aggregate is that of its last operation
+        latency = monotonic_ns() - event.time_end
+        events += 1
+        latency_sum += latency
+        latency_max = max(latency_max, latency)
+    if chr(event.type) in 'OU':
+        output_event(event, read_paths(data, size))
+    elif chr(event.type) in 'rw':
+        output_event(event, read_aggregate(data))
+    elif chr(event.type) == 'R' and size >= ctypes.sizeof(EventMain) + ctypes.sizeof(EventRead):
+        output_event(event, read_cache(data))
     else:
-        output_event(event)
+        output_event(event, '')
 
 # attaching event callbacks
 if args.perfbuf:
-    b['event_transmit_path'].open_perf_buffer(handle_path, page_cnt=args.evbufpath)
     b['event_main'].open_perf_buffer(handle_main, page_cnt=args.evbufmain)
 else:
-    b['event_transmit_path'].open_ring_buffer(handle_path)
     b['event_main'].open_ring_buffer(handle_main)
 
 running = True
@@ -372,10 +479,44 @@ if args.time > 0:
     import threading
     threading.Timer(args.time, exitProg).start()
 
+# by map_index_t, save only exists without --fentry, aggregates are only used with --aggregate and block_requests with --blockio
+map_sizes = [('opened', args.handles), ('inodes', args.inodes), ('save', args.inflight), ('save_delete', args.inflight), ('aggregates', args.handles), ('block_requests', args.inflight)]
+
+def print_map_stats():
+    map_stats = b['map_stats']
+    for i, (name, size) in enumerate(map_sizes):
+        if (name == 'save' and args.fentry) or (name == 'aggregates' and not (args.aggregate or args.aggregateonly)) or (name == 'block_requests' and not args.blockio):
+            continue
+        inserted = map_stats.sum(ctypes.c_int(2 * i)).value
+        deleted = map_stats.sum(ctypes.c_int(2 * i + 1)).value
+        entries = len(b[name])
+        print('Map %s: %d of %d entries, %d inserted, %d deleted, %d evicted.' % (name, entries, size, inserted, deleted, max(inserted - deleted - entries, 0)), file=sys.stderr)
+
+next_map_stats = monotonic_ns() + args.mapstats * 1000000000
+
 print('time_start,time_end,pid,utime_start,utime_end,stime_start,stime_end,inode,type,result,handle,offset,size,flags,path')
 
 while running:
     try:
-        b.perf_buffer_poll(100) if args.perfbuf else b.ring_buffer_poll(100)
+        if args.perfbuf:
+            b.perf_buffer_poll(100)
+        else:
+            b.ring_buffer_poll(100)
+            b.ring_buffer_consume() # records submitted without wakeup
+        if args.mapstats > 0 and monotonic_ns() >= next_map_stats:
+            print_map_stats()
+            next_map_stats += args.mapstats * 1000000000
     except KeyboardInterrupt:
-        exit()
+        break
+
+sys.stdout.flush()
+usage = resource.getrusage(resource.RUSAGE_SELF)
+print('Consumer: %.3f s cpu time, event latency %.3f ms mean, %.3f ms max.' % (usage.ru_utime + usage.ru_stime, latency_sum / max(events, 1) / 1000000, latency_max / 1000000), file=sys.stderr)
+lost_events = b['lost_events']
+print('Lost events: %d (ring buffer full).' % lost_events.sum(ctypes.c_int(0)).value, file=sys.stderr)
+if args.pathcache > 0:
+    path_cache_stats = b['path_cache_stats']
+    hits = path_cache_stats.sum(ctypes.c_int(0)).value
+    misses = path_cache_stats.sum(ctypes.c_int(1)).value
+    print('Path cache: %d hits, %d misses (%.1f%% hit ratio), %d paths known, %d unknown references.' % (hits, misses, 100 * hits / max(hits + misses, 1), len(known_paths), unknown_path_references), file=sys.stderr)
+print_map_stats()
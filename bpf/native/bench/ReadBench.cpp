@@ -0,0 +1,48 @@
+// Microbenchmark of the tracing overhead per read: reads the same bytes of a file over and over and prints the time per read.
+// Run it untraced and as -p of fileaccess with and without --fentry, the differences are the overhead of the probes.
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " FILE [READS (default: 1000000)] [SIZE (default: 1)]" << std::endl;
+        return 2;
+    }
+    long reads = (argc > 2) ? std::atol(argv[2]) : 1000000;
+    size_t size = (argc > 3) ? std::atol(argv[3]) : 1;
+
+    int fd = ::open(argv[1], O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        std::cerr << "Could not open " << argv[1] << "." << std::endl;
+        return 1;
+    }
+    std::vector<char> buffer(size, 'x');
+    if (::pwrite(fd, buffer.data(), size, 0) != static_cast<ssize_t>(size))
+    {
+        std::cerr << "Could not write " << argv[1] << "." << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < reads; i++)
+    {
+        if (::pread(fd, buffer.data(), size, 0) < 0)
+        {
+            std::cerr << "Reading failed." << std::endl;
+            return 1;
+        }
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    std::cout << reads << " reads of " << size << " bytes: " << static_cast<double>(ns) / reads << " ns per read" << std::endl;
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef FILEACCESS_CONSUMER_HPP
+#define FILEACCESS_CONSUMER_HPP
+
+#include <Events.hpp>
+#include <FlatMap.hpp>
+#include <Options.hpp>
+#include <Output.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace FileAccess
+{
+    // Turns the records of event_main into output, same logic as the callback of fileaccess.py.
+    class Consumer
+    {
+    public:
+        Consumer(const Options &options, Output &output);
+
+        // ring_buffer_sample_fn callback, ctx is the Consumer
+        static int HandleMain(void *ctx, void *data, size_t size);
+
+        void handleMain(const EventMain &event, std::string_view path);
+
+        uint64_t mainRecords() const { return mainCount; }
+        size_t knownPaths() const { return paths.size(); }
+        uint64_t unknownPathReferences() const { return unknownReferences; }
+        // ns between the end of an event and its arrival here, aggregates are not counted
+        uint64_t latencyMean() const { return (latencyCount != 0) ? latencySum / latencyCount : 0; }
+        uint64_t latencyMax() const { return latencyMaximum; }
+
+    private:
+        // appends the path of null terminated dentry names (file first) in root first order
+        static void AppendDentries(std::string &path, std::string_view names);
+        // appends the details of an aggregate that don't fit into the csv columns
+        static void AppendAggregate(std::string &path, const EventAggregate &aggregate, bool pageCache);
+        bool pathAllowed(std::string_view path) const;
+
+        const Options &options;
+        Output &output;
+        uint64_t rtDelta;
+
+        std::string path; // reused for every record
+        FlatMap<std::string> paths; // path id -> path of the paths cached by the BPF program
+        FlatMap<uint8_t> allowedHandles; // handles matching -P with --usermodepathfilter
+
+        uint64_t mainCount = 0;
+        uint64_t unknownReferences = 0; // references to paths that never arrived
+        uint64_t latencyCount = 0;
+        uint64_t latencySum = 0;
+        uint64_t latencyMaximum = 0;
+    };
+}
+
+#endif // guard
@@ -0,0 +1,52 @@
+#ifndef FILEACCESS_COREPROGRAM_HPP
+#define FILEACCESS_COREPROGRAM_HPP
+
+#include <Events.hpp>
+#include <Options.hpp>
+
+#include <string>
+#include <vector>
+
+struct bpf_link;
+struct fileaccess_bpf;
+
+namespace FileAccess
+{
+    // The precompiled CO-RE program of core/fileaccess.bpf.c, loaded through its libbpf skeleton.
+    // Same interface as Program, the options are applied as read-only globals and map sizes instead of text replacements.
+    class CoreProgram
+    {
+    public:
+        // compile time maximums of core/fileaccess.bpf.c
+        static constexpr int PathDepthMax = 32;
+        static constexpr int FilenameBufSizeMax = 256;
+        static constexpr unsigned PathBufSizeMax = 16384;
+        static constexpr size_t CgroupFilterMax = 64;
+
+        ~CoreProgram();
+
+        int load(const Options &options);
+        int attach(const Options &options);
+        int setFilters(const Options &options);
+        int startProgram(const Options &options); // forks and starts -p, returns the pid
+
+        int tableFd(const std::string &name);
+        uint64_t lost(LostIndex index) { return sum("lost_events", static_cast<int>(index)); }
+        uint64_t pathCacheStat(PathCacheStat stat) { return sum("path_cache_stats", static_cast<int>(stat)); }
+        uint64_t mapInserts(MapIndex map) { return sum("map_stats", 2 * static_cast<int>(map)); }
+        uint64_t mapDeletes(MapIndex map) { return sum("map_stats", 2 * static_cast<int>(map) + 1); }
+        uint64_t mapEntries(const std::string &table); // iterates the keys
+
+    private:
+        int attachKprobe(const std::string &event, const std::string &function, bool ret, bool optional = false);
+        int attachTracepoint(const std::string &category, const std::string &event, const std::string &function);
+        uint64_t sum(const std::string &table, int index); // sum of a per cpu array entry over all cpus
+        template<typename Key>
+        int fillSet(const std::string &table, const std::vector<Key> &keys);
+
+        fileaccess_bpf *skel = nullptr;
+        std::vector<bpf_link*> links;
+    };
+}
+
+#endif // guard
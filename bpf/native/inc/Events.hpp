@@ -0,0 +1,103 @@
+#ifndef FILEACCESS_EVENTS_HPP
+#define FILEACCESS_EVENTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// User space mirror of the ring buffer records of testdir/bpf.cpp, keep in sync.
+namespace FileAccess
+{
+    // struct event_main_t
+    struct EventMain
+    {
+        uint64_t timeStart; // bpf_ktime_get_ns, CLOCK_MONOTONIC
+        uint64_t timeEnd;
+        uint32_t pid;
+        uint64_t utimeStart;
+        uint64_t utimeEnd;
+        uint64_t stimeStart;
+        uint64_t stimeEnd;
+        uint64_t inodeUid;
+        uint8_t type;
+        int64_t result;
+        uint64_t handleUid;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t flags;
+    };
+
+    static_assert(sizeof(EventMain) == 112, "EventMain does not match event_main_t.");
+
+    // struct event_path_t, submitted for opens and unlinks. Followed by the null terminated dentry names of the three paths,
+    // each from the file up to the root.
+    struct EventPath
+    {
+        EventMain event;
+        uint64_t pathId; // id in the path cache of the BPF program, 0 if not cached
+        uint16_t pathLength[3]; // bytes of the file ('F'), mount root ('M') and superblock root ('S') path
+        uint16_t pathReference; // 1 if the paths were sent with an earlier record of pathId
+
+        static constexpr size_t DataOffset = sizeof(EventMain) + 8 + 4 * sizeof(uint16_t);
+        const char *data() const { return reinterpret_cast<const char*>(this) + DataOffset; }
+    };
+
+    // struct event_aggregate_t, submitted with type 'r' / 'w' at the final close of a handle with --aggregate.
+    // In event result is the number of operations, offset the lowest offset accessed and size the bytes transferred.
+    struct EventAggregate
+    {
+        static constexpr int Buckets = 8; // requested sizes < 16, < 256, ..., >= 16^7 bytes
+
+        EventMain event;
+        uint64_t offsetEnd; // highest offset + result accessed
+        uint64_t busy; // ns spent in the operations
+        uint64_t errors;
+        uint32_t histogram[Buckets];
+        uint64_t cacheHits; // pages, with --pagecache
+        uint64_t cacheMisses;
+    };
+
+    static_assert(sizeof(EventAggregate) == 184, "EventAggregate does not match event_aggregate_t.");
+
+    // struct event_read_t, submitted for reads ('R') with --pagecache
+    struct EventRead
+    {
+        EventMain event;
+        uint64_t cacheHits; // pages found in the page cache
+        uint64_t cacheMisses; // pages added to it, including readahead
+    };
+
+    // struct path_filter_key_t, key of the LPM trie log_paths
+    struct PathFilterKey
+    {
+        static constexpr size_t MaxLength = 256;
+
+        uint32_t prefixLength; // bits
+        char data[MaxLength];
+    };
+
+    // index of the BPF_PERCPU_ARRAY lost_events
+    enum class LostIndex : int
+    {
+        Main = 0
+    };
+
+    // index of the BPF_PERCPU_ARRAY path_cache_stats
+    enum class PathCacheStat : int
+    {
+        Hits = 0,
+        Misses = 1
+    };
+
+    // map_index_t, the BPF_PERCPU_ARRAY map_stats holds the inserts at 2 * index and the deletes at 2 * index + 1
+    enum class MapIndex : int
+    {
+        Opened = 0,
+        Inodes = 1,
+        Save = 2,
+        SaveDelete = 3,
+        Aggregates = 4,
+        BlockRequests = 5
+    };
+}
+
+#endif // guard
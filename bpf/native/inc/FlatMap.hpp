@@ -0,0 +1,143 @@
+#ifndef FILEACCESS_FLATMAP_HPP
+#define FILEACCESS_FLATMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace FileAccess
+{
+    // Open addressing hash map with 64 bit keys (handle / inode uids) and linear probing.
+    // All entries live in one array, erase shifts following entries back, so there are no tombstones.
+    template<typename Value>
+    class FlatMap
+    {
+    public:
+        explicit FlatMap(size_t capacity = 1024)
+        {
+            size_t size = 16;
+            while (size < capacity * 2)
+            {
+                size *= 2;
+            }
+            slots.resize(size);
+        }
+
+        Value *find(uint64_t key)
+        {
+            for (size_t pos = Hash(key) & mask();; pos = (pos + 1) & mask())
+            {
+                Slot &slot = slots[pos];
+                if (!slot.used)
+                {
+                    return nullptr;
+                }
+                if (slot.key == key)
+                {
+                    return &slot.value;
+                }
+            }
+        }
+        bool contains(uint64_t key) { return find(key) != nullptr; }
+
+        // returns the value for key, default constructed if it is new
+        Value &operator[](uint64_t key)
+        {
+            if ((count + 1) * 2 > slots.size())
+            {
+                grow();
+            }
+            size_t pos = Hash(key) & mask();
+            for (; slots[pos].used; pos = (pos + 1) & mask())
+            {
+                if (slots[pos].key == key)
+                {
+                    return slots[pos].value;
+                }
+            }
+            slots[pos].used = true;
+            slots[pos].key = key;
+            count++;
+            return slots[pos].value;
+        }
+
+        bool erase(uint64_t key)
+        {
+            size_t pos = Hash(key) & mask();
+            for (; slots[pos].used && slots[pos].key != key; pos = (pos + 1) & mask());
+            if (!slots[pos].used)
+            {
+                return false;
+            }
+
+            // move following entries of the probe sequence into the gap
+            for (size_t next = (pos + 1) & mask(); slots[next].used; next = (next + 1) & mask())
+            {
+                size_t home = Hash(slots[next].key) & mask();
+                if (((next - home) & mask()) >= ((next - pos) & mask()))
+                {
+                    slots[pos].key = slots[next].key;
+                    slots[pos].value = std::move(slots[next].value);
+                    pos = next;
+                }
+            }
+            slots[pos].used = false;
+            slots[pos].value = Value();
+            count--;
+            return true;
+        }
+
+        size_t size() const { return count; }
+
+        // calls function(key, value) for all entries, in no particular order
+        template<typename Function>
+        void forEach(Function function) const
+        {
+            for (const auto &slot : slots)
+            {
+                if (slot.used)
+                {
+                    function(slot.key, slot.value);
+                }
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            uint64_t key = 0;
+            bool used = false;
+            Value value{};
+        };
+
+        static size_t Hash(uint64_t key)
+        {
+            // uids are sequential, spread them over the table (murmur3 finalizer)
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return key;
+        }
+        size_t mask() const { return slots.size() - 1; }
+
+        void grow()
+        {
+            std::vector<Slot> old(slots.size() * 2);
+            old.swap(slots);
+            count = 0;
+            for (auto &slot : old)
+            {
+                if (slot.used)
+                {
+                    (*this)[slot.key] = std::move(slot.value);
+                }
+            }
+        }
+
+        std::vector<Slot> slots;
+        size_t count = 0;
+    };
+}
+
+#endif // guard
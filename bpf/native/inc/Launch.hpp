@@ -0,0 +1,15 @@
+#ifndef FILEACCESS_LAUNCH_HPP
+#define FILEACCESS_LAUNCH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace FileAccess
+{
+    // Forks and starts the command line of -p stopped, calls track with its pid (to add it to the filter) and continues it.
+    // Returns the pid or -errno.
+    int LaunchProgram(const std::string &cmdline, const std::function<int(int32_t)> &track);
+}
+
+#endif // guard
@@ -0,0 +1,65 @@
+#ifndef FILEACCESS_OPTIONS_HPP
+#define FILEACCESS_OPTIONS_HPP
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FileAccess
+{
+    enum class OutputFormat
+    {
+        Text, // fixed width csv, same as fileaccess.py
+        Binary // LogFs::BinaryRecord (fuse/inc/LogFormat.hpp)
+    };
+
+    // Command line of fileaccess.py, see Usage() for the meaning of the options.
+    struct Options
+    {
+        bool noFilter = false;
+        std::vector<int32_t> pids;
+        std::string program;
+        std::vector<uint32_t> uids;
+        std::vector<uint32_t> gids;
+        std::vector<std::string> cgroups;
+        std::vector<std::string> paths;
+        std::string operations = "OCRWU";
+        bool includeChildren = false;
+        std::string output;
+        int time = 0;
+        std::vector<std::string> filesystems;
+
+        int depth = 10;
+        int bufSize = 64;
+        int pathOutput = 240;
+        int evBufMain = 8;
+        int wakeupFill = 25;
+        int wakeupTime = 10;
+        int pathCache = 16384;
+        int handles = 65536;
+        int inodes = 65536;
+        int inFlight = 10240;
+        int mapStats = 0;
+        bool aggregate = false;
+        bool aggregateOnly = false;
+        bool pageCache = false;
+        bool blockIo = false; // adds 'B' to operations
+        bool userModePathFilter = false;
+        bool fentry = false;
+        OutputFormat format = OutputFormat::Text;
+        std::string bpfSource = FILEACCESS_BPF_SOURCE;
+
+        bool printOnly = false;
+        bool compileOnly = false;
+
+        // aggregates ('r' / 'w') are logged with their operation
+        bool logs(char operation) const { return operations.find(std::toupper(static_cast<unsigned char>(operation))) != std::string::npos; }
+    };
+
+    // returns 0 on success, 1 if the program should exit successfully (help) and -EINVAL on invalid arguments
+    int ParseOptions(int argc, char *argv[], Options &options);
+    void Usage(const char *name);
+}
+
+#endif // guard
@@ -0,0 +1,40 @@
+#ifndef FILEACCESS_OUTPUT_HPP
+#define FILEACCESS_OUTPUT_HPP
+
+#include <Events.hpp>
+#include <Options.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace FileAccess
+{
+    // Buffered writer of the trace records.
+    // Text is the fixed width csv of fileaccess.py (and logfs), formatted by hand since snprintf dominated the profile.
+    class Output
+    {
+    public:
+        Output(OutputFormat format, int pathSize, int fd);
+        ~Output();
+
+        void header();
+        // times of event are CLOCK_MONOTONIC, rtDelta converts them to realtime
+        void write(const EventMain &event, std::string_view path, uint64_t rtDelta);
+        int flush();
+
+        static constexpr size_t BufferSize = 1 << 20;
+
+    private:
+        void writeText(const EventMain &event, std::string_view path, uint64_t rtDelta);
+        void writeBinary(const EventMain &event, std::string_view path, uint64_t rtDelta);
+
+        OutputFormat format;
+        size_t pathSize;
+        int fd;
+        std::vector<char> buffer;
+        size_t used = 0;
+    };
+}
+
+#endif // guard
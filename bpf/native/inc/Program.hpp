@@ -0,0 +1,49 @@
+#ifndef FILEACCESS_PROGRAM_HPP
+#define FILEACCESS_PROGRAM_HPP
+
+#include <Events.hpp>
+#include <Options.hpp>
+
+#include <bcc/BPF.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FileAccess
+{
+    // The BPF program of testdir/bpf.cpp, compiled with BCC and configured exactly like fileaccess.py does.
+    class Program
+    {
+    public:
+        ~Program();
+
+        static bool FentrySupported(); // kernel BTF is available
+        // reads the BPF source and applies the options as text replacements, returns an empty string on error
+        static std::string Source(const Options &options);
+
+        int load(const std::string &source);
+        int attach(const Options &options);
+        int setFilters(const Options &options);
+        int startProgram(const Options &options); // forks and starts -p, returns the pid
+
+        int tableFd(const std::string &name);
+        uint64_t lost(LostIndex index) { return sum("lost_events", static_cast<int>(index)); }
+        uint64_t pathCacheStat(PathCacheStat stat) { return sum("path_cache_stats", static_cast<int>(stat)); }
+        uint64_t mapInserts(MapIndex map) { return sum("map_stats", 2 * static_cast<int>(map)); }
+        uint64_t mapDeletes(MapIndex map) { return sum("map_stats", 2 * static_cast<int>(map) + 1); }
+        uint64_t mapEntries(const std::string &table); // iterates the keys
+
+    private:
+        int attachKprobe(const std::string &event, const std::string &function, bool ret, bool optional = false);
+        int attachKfunc(const std::string &function, bool ret); // KFUNC_PROBE / KRETFUNC_PROBE of function
+        uint64_t sum(const std::string &table, int index); // sum of a BPF_PERCPU_ARRAY entry over all cpus
+        template<typename Key>
+        int fillSet(const std::string &table, const std::vector<Key> &keys);
+
+        std::unique_ptr<ebpf::BPF> bpf;
+        std::vector<int> links; // of the fentry / fexit programs
+    };
+}
+
+#endif // guard
@@ -0,0 +1,145 @@
+#ifndef FILEACCESS_TASKINDEX_HPP
+#define FILEACCESS_TASKINDEX_HPP
+
+#include <FlatMap.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// pid -> cgroup -> task index of cgroup-informer-core. It is kept as a snapshot (tasks.snap) and a delta log (tasks.delta) of the
+// changes since, both sequences of TaskRecords. Every snapshot starts a new delta log. Tools load both with TaskIndex (or the C API
+// below) and resolve pids in O(1).
+namespace FileAccess
+{
+    // Labels of a container, the columns of pid_pods.csv of pidfinder.
+    struct TaskLabels
+    {
+        enum Label
+        {
+            PodName = 0,
+            ContainerName,
+            PodNamespace,
+            App,
+            NextflowRunName,
+            NextflowProcessName,
+            NextflowSessionId,
+            NextflowTaskName,
+            Count
+        };
+        static constexpr const char *Names[Count] =
+        {
+            "PodName", "ContainerName", "PodNamespace", "App", "NextflowRunName", "NextflowProcessName", "NextflowSessionID", "NextflowTaskName"
+        };
+
+        std::string values[Count];
+
+        bool operator==(const TaskLabels &other) const = default;
+    };
+
+    // Record of the snapshot and the delta log, 'L' records are followed by uint16_t lengths[TaskLabels::Count] and the labels.
+    // Records are padded to a multiple of 8 bytes, times are realtime ns.
+    struct TaskRecord
+    {
+        enum Type : char
+        {
+            Fork = 'F', // pid forked from ppid in cgroupId at time
+            Exit = 'E', // pid exited at time
+            Move = 'M', // pid found in cgroupId (containers are moved to their cgroup after the fork)
+            Labels = 'L', // labels of the cgroupId
+            Process = 'P' // snapshot of pid: started at time (0 if before tracing), exited at end (0 if running)
+        };
+
+        uint16_t length; // of the whole record including labels and padding
+        char type;
+        uint8_t reserved;
+        int32_t pid;
+        int32_t ppid;
+        uint32_t reserved2;
+        uint64_t time;
+        uint64_t end;
+        uint64_t cgroupId;
+
+        static constexpr uint16_t Align = 8;
+    };
+
+    static_assert(sizeof(TaskRecord) == 40, "TaskRecord layout changed.");
+
+    // Header of tasks.snap and tasks.delta.
+    struct TaskIndexHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t time; // realtime ns of the start of the delta log, the snapshot has that of the delta log that continues it
+        uint64_t deltaOffset; // snapshot: replaying tasks.delta starts there
+
+        static constexpr char SnapshotMagic[8] = { 'T', 'A', 'S', 'K', 'S', 'N', 'A', 'P' };
+        static constexpr char DeltaMagic[8] = { 'T', 'A', 'S', 'K', 'D', 'E', 'L', 'T' };
+        static constexpr uint32_t Version = 2;
+    };
+
+    class TaskIndex
+    {
+    public:
+        // one lifetime of a pid
+        struct Process
+        {
+            int32_t ppid = 0;
+            uint64_t cgroupId = 0;
+            uint64_t start = 0;
+            uint64_t end = 0; // 0 if running
+        };
+
+        static constexpr const char SnapshotFile[] = "tasks.snap";
+        static constexpr const char DeltaFile[] = "tasks.delta";
+
+        // encodes a record, labels only for 'L'
+        static std::string Encode(const TaskRecord &record, const TaskLabels *labels = nullptr);
+
+        // loads the snapshot of dir and replays its delta log, returns -errno if neither exists. A delta log of another time than
+        // the snapshot is one it contains (a new one is about to replace it) and skipped.
+        int load(const std::string &dir);
+        // replays records the delta log got since the last load / reload, loads again if a snapshot started a new one
+        int reload();
+        // writes the snapshot atomically, continued by the delta log started at deltaStart
+        int writeSnapshot(const std::string &dir, uint64_t deltaStart) const;
+
+        void apply(const TaskRecord &record, const TaskLabels *labels = nullptr);
+
+        // the lifetime of pid at time (0: the latest one), nullptr if unknown
+        const Process *find(int32_t pid, uint64_t time = 0);
+        const TaskLabels *labels(uint64_t cgroupId);
+        const TaskLabels *labels(int32_t pid, uint64_t time = 0);
+        bool alive(int32_t pid) { const Process *process = find(pid); return process != nullptr && process->end == 0; }
+
+        size_t pids() const { return processes.size(); }
+        size_t cgroups() const { return labelIndex.size(); }
+
+    private:
+        // applies the records of data, returns the bytes used (complete records)
+        size_t replay(std::string_view data);
+
+        FlatMap<std::vector<Process>> processes; // by pid, oldest lifetime first
+        FlatMap<uint32_t> labelIndex; // cgroup id -> index in labelSets
+        std::vector<TaskLabels> labelSets;
+        std::vector<uint64_t> labelCgroups; // cgroup id of labelSets[i]
+        std::string dir;
+        uint64_t deltaStart = 0; // time of the delta log replayed
+        uint64_t deltaRead = 0;
+    };
+}
+
+// C API of libtaskindex, e.g. for ctypes. Times are realtime ns, 0 for the latest lifetime of the pid.
+extern "C"
+{
+    void *taskindex_open(const char *dir); // nullptr on error
+    int taskindex_reload(void *index);
+    void taskindex_close(void *index);
+    uint64_t taskindex_cgroup(void *index, int32_t pid, uint64_t time); // 0 if unknown
+    const char *taskindex_label(void *index, int32_t pid, uint64_t time, int label); // TaskLabels::Label, nullptr if unknown
+}
+
+#endif // guard
@@ -0,0 +1,47 @@
+#ifndef FILEACCESS_TASKTRACKER_HPP
+#define FILEACCESS_TASKTRACKER_HPP
+
+#include <TaskIndex.hpp>
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace FileAccess
+{
+    // Keeps the TaskIndex of cgroup-informer-core up to date: applies forks / exits and the labels of pid_pods.csv and writes
+    // them to the delta log, snapshots are written on request and start a new delta log.
+    class TaskTracker
+    {
+    public:
+        ~TaskTracker();
+
+        // resumes the index in dir if there is one (writing a snapshot of it), labelsPath may be empty
+        int open(const std::string &dir, const std::string &labelsPath);
+        // adds the running processes not known yet (started before the informer)
+        void scanProcesses();
+        // rereads the labels file if it changed
+        void refreshLabels();
+        // writes the snapshot and replaces the delta log by an empty one
+        int snapshot();
+
+        void fork(uint64_t time, int32_t ppid, int32_t pid, uint64_t cgroupId);
+        void exit(uint64_t time, int32_t pid);
+
+        TaskIndex &tasks() { return index; }
+
+    private:
+        void append(const TaskRecord &record, const TaskLabels *labels = nullptr);
+
+        TaskIndex index;
+        std::string dir;
+        std::string labelsPath;
+        timespec labelsModified{};
+        int deltaFd = -1;
+    };
+
+    // cgroup v2 id of pid (the inode of its cgroup directory), 0 if it does not exist anymore
+    uint64_t CgroupId(int32_t pid);
+}
+
+#endif // guard
@@ -0,0 +1,297 @@
+// Native counterpart of cgroup_informer.py on the precompiled CO-RE program core/cgroup_informer.bpf.c, same options and output.
+// With --index it also keeps the pid -> cgroup -> task index of TaskIndex.hpp.
+#include <TaskTracker.hpp>
+#include <cgroup_informer.skel.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <getopt.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    constexpr size_t CgroupFilterMax = 64; // of core/cgroup_informer.bpf.c
+
+    // same as event_main_t of core/cgroup_informer.bpf.c
+    struct Event
+    {
+        uint64_t time;
+        uint32_t ppid;
+        uint32_t pid;
+        uint64_t cgroupId;
+        uint8_t type;
+    };
+
+    enum LongOption
+    {
+        OptEvBufMain = 256,
+        OptWakeupFill,
+        OptWakeupTime,
+        OptIndex,
+        OptLabels,
+        OptSnapshot
+    };
+
+    const option LongOptions[] =
+    {
+        { "output",     required_argument, nullptr, 'O' },
+        { "header",     no_argument,       nullptr, 'H' },
+        { "cgroup",     required_argument, nullptr, 'C' },
+        { "evbufmain",  required_argument, nullptr, OptEvBufMain },
+        { "wakeupfill", required_argument, nullptr, OptWakeupFill },
+        { "wakeuptime", required_argument, nullptr, OptWakeupTime },
+        { "index",      required_argument, nullptr, OptIndex },
+        { "labels",     required_argument, nullptr, OptLabels },
+        { "snapshot",   required_argument, nullptr, OptSnapshot },
+        { "help",       no_argument,       nullptr, 'h' },
+        { nullptr,      0,                 nullptr, 0 }
+    };
+
+    volatile sig_atomic_t Running = 1;
+
+    void Stop(int)
+    {
+        Running = 0;
+    }
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-O OUTPUT] [-H] [-C CGROUPS] [--evbufmain N] [--wakeupfill PERCENT] [--wakeuptime MS]\n"
+            "       [--index DIR [--labels PID_PODS_CSV] [--snapshot SEC]]\n"
+            "Trace process starts, see cgroup_informer.py. --index keeps the pid -> cgroup -> task index in DIR.\n";
+    }
+
+    struct Informer
+    {
+        FILE *output = stdout;
+        bool haveDelta = false;
+        int64_t rtDelta = 0;
+        FileAccess::TaskTracker *tracker = nullptr;
+
+        static int Handle(void *ctx, void *data, size_t size)
+        {
+            auto *informer = static_cast<Informer*>(ctx);
+            if (size < sizeof(Event))
+            {
+                return 0;
+            }
+            Event event;
+            ::memcpy(&event, data, sizeof(event)); // ring buffer records are only 8 byte aligned
+
+            if (!informer->haveDelta)
+            {
+                timespec now{};
+                ::clock_gettime(CLOCK_REALTIME, &now);
+                informer->rtDelta = now.tv_sec * 1000000000LL + now.tv_nsec - static_cast<int64_t>(event.time);
+                informer->haveDelta = true;
+            }
+            int64_t time = event.time + informer->rtDelta;
+            if (event.type == 'E')
+            {
+                if (informer->tracker != nullptr)
+                {
+                    informer->tracker->exit(time, event.pid);
+                }
+                return 0;
+            }
+            if (informer->tracker != nullptr)
+            {
+                informer->tracker->fork(time, event.ppid, event.pid, event.cgroupId);
+            }
+            std::fprintf(informer->output, "%20lld.%03lld,%11u,%11u,%20llu\n", static_cast<long long>(time / 1000), static_cast<long long>(time % 1000),
+                event.ppid, event.pid, static_cast<unsigned long long>(event.cgroupId));
+            return 0;
+        }
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    std::string outputPath;
+    bool header = false;
+    std::vector<std::string> cgroups;
+    int evBufMain = 8;
+    int wakeupFill = 25;
+    int wakeupTime = 10;
+    std::string indexDir;
+    std::string labelsPath;
+    int snapshotInterval = 60;
+
+    for (int c; (c = ::getopt_long(argc, argv, "O:HC:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'O':
+            outputPath = optarg;
+            break;
+        case 'H':
+            header = true;
+            break;
+        case 'C':
+        {
+            std::stringstream stream(optarg);
+            for (std::string item; std::getline(stream, item, ',');)
+            {
+                cgroups.push_back(item);
+            }
+            break;
+        }
+        case OptEvBufMain:
+            evBufMain = std::atoi(optarg);
+            break;
+        case OptWakeupFill:
+            wakeupFill = std::atoi(optarg);
+            break;
+        case OptWakeupTime:
+            wakeupTime = std::atoi(optarg);
+            break;
+        case OptIndex:
+            indexDir = optarg;
+            break;
+        case OptLabels:
+            labelsPath = optarg;
+            break;
+        case OptSnapshot:
+            snapshotInterval = std::atoi(optarg);
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (cgroups.size() > CgroupFilterMax)
+    {
+        std::cerr << "At most " << CgroupFilterMax << " cgroups are supported." << std::endl;
+        return 2;
+    }
+    if (!labelsPath.empty() && indexDir.empty())
+    {
+        std::cerr << "--labels needs --index." << std::endl;
+        return 2;
+    }
+
+    FileAccess::TaskTracker tracker;
+    if (!indexDir.empty() && tracker.open(indexDir, labelsPath) != 0)
+    {
+        return 1;
+    }
+
+    cgroup_informer_bpf *skel = ::cgroup_informer_bpf__open();
+    if (skel == nullptr)
+    {
+        std::cerr << "Opening the BPF object failed (" << -errno << ")." << std::endl;
+        return 1;
+    }
+    skel->rodata->cgroup_filter_size = cgroups.size();
+    skel->rodata->rb_wakeup_bytes = static_cast<int64_t>(evBufMain) * ::sysconf(_SC_PAGESIZE) * wakeupFill / 100;
+    skel->rodata->rb_wakeup_ns = static_cast<int64_t>(wakeupTime) * 1000000;
+    skel->rodata->track_exits = !indexDir.empty();
+    ::bpf_map__set_max_entries(skel->maps.event_main, evBufMain * ::sysconf(_SC_PAGESIZE));
+    ::bpf_map__set_max_entries(skel->maps.log_cgroups, std::max<size_t>(cgroups.size(), 1));
+
+    int res = ::cgroup_informer_bpf__load(skel);
+    for (uint32_t i = 0; res == 0 && i < cgroups.size(); i++)
+    {
+        int cgroup = ::open(cgroups[i].c_str(), O_RDONLY | O_CLOEXEC);
+        res = (cgroup < 0) ? -errno : ::bpf_map_update_elem(::bpf_map__fd(skel->maps.log_cgroups), &i, &cgroup, BPF_ANY);
+        if (cgroup >= 0)
+        {
+            ::close(cgroup);
+        }
+        if (res != 0)
+        {
+            std::cerr << "Adding cgroup " << cgroups[i] << " failed (" << res << ")." << std::endl;
+        }
+    }
+    if (res == 0)
+    {
+        res = ::cgroup_informer_bpf__attach(skel);
+    }
+    if (res != 0)
+    {
+        std::cerr << "Starting the BPF program failed (" << res << ")." << std::endl;
+        ::cgroup_informer_bpf__destroy(skel);
+        return 1;
+    }
+
+    Informer informer;
+    if (!indexDir.empty())
+    {
+        informer.tracker = &tracker;
+        tracker.scanProcesses(); // after attaching, so no process is missed
+        tracker.refreshLabels();
+    }
+    if (!outputPath.empty() && (informer.output = std::fopen(outputPath.c_str(), "w")) == nullptr)
+    {
+        std::cerr << "Could not open " << outputPath << "." << std::endl;
+        ::cgroup_informer_bpf__destroy(skel);
+        return 1;
+    }
+    ring_buffer *rb = ::ring_buffer__new(::bpf_map__fd(skel->maps.event_main), Informer::Handle, &informer, nullptr);
+    if (rb == nullptr)
+    {
+        std::cerr << "Opening the ring buffer failed." << std::endl;
+        ::cgroup_informer_bpf__destroy(skel);
+        return 1;
+    }
+
+    std::signal(SIGINT, Stop);
+    std::signal(SIGTERM, Stop);
+    if (header)
+    {
+        std::fprintf(informer.output, "time, ppid, pid, cgroupid\n");
+    }
+    time_t lastSnapshot = std::time(nullptr);
+    while (Running)
+    {
+        res = ::ring_buffer__poll(rb, 100);
+        if (res < 0 && res != -EINTR)
+        {
+            std::cerr << "Polling the ring buffer failed (" << res << ")." << std::endl;
+            break;
+        }
+        ::ring_buffer__consume(rb); // records submitted without wakeup
+        std::fflush(informer.output);
+
+        if (informer.tracker != nullptr)
+        {
+            tracker.refreshLabels();
+            if (std::time(nullptr) - lastSnapshot >= snapshotInterval)
+            {
+                lastSnapshot = std::time(nullptr);
+                if (int snapshot = tracker.snapshot(); snapshot != 0)
+                {
+                    std::cerr << "Writing the snapshot failed (" << snapshot << ")." << std::endl;
+                }
+            }
+        }
+    }
+    ::ring_buffer__consume(rb);
+    if (informer.tracker != nullptr)
+    {
+        tracker.snapshot();
+    }
+    ::ring_buffer__free(rb);
+    ::cgroup_informer_bpf__destroy(skel);
+    if (informer.output != stdout)
+    {
+        std::fclose(informer.output);
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <Consumer.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <cstring>
+#include <ctime>
+
+namespace FileAccess
+{
+    namespace
+    {
+        uint64_t Monotonic()
+        {
+            timespec now{};
+            ::clock_gettime(CLOCK_MONOTONIC, &now);
+            return now.tv_sec * 1000000000ULL + now.tv_nsec;
+        }
+
+        uint64_t GetRtDelta()
+        {
+            // bpf_ktime_get_ns is CLOCK_MONOTONIC
+            timespec rt{}, mono{};
+            ::clock_gettime(CLOCK_REALTIME, &rt);
+            ::clock_gettime(CLOCK_MONOTONIC, &mono);
+            return (rt.tv_sec - mono.tv_sec) * 1000000000ULL + rt.tv_nsec - mono.tv_nsec;
+        }
+
+        void AppendNumber(std::string &path, uint64_t value, char separator)
+        {
+            char digits[20];
+            auto res = std::to_chars(std::begin(digits), std::end(digits), value);
+            path.append(digits, res.ptr);
+            if (separator != '\0')
+            {
+                path += separator;
+            }
+        }
+    }
+
+    Consumer::Consumer(const Options &options, Output &output) :
+        options(options),
+        output(output),
+        rtDelta(GetRtDelta())
+    {
+    }
+
+    int Consumer::HandleMain(void *ctx, void *data, size_t size)
+    {
+        auto *consumer = static_cast<Consumer*>(ctx);
+        if (size < sizeof(EventMain))
+        {
+            return 0;
+        }
+        EventMain event;
+        ::memcpy(&event, data, sizeof(event)); // ring buffer records are only 8 byte aligned
+
+        std::string_view path;
+        if ((event.type == 'O' || event.type == 'U') && size >= EventPath::DataOffset)
+        {
+            const auto *record = static_cast<const EventPath*>(data);
+            uint64_t pathId;
+            uint16_t reference;
+            ::memcpy(&pathId, &record->pathId, sizeof(pathId));
+            ::memcpy(&reference, &record->pathReference, sizeof(reference));
+            if (reference != 0)
+            {
+                const std::string *known = consumer->paths.find(pathId);
+                if (known == nullptr)
+                {
+                    consumer->unknownReferences++;
+                }
+                consumer->handleMain(event, (known != nullptr) ? std::string_view(*known) : std::string_view("::"));
+                return 0;
+            }
+
+            std::string_view names(record->data(), size - EventPath::DataOffset);
+            std::string &joined = consumer->path;
+            joined.clear();
+            for (int i = 0; i < 3; i++)
+            {
+                size_t length = std::min<size_t>(record->pathLength[i], names.size());
+                AppendDentries(joined, names.substr(0, length));
+                names.remove_prefix(length);
+                if (i != 2)
+                {
+                    joined += ':';
+                }
+            }
+            path = joined;
+            if (pathId != 0)
+            {
+                consumer->paths[pathId] = joined;
+            }
+        }
+        else if ((event.type == 'r' || event.type == 'w') && size >= sizeof(EventAggregate))
+        {
+            EventAggregate aggregate;
+            ::memcpy(&aggregate, data, sizeof(aggregate));
+            consumer->path.clear();
+            AppendAggregate(consumer->path, aggregate, consumer->options.pageCache);
+            path = consumer->path;
+        }
+        else if (event.type == 'R' && size >= sizeof(EventRead))
+        {
+            // same as fileaccess.py: "hits:misses"
+            EventRead read;
+            ::memcpy(&read, data, sizeof(read));
+            consumer->path.clear();
+            AppendNumber(consumer->path, read.cacheHits, ':');
+            AppendNumber(consumer->path, read.cacheMisses, '\0');
+            path = consumer->path;
+        }
+        consumer->handleMain(event, path);
+        return 0;
+    }
+
+    void Consumer::AppendDentries(std::string &path, std::string_view names)
+    {
+        // names is "file\0dir\0/\0", walk it backwards
+        while (!names.empty())
+        {
+            names.remove_suffix(1); // null of the last name
+            size_t start = names.rfind('\0');
+            start = (start == std::string_view::npos) ? 0 : start + 1;
+            std::string_view name = names.substr(start);
+            if (name != "/")
+            {
+                path += '/';
+                path += name;
+            }
+            names.remove_suffix(names.size() - start);
+        }
+    }
+
+    void Consumer::AppendAggregate(std::string &path, const EventAggregate &aggregate, bool pageCache)
+    {
+        // same as fileaccess.py: "offset_end:busy:errors:bucket0/.../bucket7", with --pagecache followed by ":hits:misses"
+        AppendNumber(path, aggregate.offsetEnd, ':');
+        AppendNumber(path, aggregate.busy, ':');
+        AppendNumber(path, aggregate.errors, ':');
+        for (int i = 0; i < EventAggregate::Buckets; i++)
+        {
+            AppendNumber(path, aggregate.histogram[i], (i + 1 < EventAggregate::Buckets) ? '/' : '\0');
+        }
+        if (pageCache)
+        {
+            path += ':';
+            AppendNumber(path, aggregate.cacheHits, ':');
+            AppendNumber(path, aggregate.cacheMisses, '\0');
+        }
+    }
+
+    bool Consumer::pathAllowed(std::string_view path) const
+    {
+        for (const auto &prefix : options.paths)
+        {
+            if (path.starts_with(prefix))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Consumer::handleMain(const EventMain &event, std::string_view eventPath)
+    {
+        mainCount++;
+        if (event.type != 'r' && event.type != 'w') // the end of an aggregate is that of its last operation
+        {
+            uint64_t latency = Monotonic() - event.timeEnd;
+            latencyCount++;
+            latencySum += latency;
+            latencyMaximum = std::max(latencyMaximum, latency);
+        }
+        bool pathFilter = options.userModePathFilter && !options.paths.empty();
+        bool unlinkOk = false;
+
+        if (event.type == 'O')
+        {
+            if (pathFilter && pathAllowed(eventPath))
+            {
+                allowedHandles[event.handleUid] = 1;
+            }
+        }
+        else if (event.type == 'U')
+        {
+            unlinkOk = pathFilter && pathAllowed(eventPath);
+        }
+
+        if (options.logs(event.type) && (!pathFilter || allowedHandles.contains(event.handleUid) || unlinkOk))
+        {
+            output.write(event, eventPath, rtDelta);
+        }
+
+        if (event.type == 'C' && !options.paths.empty())
+        {
+            allowedHandles.erase(event.handleUid);
+        }
+    }
+}
@@ -0,0 +1,352 @@
+#include <CoreProgram.hpp>
+#include <Launch.hpp>
+
+#include <fileaccess.skel.h>
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace FileAccess
+{
+    namespace
+    {
+        bool Quiet = false; // while attaching optional probes
+
+        int Print(libbpf_print_level level, const char *format, va_list args)
+        {
+            if (Quiet || level == LIBBPF_DEBUG)
+            {
+                return 0;
+            }
+            return std::vfprintf(stderr, format, args);
+        }
+    }
+
+    CoreProgram::~CoreProgram()
+    {
+        for (bpf_link *link : links)
+        {
+            ::bpf_link__destroy(link);
+        }
+        ::fileaccess_bpf__destroy(skel);
+    }
+
+    int CoreProgram::load(const Options &options)
+    {
+        unsigned pathBufSize = std::bit_ceil(static_cast<unsigned>(3 * options.depth * options.bufSize));
+        if (options.depth > PathDepthMax || options.bufSize > FilenameBufSizeMax || pathBufSize > PathBufSizeMax)
+        {
+            std::cerr << "--depth (max " << PathDepthMax << ") and --bufsize (max " << FilenameBufSizeMax << ") exceed the path buffer of the "
+                "precompiled program (" << PathBufSizeMax << " bytes for 3 * depth * bufsize)." << std::endl;
+            return -EINVAL;
+        }
+        if (options.cgroups.size() > CgroupFilterMax)
+        {
+            std::cerr << "At most " << CgroupFilterMax << " cgroups are supported by the precompiled program." << std::endl;
+            return -EINVAL;
+        }
+
+        ::libbpf_set_print(Print);
+        skel = ::fileaccess_bpf__open();
+        if (skel == nullptr)
+        {
+            std::cerr << "Opening the BPF object failed (" << -errno << ")." << std::endl;
+            return -EINVAL;
+        }
+
+        // same values as Program::Source replaces
+        auto *config = skel->rodata;
+        config->filter_by_pid = !options.program.empty() || !options.pids.empty();
+        config->include_child_processes = options.includeChildren;
+        config->filter_by_uid = !options.uids.empty();
+        config->filter_by_gid = !options.gids.empty();
+        config->filter_by_path = !options.paths.empty() && !options.userModePathFilter;
+        config->cgroup_filter_size = options.cgroups.size();
+        config->log_deletes = options.logs('U');
+        config->log_reads = options.logs('R');
+        config->log_writes = options.logs('W');
+        config->aggregate_readwrites = options.aggregate;
+        config->submit_readwrites = !options.aggregateOnly;
+        config->track_page_cache = options.pageCache;
+        config->path_depth = options.depth;
+        config->filename_bufsize = options.bufSize;
+        config->path_bufsize = pathBufSize;
+        config->path_cache_enabled = options.pathCache > 0;
+        config->rb_wakeup_bytes = static_cast<int64_t>(options.evBufMain) * ::sysconf(_SC_PAGESIZE) * options.wakeupFill / 100;
+        config->rb_wakeup_ns = static_cast<int64_t>(options.wakeupTime) * 1000000;
+
+        ::bpf_map__set_max_entries(skel->maps.event_main, options.evBufMain * ::sysconf(_SC_PAGESIZE));
+        ::bpf_map__set_max_entries(skel->maps.log_cgroups, std::max<size_t>(options.cgroups.size(), 1));
+        ::bpf_map__set_max_entries(skel->maps.path_cache, std::max(options.pathCache, 1));
+        ::bpf_map__set_max_entries(skel->maps.opened, options.handles);
+        ::bpf_map__set_max_entries(skel->maps.aggregates, options.handles);
+        ::bpf_map__set_max_entries(skel->maps.inodes, options.inodes);
+        ::bpf_map__set_max_entries(skel->maps.save, options.inFlight);
+        ::bpf_map__set_max_entries(skel->maps.save_delete, options.inFlight);
+        ::bpf_map__set_max_entries(skel->maps.block_requests, options.inFlight);
+
+        if (int res = ::fileaccess_bpf__load(skel); res != 0)
+        {
+            std::cerr << "Loading the BPF program failed (" << res << ")." << std::endl;
+            return -EINVAL;
+        }
+        return 0;
+    }
+
+    int CoreProgram::attachKprobe(const std::string &event, const std::string &function, bool ret, bool optional)
+    {
+        bpf_program *program = ::bpf_object__find_program_by_name(skel->obj, function.c_str());
+        Quiet = optional;
+        bpf_link *link = (program != nullptr) ? ::bpf_program__attach_kprobe(program, ret, event.c_str()) : nullptr;
+        Quiet = false;
+        if (link == nullptr)
+        {
+            // on newer / older kernels some of the functions don't exist, ignoring them is fine
+            if (optional)
+            {
+                return 0;
+            }
+            std::cerr << "Attaching " << function << " to " << event << " failed." << std::endl;
+            return -EINVAL;
+        }
+        links.push_back(link);
+        return 1;
+    }
+
+    int CoreProgram::attachTracepoint(const std::string &category, const std::string &event, const std::string &function)
+    {
+        bpf_program *program = ::bpf_object__find_program_by_name(skel->obj, function.c_str());
+        bpf_link *link = (program != nullptr) ? ::bpf_program__attach_tracepoint(program, category.c_str(), event.c_str()) : nullptr;
+        if (link == nullptr)
+        {
+            std::cerr << "Attaching " << event << " failed." << std::endl;
+            return -EINVAL;
+        }
+        links.push_back(link);
+        return 1;
+    }
+
+    int CoreProgram::attach(const Options &options)
+    {
+        // same probes as Program::attach without --fentry
+        int res = 0;
+        if (!options.filesystems.empty())
+        {
+            for (const auto &fs : options.filesystems)
+            {
+                std::cerr << "Attaching to fs " << fs << "..." << std::endl;
+                if (attachKprobe(fs + "_open", "open_with_file", false, true) > 0)
+                {
+                    std::cerr << fs << "_open attached" << std::endl;
+                }
+                if (attachKprobe(fs + "_file_open", "open_with_file", false, true) > 0)
+                {
+                    std::cerr << fs << "_file_open attached" << std::endl;
+                }
+            }
+        }
+        else
+        {
+            std::cerr << "Attaching to all filesystems." << std::endl;
+            res |= attachKprobe("vfs_open", "open_with_file", false);
+            res |= attachKprobe("do_filp_open", "open_without_file", false);
+            res |= attachKprobe("do_file_open_root", "open_without_file", false);
+        }
+
+        res |= attachKprobe("vfs_open", "ret_open_without_file", true);
+        res |= attachKprobe("do_filp_open", "ret_open_returning_file", true);
+        res |= attachKprobe("do_file_open_root", "ret_open_returning_file", true);
+
+        if (options.logs('R'))
+        {
+            res |= attachKprobe("vfs_read", "retprobe_readwrites", true);
+            res |= attachKprobe("vfs_read", "probe_vfs_read", false);
+            attachKprobe("do_iter_read", "retprobe_readwrites", true, true);
+            attachKprobe("do_iter_read", "probe_do_iter_read", false, true);
+            attachKprobe("vfs_iocb_iter_read", "retprobe_readwrites", true, true);
+            attachKprobe("vfs_iocb_iter_read", "probe_vfs_iocb_iter_read", false, true);
+        }
+        if (options.logs('W'))
+        {
+            res |= attachKprobe("vfs_write", "retprobe_readwrites", true);
+            res |= attachKprobe("vfs_write", "probe_vfs_write", false);
+            attachKprobe("do_iter_write", "retprobe_readwrites", true, true);
+            attachKprobe("do_iter_write", "probe_do_iter_write", false, true);
+            attachKprobe("vfs_iocb_iter_write", "retprobe_readwrites", true, true);
+            attachKprobe("vfs_iocb_iter_write", "probe_vfs_iocb_iter_write", false, true);
+        }
+        if (options.logs('R') || options.logs('W'))
+        {
+            attachKprobe("do_iter_readv_writev", "retprobe_readwrites", true, true);
+            attachKprobe("do_iter_readv_writev", "probe_do_iter_readv_writev", false, true);
+        }
+
+        if (options.pageCache && options.logs('R'))
+        {
+            if (attachKprobe("folio_mark_accessed", "probe_page_accessed", false, true) == 0)
+            {
+                res |= attachKprobe("mark_page_accessed", "probe_page_accessed", false);
+            }
+            if (attachKprobe("filemap_add_folio", "probe_page_added", false, true) == 0)
+            {
+                res |= attachKprobe("add_to_page_cache_lru", "probe_page_added", false);
+            }
+        }
+
+        if (options.blockIo)
+        {
+            res |= attachKprobe("blk_mq_start_request", "probe_block_issue", false);
+            bpf_program *program = ::bpf_object__find_program_by_name(skel->obj, "raw_tracepoint_block_rq_complete");
+            bpf_link *link = (program != nullptr) ? ::bpf_program__attach_raw_tracepoint(program, "block_rq_complete") : nullptr;
+            if (link == nullptr)
+            {
+                std::cerr << "Attaching block_rq_complete failed." << std::endl;
+                res |= -EINVAL;
+            }
+            else
+            {
+                links.push_back(link);
+            }
+        }
+
+        res |= attachKprobe("filp_close", "probe_filp_close", false);
+        res |= attachKprobe("filp_close", "retprobe_filp_close", true);
+        res |= attachKprobe("vfs_unlink", "probe_vfs_unlink", false);
+        res |= attachKprobe("vfs_unlink", "retprobe_vfs_unlink", true);
+        if (options.pathCache > 0)
+        {
+            res |= attachKprobe("vfs_rename", "probe_vfs_rename", false);
+            res |= attachKprobe("vfs_rename", "retprobe_vfs_rename", true);
+        }
+        // cleans up after exited threads, also removes them from the pid filter
+        res |= attachTracepoint("sched", "sched_process_exit", "tracepoint_sched_process_exit");
+        if ((!options.program.empty() || !options.pids.empty()) && options.includeChildren)
+        {
+            res |= attachTracepoint("sched", "sched_process_fork", "tracepoint_sched_process_fork");
+        }
+        return (res < 0) ? -EINVAL : 0;
+    }
+
+    template<typename Key>
+    int CoreProgram::fillSet(const std::string &table, const std::vector<Key> &keys)
+    {
+        int fd = tableFd(table);
+        uint8_t one = 1;
+        for (const auto &key : keys)
+        {
+            if (::bpf_map_update_elem(fd, &key, &one, BPF_ANY) != 0)
+            {
+                std::cerr << "Updating " << table << " failed (" << -errno << ")." << std::endl;
+                return -EINVAL;
+            }
+        }
+        return 0;
+    }
+
+    int CoreProgram::setFilters(const Options &options)
+    {
+        if (!options.pids.empty())
+        {
+            if (int res = fillSet("log_pids", options.pids); res != 0)
+            {
+                return res;
+            }
+        }
+        if (!options.uids.empty())
+        {
+            if (int res = fillSet("log_uids", options.uids); res != 0)
+            {
+                return res;
+            }
+        }
+        if (!options.gids.empty())
+        {
+            if (int res = fillSet("log_gids", options.gids); res != 0)
+            {
+                return res;
+            }
+        }
+        int cgroupsFd = tableFd("log_cgroups");
+        for (uint32_t i = 0; i < options.cgroups.size(); i++)
+        {
+            int cgroup = ::open(options.cgroups[i].c_str(), O_RDONLY | O_CLOEXEC);
+            int res = (cgroup < 0) ? -errno : ::bpf_map_update_elem(cgroupsFd, &i, &cgroup, BPF_ANY);
+            if (cgroup >= 0)
+            {
+                ::close(cgroup);
+            }
+            if (res != 0)
+            {
+                std::cerr << "Adding cgroup " << options.cgroups[i] << " failed (" << res << ")." << std::endl;
+                return -EINVAL;
+            }
+        }
+        if (!options.paths.empty() && !options.userModePathFilter)
+        {
+            std::vector<PathFilterKey> prefixes;
+            for (const auto &path : options.paths)
+            {
+                PathFilterKey key{};
+                size_t length = std::min(path.size(), PathFilterKey::MaxLength);
+                key.prefixLength = length * 8;
+                std::copy_n(path.begin(), length, key.data);
+                prefixes.push_back(key);
+            }
+            return fillSet("log_paths", prefixes);
+        }
+        return 0;
+    }
+
+    int CoreProgram::startProgram(const Options &options)
+    {
+        return LaunchProgram(options.program, [this](int32_t pid) { return fillSet("log_pids", std::vector<int32_t> { pid }); });
+    }
+
+    int CoreProgram::tableFd(const std::string &name)
+    {
+        return ::bpf_object__find_map_fd_by_name(skel->obj, name.c_str());
+    }
+
+    uint64_t CoreProgram::mapEntries(const std::string &table)
+    {
+        // all keys of the counted maps are 8 bytes
+        int fd = tableFd(table);
+        uint64_t key = 0, next = 0;
+        uint64_t entries = 0;
+        for (void *previous = nullptr; ::bpf_map_get_next_key(fd, previous, &next) == 0; previous = &key)
+        {
+            key = next;
+            entries++;
+        }
+        return entries;
+    }
+
+    uint64_t CoreProgram::sum(const std::string &table, int index)
+    {
+        int cpus = ::libbpf_num_possible_cpus();
+        if (cpus <= 0)
+        {
+            return 0;
+        }
+        std::vector<uint64_t> values(cpus);
+        if (::bpf_map_lookup_elem(tableFd(table), &index, values.data()) != 0)
+        {
+            return 0;
+        }
+        uint64_t sum = 0;
+        for (uint64_t value : values)
+        {
+            sum += value;
+        }
+        return sum;
+    }
+}
@@ -0,0 +1,42 @@
+#include <Launch.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <wordexp.h>
+
+namespace FileAccess
+{
+    int LaunchProgram(const std::string &cmdline, const std::function<int(int32_t)> &track)
+    {
+        wordexp_t words{};
+        if (::wordexp(cmdline.c_str(), &words, WRDE_NOCMD) != 0 || words.we_wordc == 0)
+        {
+            std::cerr << "Invalid program command line " << cmdline << "." << std::endl;
+            return -EINVAL;
+        }
+
+        pid_t pid = ::fork();
+        if (pid == -1)
+        {
+            ::wordfree(&words);
+            return -errno;
+        }
+        if (pid == 0)
+        {
+            // wait till the parent added us to the filter
+            ::raise(SIGSTOP);
+            ::execv(words.we_wordv[0], words.we_wordv);
+            ::_exit(1);
+        }
+        ::wordfree(&words);
+
+        int res = track(pid);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        ::kill(pid, SIGCONT);
+        return (res != 0) ? res : pid;
+    }
+}
@@ -0,0 +1,315 @@
+#include <Options.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <grp.h>
+#include <iostream>
+#include <pwd.h>
+#include <sstream>
+
+namespace FileAccess
+{
+    namespace
+    {
+        enum LongOption
+        {
+            OptNoFilter = 256,
+            OptDepth,
+            OptBufSize,
+            OptPathOutput,
+            OptEvBufMain,
+            OptWakeupFill,
+            OptWakeupTime,
+            OptPathCache,
+            OptHandles,
+            OptInodes,
+            OptInFlight,
+            OptMapStats,
+            OptAggregate,
+            OptAggregateOnly,
+            OptPageCache,
+            OptBlockIo,
+            OptUserModePathFilter,
+            OptFentry,
+            OptFormat,
+            OptBpf,
+            OptPrintOnly,
+            OptCompileOnly
+        };
+
+        const option LongOptions[] =
+        {
+            { "nofilter",           no_argument,       nullptr, OptNoFilter },
+            { "id",                 required_argument, nullptr, 'i' },
+            { "program",            required_argument, nullptr, 'p' },
+            { "user",               required_argument, nullptr, 'u' },
+            { "group",              required_argument, nullptr, 'g' },
+            { "cgroup",             required_argument, nullptr, 'C' },
+            { "path",               required_argument, nullptr, 'P' },
+            { "operations",         required_argument, nullptr, 'o' },
+            { "includechildren",    no_argument,       nullptr, 'c' },
+            { "output",             required_argument, nullptr, 'O' },
+            { "time",               required_argument, nullptr, 't' },
+            { "filesystems",        required_argument, nullptr, 'f' },
+            { "depth",              required_argument, nullptr, OptDepth },
+            { "bufsize",            required_argument, nullptr, OptBufSize },
+            { "pathoutput",         required_argument, nullptr, OptPathOutput },
+            { "evbufmain",          required_argument, nullptr, OptEvBufMain },
+            { "wakeupfill",         required_argument, nullptr, OptWakeupFill },
+            { "wakeuptime",         required_argument, nullptr, OptWakeupTime },
+            { "pathcache",          required_argument, nullptr, OptPathCache },
+            { "handles",            required_argument, nullptr, OptHandles },
+            { "inodes",             required_argument, nullptr, OptInodes },
+            { "inflight",           required_argument, nullptr, OptInFlight },
+            { "mapstats",           required_argument, nullptr, OptMapStats },
+            { "aggregate",          no_argument,       nullptr, OptAggregate },
+            { "aggregateonly",      no_argument,       nullptr, OptAggregateOnly },
+            { "pagecache",          no_argument,       nullptr, OptPageCache },
+            { "blockio",            no_argument,       nullptr, OptBlockIo },
+            { "usermodepathfilter", no_argument,       nullptr, OptUserModePathFilter },
+            { "fentry",             no_argument,       nullptr, OptFentry },
+            { "format",             required_argument, nullptr, OptFormat },
+            { "bpf",                required_argument, nullptr, OptBpf },
+            { "printonly",          no_argument,       nullptr, OptPrintOnly },
+            { "compileonly",        no_argument,       nullptr, OptCompileOnly },
+            { "help",               no_argument,       nullptr, 'h' },
+            { nullptr,              0,                 nullptr, 0 }
+        };
+
+        std::vector<std::string> Split(const char *list)
+        {
+            std::vector<std::string> items;
+            std::stringstream stream(list);
+            for (std::string item; std::getline(stream, item, ',');)
+            {
+                items.push_back(item);
+            }
+            return items;
+        }
+
+        bool IsNumber(const std::string &str)
+        {
+            return !str.empty() && std::all_of(str.begin(), str.end(), [](unsigned char c) { return std::isdigit(c); });
+        }
+    }
+
+    void Usage(const char *name)
+    {
+        std::cout << "usage: " << name << " (--nofilter | -i PIDS | -p PROGRAM | -u USERS | -g GROUPS | -C CGROUPS) [options]\n"
+            "\n"
+            "Trace file accesses, native replacement of fileaccess.py.\n"
+            "\n"
+            "  --nofilter              apply no filter (warning: may lead to high output and degradation of overall performance)\n"
+            "  -i, --id PIDS           filter by comma separated list of PIDs\n"
+            "  -p, --program CMD       commandline to call program that is going to be logged\n"
+            "  -u, --user USERS        filter by comma separated list of UIDs or user names\n"
+            "  -g, --group GROUPS      filter by comma separated list of GIDs or group names\n"
+            "  -C, --cgroup CGROUPS    filter by comma separated list of cgroup v2 directories, including the cgroups below them\n"
+            "  -P, --path PATHS        filter by comma separated list of path prefixes inside the filesystem (at most 256 bytes)\n"
+            "  -o, --operations OPS    specifies which operations to log (default: OCRWU)\n"
+            "  -c, --includechildren   also include child processes\n"
+            "  -O, --output FILE       file to direct output to (will be overwritten) (default: stdout)\n"
+            "  -t, --time SEC          number of seconds to run the trace, 0 for unlimited (default: 0)\n"
+            "  -f, --filesystems FSS   comma seperated list of filesystems to filter by\n"
+            "  --depth N               depth of loop unrolling, equals supported path depth (default: 10)\n"
+            "  --bufsize N             size of the path buffer, maximum supported size per path part (default: 64)\n"
+            "  --pathoutput N          number of characters for path output (default 240)\n"
+            "  --evbufmain N           page count for main event buffer (default: 8)\n"
+            "  --wakeupfill PERCENT    fill of the main event buffer before the consumer is woken up, 0 for every event (default: 25)\n"
+            "  --wakeuptime MS         time after which the consumer is woken up regardless of --wakeupfill (default: 10)\n"
+            "  --pathcache N           entries of the kernel cache of already sent paths, 0 to send the paths with every open (default: 16384)\n"
+            "  --handles N             entries of the kernel maps of open handles, least recently used ones are evicted (default: 65536)\n"
+            "  --inodes N              entries of the kernel map of inodes, least recently used ones are evicted (default: 65536)\n"
+            "  --inflight N            entries of the kernel maps of calls between entry and return (default: 10240)\n"
+            "  --mapstats SEC          print the usage of the kernel maps every SEC seconds, 0 for only at exit (default: 0)\n"
+            "  --aggregate             additionally sum up reads and writes per handle in the kernel, output as r / w events at close\n"
+            "  --aggregateonly         like --aggregate, but without the individual R / W events\n"
+            "  --pagecache             count the page cache hits and misses (pages) of reads, output in the path column of R events\n"
+            "                          as hits:misses and appended to the r aggregates\n"
+            "  --blockio               also log the block requests of the traced handles / inodes as B events with their device\n"
+            "                          service time\n"
+            "  --usermodepathfilter    filter by path (-P/--path) in user mode\n"
+            "  --fentry                fentry / fexit instead of kprobes for the functions called most (needs BTF and kernel 5.12+, falls back to kprobes)\n"
+            "  --format text|binary    output fixed width csv (default) or logfs binary records\n"
+            "  --bpf FILE              BPF source (default: " FILEACCESS_BPF_SOURCE ")\n"
+            "  --printonly             only prints the final BPF program, does not execute it\n"
+            "  --compileonly           only compiles the final BPF program, does not execute it\n";
+    }
+
+    int ParseOptions(int argc, char *argv[], Options &options)
+    {
+        int filters = 0;
+        int opt;
+        while ((opt = getopt_long(argc, argv, "i:p:u:g:C:P:o:cO:t:f:h", LongOptions, nullptr)) != -1)
+        {
+            switch (opt)
+            {
+            case OptNoFilter:
+                options.noFilter = true;
+                filters++;
+                break;
+            case 'i':
+                for (const auto &pid : Split(optarg))
+                {
+                    options.pids.push_back(std::atoi(pid.c_str()));
+                }
+                filters++;
+                break;
+            case 'p':
+                options.program = optarg;
+                filters++;
+                break;
+            case 'u':
+                for (const auto &user : Split(optarg))
+                {
+                    const passwd *pw = IsNumber(user) ? nullptr : ::getpwnam(user.c_str());
+                    if (!IsNumber(user) && pw == nullptr)
+                    {
+                        std::cerr << "Unknown user " << user << "." << std::endl;
+                        return -EINVAL;
+                    }
+                    options.uids.push_back(pw != nullptr ? pw->pw_uid : std::strtoul(user.c_str(), nullptr, 10));
+                }
+                filters++;
+                break;
+            case 'g':
+                for (const auto &group : Split(optarg))
+                {
+                    const struct group *gr = IsNumber(group) ? nullptr : ::getgrnam(group.c_str());
+                    if (!IsNumber(group) && gr == nullptr)
+                    {
+                        std::cerr << "Unknown group " << group << "." << std::endl;
+                        return -EINVAL;
+                    }
+                    options.gids.push_back(gr != nullptr ? gr->gr_gid : std::strtoul(group.c_str(), nullptr, 10));
+                }
+                filters++;
+                break;
+            case 'C':
+                options.cgroups = Split(optarg);
+                filters++;
+                break;
+            case 'P':
+                options.paths = Split(optarg);
+                break;
+            case 'o':
+                options.operations = optarg;
+                std::transform(options.operations.begin(), options.operations.end(), options.operations.begin(), ::toupper);
+                break;
+            case 'c':
+                options.includeChildren = true;
+                break;
+            case 'O':
+                options.output = optarg;
+                break;
+            case 't':
+                options.time = std::atoi(optarg);
+                break;
+            case 'f':
+                options.filesystems = Split(optarg);
+                break;
+            case OptDepth:
+                options.depth = std::atoi(optarg);
+                break;
+            case OptBufSize:
+                options.bufSize = std::atoi(optarg);
+                break;
+            case OptPathOutput:
+                options.pathOutput = std::atoi(optarg);
+                break;
+            case OptEvBufMain:
+                options.evBufMain = std::atoi(optarg);
+                break;
+            case OptWakeupFill:
+                options.wakeupFill = std::atoi(optarg);
+                break;
+            case OptWakeupTime:
+                options.wakeupTime = std::atoi(optarg);
+                break;
+            case OptPathCache:
+                options.pathCache = std::atoi(optarg);
+                break;
+            case OptHandles:
+                options.handles = std::atoi(optarg);
+                break;
+            case OptInodes:
+                options.inodes = std::atoi(optarg);
+                break;
+            case OptInFlight:
+                options.inFlight = std::atoi(optarg);
+                break;
+            case OptMapStats:
+                options.mapStats = std::atoi(optarg);
+                break;
+            case OptAggregate:
+                options.aggregate = true;
+                break;
+            case OptAggregateOnly:
+                options.aggregate = options.aggregateOnly = true;
+                break;
+            case OptPageCache:
+                options.pageCache = true;
+                break;
+            case OptBlockIo:
+                options.blockIo = true;
+                break;
+            case OptUserModePathFilter:
+                options.userModePathFilter = true;
+                break;
+            case OptFentry:
+                options.fentry = true;
+                break;
+            case OptFormat:
+                if (::strcmp(optarg, "text") == 0)
+                {
+                    options.format = OutputFormat::Text;
+                }
+                else if (::strcmp(optarg, "binary") == 0)
+                {
+                    options.format = OutputFormat::Binary;
+                }
+                else
+                {
+                    std::cerr << "Unknown output format " << optarg << "." << std::endl;
+                    return -EINVAL;
+                }
+                break;
+            case OptBpf:
+                options.bpfSource = optarg;
+                break;
+            case OptPrintOnly:
+                options.printOnly = true;
+                break;
+            case OptCompileOnly:
+                options.compileOnly = true;
+                break;
+            case 'h':
+                Usage(argv[0]);
+                return 1;
+            default:
+                Usage(argv[0]);
+                return -EINVAL;
+            }
+        }
+
+        if (options.blockIo)
+        {
+            options.operations += 'B';
+        }
+        if (filters != 1)
+        {
+            std::cerr << "Exactly one of --nofilter, -i, -p, -u, -g or -C is required." << std::endl;
+            return -EINVAL;
+        }
+        if (optind != argc)
+        {
+            std::cerr << "Unexpected argument " << argv[optind] << "." << std::endl;
+            return -EINVAL;
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,202 @@
+#include <Output.hpp>
+
+#include <LogFormat.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+namespace FileAccess
+{
+    namespace
+    {
+        using LogFs::TextRecord;
+
+        // right aligned in a field of at least width characters, like printf("%*lu")
+        char *PutUnsigned(char *pos, int width, uint64_t value, char fill = ' ')
+        {
+            char digits[20];
+            int count = 0;
+            do
+            {
+                digits[count++] = '0' + value % 10;
+                value /= 10;
+            } while (value != 0);
+            for (int i = count; i < width; i++)
+            {
+                *pos++ = fill;
+            }
+            while (count != 0)
+            {
+                *pos++ = digits[--count];
+            }
+            return pos;
+        }
+
+        // like printf("%*ld")
+        char *PutSigned(char *pos, int width, int64_t value)
+        {
+            if (value >= 0)
+            {
+                return PutUnsigned(pos, width, value);
+            }
+            char digits[21];
+            char *end = PutUnsigned(digits, 0, -static_cast<uint64_t>(value));
+            int count = end - digits + 1;
+            for (int i = count; i < width; i++)
+            {
+                *pos++ = ' ';
+            }
+            *pos++ = '-';
+            return std::copy(digits, end, pos);
+        }
+
+        // milliseconds as "%*ld.%0*ld"
+        char *PutTime(char *pos, uint64_t ms)
+        {
+            pos = PutUnsigned(pos, TextRecord::SizeTimeSec, ms / 1000);
+            *pos++ = '.';
+            return PutUnsigned(pos, TextRecord::SizeTimeNsec, ms % 1000, '0');
+        }
+    }
+
+    Output::Output(OutputFormat format, int pathSize, int fd) :
+        format(format),
+        pathSize(pathSize),
+        fd(fd),
+        buffer(BufferSize + pathSize)
+    {
+    }
+
+    Output::~Output()
+    {
+        flush();
+    }
+
+    void Output::header()
+    {
+        if (format == OutputFormat::Text)
+        {
+            constexpr std::string_view Header = "time_start,time_end,pid,utime_start,utime_end,stime_start,stime_end,inode,type,result,handle,offset,size,flags,path\n";
+            std::copy(Header.begin(), Header.end(), buffer.data() + used);
+            used += Header.size();
+        }
+    }
+
+    void Output::write(const EventMain &event, std::string_view path, uint64_t rtDelta)
+    {
+        path = path.substr(0, pathSize);
+        // a text record is at most 16 fields of 24 characters and the path
+        if (buffer.size() - used < 512 + pathSize && flush() != 0)
+        {
+            return;
+        }
+        if (format == OutputFormat::Text)
+        {
+            writeText(event, path, rtDelta);
+        }
+        else
+        {
+            writeBinary(event, path, rtDelta);
+        }
+    }
+
+    void Output::writeText(const EventMain &event, std::string_view path, uint64_t rtDelta)
+    {
+        char *pos = buffer.data() + used;
+        pos = PutTime(pos, (event.timeStart + rtDelta) / 1000000);
+        *pos++ = ',';
+        pos = PutTime(pos, (event.timeEnd + rtDelta) / 1000000);
+        *pos++ = ',';
+        pos = PutUnsigned(pos, TextRecord::SizePid, event.pid);
+        *pos++ = ',';
+        pos = PutTime(pos, event.utimeStart / 1000000);
+        *pos++ = ',';
+        pos = PutTime(pos, event.utimeEnd / 1000000);
+        *pos++ = ',';
+        pos = PutTime(pos, event.stimeStart / 1000000);
+        *pos++ = ',';
+        pos = PutTime(pos, event.stimeEnd / 1000000);
+        *pos++ = ',';
+        pos = PutUnsigned(pos, TextRecord::SizeInode, event.inodeUid);
+        *pos++ = ',';
+        *pos++ = static_cast<char>(event.type);
+        *pos++ = ',';
+        pos = PutSigned(pos, TextRecord::SizeResult, event.result);
+        *pos++ = ',';
+        pos = PutUnsigned(pos, TextRecord::SizeFilehandle, event.handleUid);
+        *pos++ = ',';
+        pos = PutUnsigned(pos, TextRecord::SizeOffset, event.offset);
+        *pos++ = ',';
+        pos = PutUnsigned(pos, TextRecord::SizeSize, event.size);
+        *pos++ = ',';
+        *pos++ = '0';
+        *pos++ = 'x';
+        constexpr char Hex[] = "0123456789abcdef";
+        for (int shift = (TextRecord::SizeFlags - 3) * 4; shift >= 0; shift -= 4)
+        {
+            *pos++ = Hex[(event.flags >> shift) & 0xf];
+        }
+        *pos++ = ',';
+        pos = std::copy(path.begin(), path.end(), pos);
+        pos = std::fill_n(pos, pathSize - path.size(), ' ');
+        *pos++ = '\n';
+        used = pos - buffer.data();
+    }
+
+    void Output::writeBinary(const EventMain &event, std::string_view path, uint64_t rtDelta)
+    {
+        uint16_t pathLength = static_cast<uint16_t>(path.size());
+        LogFs::BinaryRecord record
+        {
+            .length = LogFs::BinaryRecord::RecordLength(pathLength),
+            .pathLength = pathLength,
+            .event = static_cast<char>(event.type),
+            .reserved = {},
+            .pid = static_cast<int32_t>(event.pid),
+            .result = static_cast<int32_t>(event.result),
+            .flags = event.flags,
+            .rTimeStart = event.timeStart + rtDelta,
+            .rTimeEnd = event.timeEnd + rtDelta,
+            .uTimeStart = event.utimeStart,
+            .uTimeEnd = event.utimeEnd,
+            .sTimeStart = event.stimeStart,
+            .sTimeEnd = event.stimeEnd,
+            .inode = event.inodeUid,
+            .filehandle = static_cast<int64_t>(event.handleUid),
+            .offset = event.offset,
+            .size = event.size,
+            .cgroupId = 0,
+            .comm = {}
+        };
+        char *pos = buffer.data() + used;
+        ::memcpy(pos, &record, sizeof(record));
+        std::copy(path.begin(), path.end(), pos + sizeof(record));
+        ::memset(pos + sizeof(record) + pathLength, 0, record.length - sizeof(record) - pathLength);
+        used += record.length;
+    }
+
+    int Output::flush()
+    {
+        for (size_t written = 0; written < used;)
+        {
+            ssize_t res = ::write(fd, buffer.data() + written, used - written);
+            if (res == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                int err = errno;
+                std::cerr << "Writing output failed: " << ::strerror(err) << std::endl;
+                used = 0;
+                return -err;
+            }
+            written += res;
+        }
+        used = 0;
+        return 0;
+    }
+}
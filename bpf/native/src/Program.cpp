@@ -0,0 +1,395 @@
+#include <Program.hpp>
+#include <Launch.hpp>
+
+#include <bcc/libbpf.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace FileAccess
+{
+    namespace
+    {
+        constexpr const char BpfStart[] = "//------BPF_START------";
+        constexpr const char BpfEnd[] = "//------BPF_END------";
+
+        void ReplaceAll(std::string &text, const std::string &from, const std::string &to)
+        {
+            for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size()))
+            {
+                text.replace(pos, from.size(), to);
+            }
+        }
+    }
+
+    std::string Program::Source(const Options &options)
+    {
+        std::ifstream file(options.bpfSource);
+        if (!file)
+        {
+            std::cerr << "Could not read BPF source " << options.bpfSource << "." << std::endl;
+            return {};
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string text = stream.str();
+        size_t start = text.find(BpfStart);
+        size_t end = text.rfind(BpfEnd);
+        if (start == std::string::npos || end == std::string::npos || end < start)
+        {
+            std::cerr << "BPF source " << options.bpfSource << " lacks the BPF_START / BPF_END markers." << std::endl;
+            return {};
+        }
+        text = text.substr(start + sizeof(BpfStart) - 1, end - start - sizeof(BpfStart) + 1);
+
+        // same replacements as fileaccess.py
+        auto Flag = [](bool value) { return std::string(value ? "1" : "0"); };
+        ReplaceAll(text, "FILTER_BY_PID", Flag(!options.program.empty() || !options.pids.empty()));
+        ReplaceAll(text, "FILTER_BY_UID", Flag(!options.uids.empty()));
+        ReplaceAll(text, "FILTER_BY_GID", Flag(!options.gids.empty()));
+        ReplaceAll(text, "FILTER_BY_CGROUP", Flag(!options.cgroups.empty()));
+        ReplaceAll(text, "CGROUP_FILTER_SIZE", std::to_string(std::max<size_t>(options.cgroups.size(), 1)));
+        ReplaceAll(text, "FILTER_BY_PATH", Flag(!options.paths.empty() && !options.userModePathFilter));
+        ReplaceAll(text, "INCLUDE_CHILD_PROCESSES", Flag(options.includeChildren));
+        ReplaceAll(text, "LOG_DELETES", Flag(options.logs('U')));
+        ReplaceAll(text, "LOG_READS", Flag(options.logs('R')));
+        ReplaceAll(text, "LOG_WRITES", Flag(options.logs('W')));
+        ReplaceAll(text, "AGGREGATE_READWRITES", Flag(options.aggregate));
+        ReplaceAll(text, "SUBMIT_READWRITES", Flag(!options.aggregateOnly));
+        ReplaceAll(text, "TRACK_PAGE_CACHE", Flag(options.pageCache));
+        ReplaceAll(text, "TRACK_BLOCK_IO", Flag(options.blockIo));
+        ReplaceAll(text, "USE_FENTRY", Flag(options.fentry));
+        ReplaceAll(text, "FILESYSTEM_OPENS", Flag(!options.filesystems.empty()));
+        ReplaceAll(text, "PATH_DEPTH", std::to_string(options.depth));
+        ReplaceAll(text, "FILENAME_BUFSIZE", std::to_string(options.bufSize));
+        ReplaceAll(text, "PATH_BUFSIZE", std::to_string(std::bit_ceil(static_cast<unsigned>(3 * options.depth * options.bufSize)))); // power of two for masking in BPF
+        ReplaceAll(text, "PATH_CACHE_SIZE", std::to_string(options.pathCache));
+        ReplaceAll(text, "HANDLE_MAP_SIZE", std::to_string(options.handles));
+        ReplaceAll(text, "INODE_MAP_SIZE", std::to_string(options.inodes));
+        ReplaceAll(text, "SAVE_MAP_SIZE", std::to_string(options.inFlight));
+        ReplaceAll(text, "RB_PAGES_EVENT_MAIN", std::to_string(options.evBufMain));
+        ReplaceAll(text, "RB_WAKEUP_BYTES", std::to_string(static_cast<int64_t>(options.evBufMain) * ::sysconf(_SC_PAGESIZE) * options.wakeupFill / 100));
+        ReplaceAll(text, "RB_WAKEUP_NS", std::to_string(static_cast<int64_t>(options.wakeupTime) * 1000000));
+        return text;
+    }
+
+    Program::~Program()
+    {
+        for (int link : links)
+        {
+            ::close(link);
+        }
+    }
+
+    bool Program::FentrySupported()
+    {
+        return ::access("/sys/kernel/btf/vmlinux", R_OK) == 0;
+    }
+
+    int Program::load(const std::string &source)
+    {
+        bpf = std::make_unique<ebpf::BPF>();
+        auto res = bpf->init(source);
+        if (!res.ok())
+        {
+            std::cerr << "Compiling the BPF program failed: " << res.msg() << std::endl;
+            return -EINVAL;
+        }
+        return 0;
+    }
+
+    int Program::attachKprobe(const std::string &event, const std::string &function, bool ret, bool optional)
+    {
+        auto res = bpf->attach_kprobe(event, function, 0, ret ? BPF_PROBE_RETURN : BPF_PROBE_ENTRY);
+        if (!res.ok())
+        {
+            // on newer / older kernels some of the functions don't exist, ignoring them is fine
+            if (optional)
+            {
+                return 0;
+            }
+            std::cerr << "Attaching " << function << " to " << event << " failed: " << res.msg() << std::endl;
+            return -EINVAL;
+        }
+        return 1;
+    }
+
+    int Program::attachKfunc(const std::string &function, bool ret)
+    {
+        // the names KFUNC_PROBE / KRETFUNC_PROBE give the programs
+        std::string name = (ret ? "kretfunc__vmlinux__" : "kfunc__vmlinux__") + function;
+        int fd;
+        if (auto res = bpf->load_func(name, BPF_PROG_TYPE_TRACING, fd); !res.ok())
+        {
+            std::cerr << "Loading " << name << " failed: " << res.msg() << std::endl;
+            return -EINVAL;
+        }
+        int link = ::bpf_attach_kfunc(fd);
+        if (link < 0)
+        {
+            std::cerr << "Attaching " << name << " failed (" << link << ")." << std::endl;
+            return -EINVAL;
+        }
+        links.push_back(link);
+        return 1;
+    }
+
+    int Program::attach(const Options &options)
+    {
+        int res = 0;
+        if (!options.filesystems.empty())
+        {
+            for (const auto &fs : options.filesystems)
+            {
+                std::cerr << "Attaching to fs " << fs << "..." << std::endl;
+                if (attachKprobe(fs + "_open", "open_with_file", false, true) > 0)
+                {
+                    std::cerr << fs << "_open attached" << std::endl;
+                }
+                if (attachKprobe(fs + "_file_open", "open_with_file", false, true) > 0)
+                {
+                    std::cerr << fs << "_file_open attached" << std::endl;
+                }
+            }
+        }
+        else
+        {
+            std::cerr << "Attaching to all filesystems." << std::endl;
+            if (options.fentry)
+            {
+                res |= attachKfunc("vfs_open", false);
+                res |= attachKfunc("do_filp_open", false);
+            }
+            else
+            {
+                res |= attachKprobe("vfs_open", "open_with_file", false);
+                res |= attachKprobe("do_filp_open", "open_without_file", false);
+            }
+            res |= attachKprobe("do_file_open_root", "open_without_file", false);
+        }
+
+        // generally attach to the generic functions returns as after the internal (fs specific) opens the file struct might not be fully populated
+        if (options.fentry)
+        {
+            res |= attachKfunc("vfs_open", true);
+            res |= attachKfunc("do_filp_open", true);
+        }
+        else
+        {
+            res |= attachKprobe("vfs_open", "ret_open_without_file", true);
+            res |= attachKprobe("do_filp_open", "ret_open_returning_file", true);
+        }
+        res |= attachKprobe("do_file_open_root", "ret_open_returning_file", true);
+
+        if (options.logs('R'))
+        {
+            if (options.fentry)
+            {
+                res |= attachKfunc("vfs_read", false);
+                res |= attachKfunc("vfs_read", true);
+            }
+            else
+            {
+                res |= attachKprobe("vfs_read", "retprobe__readwrites", true);
+                res |= attachKprobe("vfs_read", "probe__vfs_read", false);
+            }
+            attachKprobe("do_iter_read", "retprobe__readwrites", true, true);
+            attachKprobe("do_iter_read", "probe__do_iter_read", false, true);
+            attachKprobe("vfs_iocb_iter_read", "retprobe__readwrites", true, true);
+            attachKprobe("vfs_iocb_iter_read", "probe__vfs_iocb_iter_read", false, true);
+        }
+        if (options.logs('W'))
+        {
+            if (options.fentry)
+            {
+                res |= attachKfunc("vfs_write", false);
+                res |= attachKfunc("vfs_write", true);
+            }
+            else
+            {
+                res |= attachKprobe("vfs_write", "retprobe__readwrites", true);
+                res |= attachKprobe("vfs_write", "probe__vfs_write", false);
+            }
+            attachKprobe("do_iter_write", "retprobe__readwrites", true, true);
+            attachKprobe("do_iter_write", "probe__do_iter_write", false, true);
+            attachKprobe("vfs_iocb_iter_write", "retprobe__readwrites", true, true);
+            attachKprobe("vfs_iocb_iter_write", "probe__vfs_iocb_iter_write", false, true);
+        }
+        if (options.logs('R') || options.logs('W'))
+        {
+            attachKprobe("do_iter_readv_writev", "retprobe__readwrites", true, true);
+            attachKprobe("do_iter_readv_writev", "probe__do_iter_readv_writev", false, true);
+        }
+
+        if (options.pageCache && options.logs('R'))
+        {
+            // folio_mark_accessed / filemap_add_folio replaced mark_page_accessed / add_to_page_cache_lru (5.16+), which call them if they still exist
+            if (attachKprobe("folio_mark_accessed", "probe__page_accessed", false, true) == 0)
+            {
+                res |= attachKprobe("mark_page_accessed", "probe__page_accessed", false);
+            }
+            if (attachKprobe("filemap_add_folio", "probe__page_added", false, true) == 0)
+            {
+                res |= attachKprobe("add_to_page_cache_lru", "probe__page_added", false);
+            }
+        }
+
+        if (options.blockIo)
+        {
+            res |= attachKprobe("blk_mq_start_request", "probe__block_issue", false);
+            if (auto status = bpf->attach_raw_tracepoint("block_rq_complete", "raw_tracepoint__block_rq_complete"); !status.ok())
+            {
+                std::cerr << "Attaching block_rq_complete failed: " << status.msg() << std::endl;
+                res |= -EINVAL;
+            }
+        }
+
+        // the python frontend attaches these automatically by their names
+        if (options.fentry)
+        {
+            res |= attachKfunc("filp_close", false);
+            res |= attachKfunc("filp_close", true);
+        }
+        else
+        {
+            res |= attachKprobe("filp_close", "kprobe__filp_close", false);
+            res |= attachKprobe("filp_close", "kretprobe__filp_close", true);
+        }
+        res |= attachKprobe("vfs_unlink", "kprobe__vfs_unlink", false);
+        res |= attachKprobe("vfs_unlink", "kretprobe__vfs_unlink", true);
+        if (options.pathCache > 0)
+        {
+            res |= attachKprobe("vfs_rename", "kprobe__vfs_rename", false);
+            res |= attachKprobe("vfs_rename", "kretprobe__vfs_rename", true);
+        }
+        // cleans up after exited threads, also removes them from the pid filter
+        if (auto status = bpf->attach_tracepoint("sched:sched_process_exit", "tracepoint__sched__sched_process_exit"); !status.ok())
+        {
+            std::cerr << "Attaching sched_process_exit failed: " << status.msg() << std::endl;
+            res |= -EINVAL;
+        }
+        if (!options.program.empty() || !options.pids.empty())
+        {
+            if (options.includeChildren)
+            {
+                if (auto status = bpf->attach_tracepoint("sched:sched_process_fork", "tracepoint__sched__sched_process_fork"); !status.ok())
+                {
+                    std::cerr << "Attaching sched_process_fork failed: " << status.msg() << std::endl;
+                    res |= -EINVAL;
+                }
+            }
+        }
+        return (res < 0) ? -EINVAL : 0;
+    }
+
+    template<typename Key>
+    int Program::fillSet(const std::string &table, const std::vector<Key> &keys)
+    {
+        auto set = bpf->get_hash_table<Key, uint8_t>(table);
+        for (const auto &key : keys)
+        {
+            if (auto res = set.update_value(key, 1); !res.ok())
+            {
+                std::cerr << "Updating " << table << " failed: " << res.msg() << std::endl;
+                return -EINVAL;
+            }
+        }
+        return 0;
+    }
+
+    int Program::setFilters(const Options &options)
+    {
+        if (!options.pids.empty())
+        {
+            if (int res = fillSet("log_pids", options.pids); res != 0)
+            {
+                return res;
+            }
+        }
+        if (!options.uids.empty())
+        {
+            if (int res = fillSet("log_uids", options.uids); res != 0)
+            {
+                return res;
+            }
+        }
+        if (!options.gids.empty())
+        {
+            if (int res = fillSet("log_gids", options.gids); res != 0)
+            {
+                return res;
+            }
+        }
+        if (!options.cgroups.empty())
+        {
+            auto cgroups = bpf->get_cgroup_array("log_cgroups");
+            for (size_t i = 0; i < options.cgroups.size(); i++)
+            {
+                if (auto res = cgroups.update_value(i, options.cgroups[i]); !res.ok())
+                {
+                    std::cerr << "Adding cgroup " << options.cgroups[i] << " failed: " << res.msg() << std::endl;
+                    return -EINVAL;
+                }
+            }
+        }
+        if (!options.paths.empty() && !options.userModePathFilter)
+        {
+            std::vector<PathFilterKey> prefixes;
+            for (const auto &path : options.paths)
+            {
+                PathFilterKey key{};
+                size_t length = std::min(path.size(), PathFilterKey::MaxLength);
+                key.prefixLength = length * 8;
+                std::copy_n(path.begin(), length, key.data);
+                prefixes.push_back(key);
+            }
+            return fillSet("log_paths", prefixes);
+        }
+        return 0;
+    }
+
+    int Program::startProgram(const Options &options)
+    {
+        return LaunchProgram(options.program, [this](int32_t pid) { return fillSet("log_pids", std::vector<int32_t> { pid }); });
+    }
+
+    int Program::tableFd(const std::string &name)
+    {
+        return bpf->get_table(name).get_fd();
+    }
+
+    uint64_t Program::mapEntries(const std::string &table)
+    {
+        // all keys of the counted maps are 8 bytes
+        int fd = tableFd(table);
+        uint64_t key = 0, next = 0;
+        uint64_t entries = 0;
+        for (void *previous = nullptr; ::bpf_get_next_key(fd, previous, &next) == 0; previous = &key)
+        {
+            key = next;
+            entries++;
+        }
+        return entries;
+    }
+
+    uint64_t Program::sum(const std::string &table, int index)
+    {
+        auto array = bpf->get_percpu_array_table<uint64_t>(table);
+        std::vector<uint64_t> values;
+        if (!array.get_value(index, values).ok())
+        {
+            return 0;
+        }
+        uint64_t sum = 0;
+        for (uint64_t value : values)
+        {
+            sum += value;
+        }
+        return sum;
+    }
+}
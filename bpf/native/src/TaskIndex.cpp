@@ -0,0 +1,335 @@
+#include <TaskIndex.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <unistd.h>
+
+namespace FileAccess
+{
+    namespace
+    {
+        // reads the header and the data from offset of one open of the file, a delta log may be replaced meanwhile
+        int ReadFile(const std::string &path, const char (&magic)[8], TaskIndexHeader &header, std::string &data, uint64_t offset = sizeof(TaskIndexHeader))
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                return -ENOENT;
+            }
+            if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || ::memcmp(header.magic, magic, sizeof(magic)) != 0
+                || header.version != TaskIndexHeader::Version)
+            {
+                return -EINVAL;
+            }
+            file.seekg(offset);
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return 0;
+        }
+    }
+
+    std::string TaskIndex::Encode(const TaskRecord &record, const TaskLabels *labels)
+    {
+        std::string data(sizeof(record), '\0');
+        if (labels != nullptr)
+        {
+            uint16_t lengths[TaskLabels::Count];
+            for (int i = 0; i < TaskLabels::Count; i++)
+            {
+                lengths[i] = std::min<size_t>(labels->values[i].size(), UINT16_MAX);
+            }
+            data.append(reinterpret_cast<const char*>(lengths), sizeof(lengths));
+            for (int i = 0; i < TaskLabels::Count; i++)
+            {
+                data.append(labels->values[i], 0, lengths[i]);
+            }
+        }
+        data.resize((data.size() + TaskRecord::Align - 1) & ~(TaskRecord::Align - 1), '\0');
+
+        TaskRecord encoded = record;
+        encoded.length = data.size();
+        ::memcpy(data.data(), &encoded, sizeof(encoded));
+        return data;
+    }
+
+    size_t TaskIndex::replay(std::string_view data)
+    {
+        size_t used = 0;
+        while (data.size() - used >= sizeof(TaskRecord))
+        {
+            TaskRecord record;
+            ::memcpy(&record, data.data() + used, sizeof(record));
+            if (record.length < sizeof(record) || record.length > data.size() - used)
+            {
+                break; // incomplete, the informer is still writing it
+            }
+
+            std::string_view payload = data.substr(used + sizeof(record), record.length - sizeof(record));
+            if (record.type == TaskRecord::Labels && payload.size() >= sizeof(uint16_t) * TaskLabels::Count)
+            {
+                uint16_t lengths[TaskLabels::Count];
+                ::memcpy(lengths, payload.data(), sizeof(lengths));
+                payload.remove_prefix(sizeof(lengths));
+                TaskLabels labels;
+                for (int i = 0; i < TaskLabels::Count; i++)
+                {
+                    size_t length = std::min<size_t>(lengths[i], payload.size());
+                    labels.values[i] = payload.substr(0, length);
+                    payload.remove_prefix(length);
+                }
+                apply(record, &labels);
+            }
+            else
+            {
+                apply(record);
+            }
+            used += record.length;
+        }
+        return used;
+    }
+
+    int TaskIndex::load(const std::string &dir)
+    {
+        processes = FlatMap<std::vector<Process>>();
+        labelIndex = FlatMap<uint32_t>();
+        labelSets.clear();
+        labelCgroups.clear();
+        this->dir = dir;
+
+        TaskIndexHeader header;
+        std::string snapshot;
+        int res = ReadFile(dir + "/" + SnapshotFile, TaskIndexHeader::SnapshotMagic, header, snapshot);
+        if (res == -EINVAL)
+        {
+            return res;
+        }
+        bool haveSnapshot = (res == 0);
+        deltaStart = haveSnapshot ? header.time : 0;
+        deltaRead = haveSnapshot ? std::max<uint64_t>(header.deltaOffset, sizeof(header)) : sizeof(header);
+        replay(snapshot);
+
+        std::string delta;
+        res = ReadFile(dir + "/" + DeltaFile, TaskIndexHeader::DeltaMagic, header, delta, deltaRead);
+        if (res != 0)
+        {
+            return (res == -ENOENT && haveSnapshot) ? 0 : res;
+        }
+        if (!haveSnapshot)
+        {
+            deltaStart = header.time;
+        }
+        if (header.time == deltaStart) // else contained in the snapshot, reload() replays its successor
+        {
+            deltaRead += replay(delta);
+        }
+        return 0;
+    }
+
+    int TaskIndex::reload()
+    {
+        TaskIndexHeader header;
+        std::string delta;
+        if (dir.empty())
+        {
+            return -ENOENT;
+        }
+        if (int res = ReadFile(dir + "/" + DeltaFile, TaskIndexHeader::DeltaMagic, header, delta, deltaRead); res != 0)
+        {
+            return res;
+        }
+        if (header.time != deltaStart)
+        {
+            // a new snapshot and delta log, or the old delta log until the new one replaces it
+            return load(dir);
+        }
+        deltaRead += replay(delta);
+        return 0;
+    }
+
+    int TaskIndex::writeSnapshot(const std::string &dir, uint64_t deltaStart) const
+    {
+        std::string data(sizeof(TaskIndexHeader), '\0');
+        TaskIndexHeader header{};
+        ::memcpy(header.magic, TaskIndexHeader::SnapshotMagic, sizeof(header.magic));
+        header.version = TaskIndexHeader::Version;
+        header.time = deltaStart;
+        header.deltaOffset = sizeof(header);
+        ::memcpy(data.data(), &header, sizeof(header));
+
+        for (size_t i = 0; i < labelSets.size(); i++)
+        {
+            TaskRecord record{};
+            record.type = TaskRecord::Labels;
+            record.cgroupId = labelCgroups[i];
+            data += Encode(record, &labelSets[i]);
+        }
+        processes.forEach([&data](uint64_t pid, const std::vector<Process> &lifetimes)
+        {
+            for (const auto &process : lifetimes)
+            {
+                TaskRecord record{};
+                record.type = TaskRecord::Process;
+                record.pid = static_cast<int32_t>(pid);
+                record.ppid = process.ppid;
+                record.time = process.start;
+                record.end = process.end;
+                record.cgroupId = process.cgroupId;
+                data += Encode(record);
+            }
+        });
+
+        std::string path = dir + "/" + SnapshotFile;
+        std::string temporary = path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            return -errno;
+        }
+        int res = 0;
+        for (size_t written = 0; written < data.size();)
+        {
+            ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+            if (count < 0)
+            {
+                res = -errno;
+                break;
+            }
+            written += count;
+        }
+        ::close(fd);
+        if (res == 0 && ::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            res = -errno;
+        }
+        return res;
+    }
+
+    void TaskIndex::apply(const TaskRecord &record, const TaskLabels *labels)
+    {
+        uint64_t pid = static_cast<uint32_t>(record.pid);
+        switch (record.type)
+        {
+        case TaskRecord::Fork:
+        case TaskRecord::Process:
+        {
+            auto &lifetimes = processes[pid];
+            if (!lifetimes.empty() && lifetimes.back().end == 0)
+            {
+                lifetimes.back().end = record.time; // missed the exit, the pid was reused
+            }
+            lifetimes.push_back({ record.ppid, record.cgroupId, record.time, (record.type == TaskRecord::Process) ? record.end : 0 });
+            break;
+        }
+        case TaskRecord::Exit:
+            if (auto *lifetimes = processes.find(pid); lifetimes != nullptr && !lifetimes->empty() && lifetimes->back().end == 0)
+            {
+                lifetimes->back().end = record.time;
+            }
+            break;
+        case TaskRecord::Move:
+            if (auto *lifetimes = processes.find(pid); lifetimes != nullptr && !lifetimes->empty())
+            {
+                lifetimes->back().cgroupId = record.cgroupId;
+            }
+            else
+            {
+                processes[pid].push_back({ record.ppid, record.cgroupId, 0, 0 });
+            }
+            break;
+        case TaskRecord::Labels:
+            if (labels != nullptr)
+            {
+                if (uint32_t *index = labelIndex.find(record.cgroupId); index != nullptr)
+                {
+                    labelSets[*index] = *labels;
+                }
+                else
+                {
+                    labelIndex[record.cgroupId] = labelSets.size();
+                    labelSets.push_back(*labels);
+                    labelCgroups.push_back(record.cgroupId);
+                }
+            }
+            break;
+        }
+    }
+
+    const TaskIndex::Process *TaskIndex::find(int32_t pid, uint64_t time)
+    {
+        auto *lifetimes = processes.find(static_cast<uint32_t>(pid));
+        if (lifetimes == nullptr || lifetimes->empty())
+        {
+            return nullptr;
+        }
+        if (time == 0)
+        {
+            return &lifetimes->back();
+        }
+        // pids are rarely reused, so there are few lifetimes. Threads may outlive an exited leader, so take the latest
+        // lifetime started before time if none contains it.
+        for (auto it = lifetimes->rbegin(); it != lifetimes->rend(); ++it)
+        {
+            if (it->start <= time)
+            {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    const TaskLabels *TaskIndex::labels(uint64_t cgroupId)
+    {
+        uint32_t *index = labelIndex.find(cgroupId);
+        return (index != nullptr) ? &labelSets[*index] : nullptr;
+    }
+
+    const TaskLabels *TaskIndex::labels(int32_t pid, uint64_t time)
+    {
+        const Process *process = find(pid, time);
+        return (process != nullptr) ? labels(process->cgroupId) : nullptr;
+    }
+}
+
+using FileAccess::TaskIndex;
+using FileAccess::TaskLabels;
+
+void *taskindex_open(const char *dir)
+{
+    auto index = std::make_unique<TaskIndex>();
+    if (index->load(dir) != 0)
+    {
+        return nullptr;
+    }
+    return index.release();
+}
+
+int taskindex_reload(void *index)
+{
+    return static_cast<TaskIndex*>(index)->reload();
+}
+
+void taskindex_close(void *index)
+{
+    delete static_cast<TaskIndex*>(index);
+}
+
+uint64_t taskindex_cgroup(void *index, int32_t pid, uint64_t time)
+{
+    const TaskIndex::Process *process = static_cast<TaskIndex*>(index)->find(pid, time);
+    return (process != nullptr) ? process->cgroupId : 0;
+}
+
+const char *taskindex_label(void *index, int32_t pid, uint64_t time, int label)
+{
+    if (label < 0 || label >= TaskLabels::Count)
+    {
+        return nullptr;
+    }
+    const TaskLabels *labels = static_cast<TaskIndex*>(index)->labels(pid, time);
+    return (labels != nullptr) ? labels->values[label].c_str() : nullptr;
+}
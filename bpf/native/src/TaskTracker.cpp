@@ -0,0 +1,299 @@
+#include <TaskTracker.hpp>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace FileAccess
+{
+    namespace
+    {
+        constexpr const char CgroupRoot[] = "/sys/fs/cgroup";
+
+        uint64_t Now()
+        {
+            timespec now{};
+            ::clock_gettime(CLOCK_REALTIME, &now);
+            return now.tv_sec * 1000000000ULL + now.tv_nsec;
+        }
+
+        // fields of a csv line as written by gocsv (quoted if needed, "" inside quotes)
+        std::vector<std::string> SplitCsv(const std::string &line)
+        {
+            std::vector<std::string> fields(1);
+            bool quoted = false;
+            for (size_t i = 0; i < line.size(); i++)
+            {
+                char c = line[i];
+                if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                {
+                    fields.back() += '"';
+                    i++;
+                }
+                else if (c == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (c == ',' && !quoted)
+                {
+                    fields.emplace_back();
+                }
+                else if (c != '\r')
+                {
+                    fields.back() += c;
+                }
+            }
+            return fields;
+        }
+
+        int32_t ParentPid(int32_t pid)
+        {
+            // "pid (comm) state ppid ...", comm may contain spaces and parentheses
+            std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+            std::string stat;
+            std::getline(file, stat);
+            size_t end = stat.rfind(')');
+            if (end == std::string::npos || end + 4 >= stat.size())
+            {
+                return 0;
+            }
+            int32_t ppid = 0;
+            const char *start = stat.data() + end + 4; // ") S "
+            std::from_chars(start, stat.data() + stat.size(), ppid);
+            return ppid;
+        }
+    }
+
+    uint64_t CgroupId(int32_t pid)
+    {
+        std::ifstream file("/proc/" + std::to_string(pid) + "/cgroup");
+        for (std::string line; std::getline(file, line);)
+        {
+            if (line.starts_with("0::"))
+            {
+                struct stat info{};
+                if (::stat((CgroupRoot + line.substr(3)).c_str(), &info) != 0)
+                {
+                    return 0;
+                }
+                return info.st_ino;
+            }
+        }
+        return 0;
+    }
+
+    TaskTracker::~TaskTracker()
+    {
+        if (deltaFd != -1)
+        {
+            ::close(deltaFd);
+        }
+    }
+
+    int TaskTracker::open(const std::string &dir, const std::string &labelsPath)
+    {
+        this->dir = dir;
+        this->labelsPath = labelsPath;
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            std::cerr << "Could not create " << dir << "." << std::endl;
+            return -errno;
+        }
+        if (int res = index.load(dir); res != 0 && res != -ENOENT)
+        {
+            std::cerr << "The index in " << dir << " is invalid." << std::endl;
+            return res;
+        }
+        // the delta log of the last run goes into a snapshot, so it is not replayed on every start
+        if (int res = snapshot(); res != 0)
+        {
+            std::cerr << "Could not write the index to " << dir << "." << std::endl;
+            return res;
+        }
+        return 0;
+    }
+
+    int TaskTracker::snapshot()
+    {
+        // The new delta log is written beside the old one and renamed after the snapshot. Loaders pair the two by the start
+        // time of the delta log and skip an old one until it is replaced, the records in it are in the snapshot.
+        std::string path = dir + "/" + TaskIndex::DeltaFile;
+        std::string temporary = path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            return -errno;
+        }
+        TaskIndexHeader header{};
+        ::memcpy(header.magic, TaskIndexHeader::DeltaMagic, sizeof(header.magic));
+        header.version = TaskIndexHeader::Version;
+        header.time = Now();
+        int res = (::write(fd, &header, sizeof(header)) == sizeof(header)) ? 0 : -EIO;
+        if (res == 0)
+        {
+            res = index.writeSnapshot(dir, header.time);
+        }
+        if (res == 0 && ::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            res = -errno; // loaders skip the old delta log, its records are in the snapshot and new ones go there until the next try
+        }
+        if (res != 0)
+        {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            return res;
+        }
+        if (deltaFd != -1)
+        {
+            ::close(deltaFd);
+        }
+        deltaFd = fd;
+        return 0;
+    }
+
+    void TaskTracker::append(const TaskRecord &record, const TaskLabels *labels)
+    {
+        index.apply(record, labels);
+        std::string data = TaskIndex::Encode(record, labels);
+        (void)!::write(deltaFd, data.data(), data.size()); // the next snapshot has it anyway
+    }
+
+    void TaskTracker::scanProcesses()
+    {
+        DIR *proc = ::opendir("/proc");
+        if (proc == nullptr)
+        {
+            return;
+        }
+        while (dirent *entry = ::readdir(proc))
+        {
+            int32_t pid = 0;
+            auto res = std::from_chars(entry->d_name, entry->d_name + ::strlen(entry->d_name), pid);
+            if (res.ec != std::errc() || *res.ptr != '\0' || index.alive(pid))
+            {
+                continue;
+            }
+            TaskRecord record{};
+            record.type = TaskRecord::Process; // start unknown
+            record.pid = pid;
+            record.ppid = ParentPid(pid);
+            record.cgroupId = CgroupId(pid);
+            append(record);
+        }
+        ::closedir(proc);
+    }
+
+    void TaskTracker::refreshLabels()
+    {
+        struct stat info{};
+        if (labelsPath.empty() || ::stat(labelsPath.c_str(), &info) != 0
+            || (info.st_mtim.tv_sec == labelsModified.tv_sec && info.st_mtim.tv_nsec == labelsModified.tv_nsec))
+        {
+            return;
+        }
+        labelsModified = info.st_mtim;
+
+        std::ifstream file(labelsPath);
+        std::string line;
+        if (!std::getline(file, line))
+        {
+            return;
+        }
+        // gocsv names the columns of nested structs without or with their prefix ("Info.PodName")
+        int pidColumn = -1;
+        int labelColumns[TaskLabels::Count];
+        std::fill(std::begin(labelColumns), std::end(labelColumns), -1);
+        std::vector<std::string> header = SplitCsv(line);
+        for (size_t i = 0; i < header.size(); i++)
+        {
+            std::string name = header[i].substr(header[i].rfind('.') + 1);
+            if (name == "Pid")
+            {
+                pidColumn = i;
+            }
+            for (int label = 0; label < TaskLabels::Count; label++)
+            {
+                if (name == TaskLabels::Names[label])
+                {
+                    labelColumns[label] = i;
+                }
+            }
+        }
+        if (pidColumn == -1)
+        {
+            std::cerr << labelsPath << " has no Pid column." << std::endl;
+            return;
+        }
+
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> fields = SplitCsv(line);
+            int32_t pid = 0;
+            if (static_cast<size_t>(pidColumn) >= fields.size()
+                || std::from_chars(fields[pidColumn].data(), fields[pidColumn].data() + fields[pidColumn].size(), pid).ec != std::errc())
+            {
+                continue;
+            }
+            uint64_t cgroupId = CgroupId(pid);
+            if (cgroupId == 0) // the container exited, its cgroup is gone
+            {
+                continue;
+            }
+
+            TaskLabels labels;
+            for (int label = 0; label < TaskLabels::Count; label++)
+            {
+                if (labelColumns[label] != -1 && static_cast<size_t>(labelColumns[label]) < fields.size())
+                {
+                    labels.values[label] = fields[labelColumns[label]];
+                }
+            }
+            if (const TaskLabels *known = index.labels(cgroupId); known == nullptr || !(*known == labels))
+            {
+                TaskRecord record{};
+                record.type = TaskRecord::Labels;
+                record.time = Now();
+                record.cgroupId = cgroupId;
+                append(record, &labels);
+            }
+            // the container runtime moves the main process into the cgroup after forking it
+            if (const TaskIndex::Process *process = index.find(pid); process == nullptr || process->cgroupId != cgroupId)
+            {
+                TaskRecord record{};
+                record.type = TaskRecord::Move;
+                record.time = Now();
+                record.pid = pid;
+                record.cgroupId = cgroupId;
+                append(record);
+            }
+        }
+    }
+
+    void TaskTracker::fork(uint64_t time, int32_t ppid, int32_t pid, uint64_t cgroupId)
+    {
+        TaskRecord record{};
+        record.type = TaskRecord::Fork;
+        record.time = time;
+        record.pid = pid;
+        record.ppid = ppid;
+        record.cgroupId = cgroupId;
+        append(record);
+    }
+
+    void TaskTracker::exit(uint64_t time, int32_t pid)
+    {
+        TaskRecord record{};
+        record.type = TaskRecord::Exit;
+        record.time = time;
+        record.pid = pid;
+        append(record);
+    }
+}
@@ -0,0 +1,209 @@
+#include <Consumer.hpp>
+#include <Options.hpp>
+#include <Output.hpp>
+
+// fileaccess-core loads the precompiled CO-RE object instead of compiling testdir/bpf.cpp with BCC
+#ifdef FILEACCESS_CORE
+#include <CoreProgram.hpp>
+#include <bpf/libbpf.h>
+#else
+#include <Program.hpp>
+#include <bcc/libbpf.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace FileAccess;
+
+static volatile sig_atomic_t Running = 1;
+
+static void Stop(int)
+{
+    Running = 0;
+}
+
+// BCC wraps the ring buffer functions of libbpf
+#ifdef FILEACCESS_CORE
+static ring_buffer *NewRingBuffer(int fd, Consumer *consumer) { return ::ring_buffer__new(fd, Consumer::HandleMain, consumer, nullptr); }
+static int PollRingBuffer(ring_buffer *rb, int timeout) { return ::ring_buffer__poll(rb, timeout); }
+static int ConsumeRingBuffer(ring_buffer *rb) { return ::ring_buffer__consume(rb); }
+static void FreeRingBuffer(ring_buffer *rb) { ::ring_buffer__free(rb); }
+#else
+static ring_buffer *NewRingBuffer(int fd, Consumer *consumer) { return static_cast<ring_buffer*>(::bpf_new_ringbuf(fd, Consumer::HandleMain, consumer)); }
+static int PollRingBuffer(ring_buffer *rb, int timeout) { return ::bpf_poll_ringbuf(rb, timeout); }
+static int ConsumeRingBuffer(ring_buffer *rb) { return ::bpf_consume_ringbuf(rb); }
+static void FreeRingBuffer(ring_buffer *rb) { ::bpf_free_ringbuf(rb); }
+#endif
+
+// usage of the LRU maps, like print_map_stats of fileaccess.py
+static void PrintMapStats(auto &program, const Options &options)
+{
+    struct
+    {
+        MapIndex index;
+        const char *name;
+        int size;
+        bool used;
+    } maps[] =
+    {
+        { MapIndex::Opened, "opened", options.handles, true },
+        { MapIndex::Inodes, "inodes", options.inodes, true },
+        { MapIndex::Save, "save", options.inFlight, !options.fentry }, // task local storage with --fentry
+        { MapIndex::SaveDelete, "save_delete", options.inFlight, true },
+        { MapIndex::Aggregates, "aggregates", options.handles, options.aggregate },
+        { MapIndex::BlockRequests, "block_requests", options.inFlight, options.blockIo }
+    };
+    for (const auto &map : maps)
+    {
+        if (!map.used)
+        {
+            continue;
+        }
+        uint64_t inserted = program.mapInserts(map.index);
+        uint64_t deleted = program.mapDeletes(map.index);
+        uint64_t entries = program.mapEntries(map.name);
+        uint64_t evicted = (inserted > deleted + entries) ? inserted - deleted - entries : 0;
+        std::cerr << "Map " << map.name << ": " << entries << " of " << map.size << " entries, " << inserted << " inserted, " << deleted
+            << " deleted, " << evicted << " evicted." << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (int res = ParseOptions(argc, argv, options); res != 0)
+    {
+        return (res > 0) ? 0 : 2;
+    }
+
+#ifdef FILEACCESS_CORE
+    if (options.fentry)
+    {
+        std::cerr << "fentry not supported by the precompiled program, using kprobes." << std::endl;
+        options.fentry = false;
+    }
+    if (options.printOnly)
+    {
+        std::cerr << "--printonly is not supported by the precompiled program." << std::endl;
+        return 2;
+    }
+
+    CoreProgram program;
+    if (program.load(options) != 0)
+    {
+        return 1;
+    }
+#else
+    if (options.fentry && !Program::FentrySupported())
+    {
+        std::cerr << "fentry not supported, using kprobes." << std::endl;
+        options.fentry = false;
+    }
+
+    std::string source = Program::Source(options);
+    if (source.empty())
+    {
+        return 1;
+    }
+    if (options.printOnly)
+    {
+        std::cout << source << std::endl;
+        return 0;
+    }
+
+    Program program;
+    if (program.load(source) != 0)
+    {
+        return 1;
+    }
+#endif
+    if (options.compileOnly)
+    {
+        return 0;
+    }
+    if (program.attach(options) != 0 || program.setFilters(options) != 0)
+    {
+        return 1;
+    }
+
+    int fd = STDOUT_FILENO;
+    if (!options.output.empty())
+    {
+        fd = ::open(options.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            std::cerr << "Could not open " << options.output << "." << std::endl;
+            return 1;
+        }
+    }
+    Output output(options.format, options.pathOutput, fd);
+    Consumer consumer(options, output);
+
+    ring_buffer *rb = NewRingBuffer(program.tableFd("event_main"), &consumer);
+    if (rb == nullptr)
+    {
+        std::cerr << "Opening the ring buffer failed." << std::endl;
+        return 1;
+    }
+
+    if (!options.program.empty() && program.startProgram(options) < 0)
+    {
+        return 1;
+    }
+
+    std::signal(SIGINT, Stop);
+    std::signal(SIGTERM, Stop);
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(options.time);
+    auto nextMapStats = std::chrono::steady_clock::now() + std::chrono::seconds(options.mapStats);
+
+    output.header();
+    while (Running && (options.time <= 0 || std::chrono::steady_clock::now() < end))
+    {
+        int res = PollRingBuffer(rb, 100);
+        if (res < 0 && res != -EINTR)
+        {
+            std::cerr << "Polling the ring buffer failed (" << res << ")." << std::endl;
+            break;
+        }
+        ConsumeRingBuffer(rb); // records submitted without wakeup
+        output.flush();
+        if (options.mapStats > 0 && std::chrono::steady_clock::now() >= nextMapStats)
+        {
+            PrintMapStats(program, options);
+            nextMapStats += std::chrono::seconds(options.mapStats);
+        }
+    }
+    ConsumeRingBuffer(rb);
+    output.flush();
+    FreeRingBuffer(rb);
+
+    std::cerr << "Consumed " << consumer.mainRecords() << " records." << std::endl;
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    std::cerr << "Consumer: " << std::fixed << std::setprecision(3) << cpu << " s cpu time, event latency " << consumer.latencyMean() / 1e6
+        << " ms mean, " << consumer.latencyMax() / 1e6 << " ms max." << std::endl;
+    std::cerr << "Lost events: " << program.lost(LostIndex::Main) << " (ring buffer full)." << std::endl;
+    if (options.pathCache > 0)
+    {
+        uint64_t hits = program.pathCacheStat(PathCacheStat::Hits);
+        uint64_t misses = program.pathCacheStat(PathCacheStat::Misses);
+        std::cerr << "Path cache: " << hits << " hits, " << misses << " misses (" << std::fixed << std::setprecision(1)
+            << 100.0 * hits / std::max<uint64_t>(hits + misses, 1) << "% hit ratio), " << consumer.knownPaths() << " paths known, "
+            << consumer.unknownPathReferences() << " unknown references." << std::endl;
+    }
+    PrintMapStats(program, options);
+
+    if (fd != STDOUT_FILENO)
+    {
+        ::close(fd);
+    }
+    return 0;
+}
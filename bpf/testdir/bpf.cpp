@@ -1,3 +1,5 @@
+// core/fileaccess.bpf.c is the precompiled CO-RE version of this program, changes have to be made in both
+
 // don't include in string to compile with BCC:
 #include <helpers.h> // BPF stuff
 #include <linux/err.h>
@@ -6,22 +8,35 @@
 
 #define PATH_DEPTH 10
 #define FILENAME_BUFSIZE 64
+#define PATH_BUFSIZE 2048 // power of two >= 3 * PATH_DEPTH * FILENAME_BUFSIZE, set by the frontends
+#define PATH_CACHE_SIZE 16384 // entries of the dentry -> path id cache, 0 to always send paths
+#define HANDLE_MAP_SIZE 65536 // entries of the LRU maps of the open handles and their aggregates
+#define INODE_MAP_SIZE 65536 // entries of the LRU map of the inodes
+#define SAVE_MAP_SIZE 10240 // entries of the LRU maps of the calls between entry and return
 
 #define FILTER_BY_PID 1
 #define INCLUDE_CHILD_PROCESSES 1
 #define FILTER_BY_UID 1
 #define FILTER_BY_GID 1
 #define FILTER_BY_PATH 1
-#define PATHFILTER_PATHPART_LENGTH 16 // number of bytes / characters allocated per path part (determined by longest path part)
-#define PATHFILTER_MAX_PARTS_PER_PATH 16 // maximum number of parts per path; excluding "/" parts as they are ignored; including a "\0" as last part
-#define PATHFILTER_PATHES 3
+#define FILTER_BY_CGROUP 1
+#define CGROUP_FILTER_SIZE 4 // number of cgroups to log
 
 #define LOG_DELETES 1
 #define LOG_READS 1
 #define LOG_WRITES 1
 
+#define AGGREGATE_READWRITES 1 // sum up reads / writes per handle and submit the sums at close
+#define SUBMIT_READWRITES 1 // submit every read / write
+
+#define TRACK_PAGE_CACHE 1 // count the page cache hits and misses of reads (--pagecache)
+#define TRACK_BLOCK_IO 1 // report the block requests of traced handles / inodes as 'B' events (--blockio)
+#define USE_FENTRY 1 // fentry / fexit programs for the hot functions and task local storage instead of the save hash (needs BTF, 5.12+)
+#define FILESYSTEM_OPENS 0 // 1 if the opens are traced by filesystem specific functions (-f), vfs_open / do_filp_open entries are not traced then
+
 #define RB_PAGES_EVENT_MAIN 8
-#define RB_PAGES_EVENT_PATH 8
+#define RB_WAKEUP_BYTES 8192 // wake up the consumer only once this many bytes are pending, 0 to wake it up for every record
+#define RB_WAKEUP_NS 10000000 // or once this long passed since the last wakeup
 
 // compile with BCC the code below:
 //------BPF_START------
@@ -35,6 +50,7 @@
 #include <linux/path.h> // path
 #include <linux/mount.h> // mount
 #include <linux/uio.h> // iov_iter
+#include <linux/blk-mq.h> // request
 
 #include <linux/sched.h>
 
@@ -60,19 +76,42 @@ BPF_HASH(log_uids, u32, u8);
 BPF_HASH(log_gids, u32, u8);
 #endif
 
+#if FILTER_BY_CGROUP
+// cgroup v2 directories to log, including all cgroups below them, so also processes that were started before the tracer
+BPF_CGROUP_ARRAY(log_cgroups, CGROUP_FILTER_SIZE);
+#endif
+
 #if FILTER_BY_PATH
-struct path_part_t
+#define PATH_FILTER_BYTES 256 // data of LPM trie keys is limited to 256 bytes, so are the prefixes
+#define PATH_FILTER_PREFIXES 256
+
+// Allowed path prefixes (-P), matched bytewise like the user mode filter does.
+struct path_filter_key_t
 {
-    char str[PATHFILTER_PATHPART_LENGTH];
+    u32 prefixlen; // bits
+    char data[PATH_FILTER_BYTES];
 };
 
-BPF_ARRAY(log_paths, struct path_part_t, PATHFILTER_MAX_PARTS_PER_PATH * PATHFILTER_PATHES);
+BPF_LPM_TRIE(log_paths, struct path_filter_key_t, u8, PATH_FILTER_PREFIXES);
+
+// Scratch space to build the path of a dentry in, root first. Starts like path_filter_key_t, the masked write offset stays below
+// PATH_FILTER_BYTES.
+struct path_filter_scratch_t
+{
+    u32 prefixlen;
+    char data[PATH_FILTER_BYTES + FILENAME_BUFSIZE];
+};
+
+BPF_PERCPU_ARRAY(path_filter_scratch, struct path_filter_scratch_t, 1);
 #endif
 
 // Since file* cannot be used directly (as it may be reused often), we have to generate a unique id for each open / opened handle.
 
+// The maps of handles, inodes and calls are LRU maps: entries of handles opened before tracing started, closed without us seeing
+// the final close or of calls whose return was missed are evicted instead of filling the maps. Evicting a live handle / inode
+// gives it a new uid at its next event.
 BPF_ARRAY(global_handle_uid, u64, 1);
-BPF_HASH(opened, struct file*, u64);
+BPF_TABLE("lru_hash", struct file*, u64, opened, HANDLE_MAP_SIZE);
 
 // Same has to be done for file inodes. Further we keep track of open handle count for the inodes. Both in closing a handle and unlinking the inode, handle count and if the inode is fully unlinked is checked and the inode is removed from the map if both are true.
 struct saved_inode_t
@@ -82,20 +121,33 @@ struct saved_inode_t
 };
 
 BPF_ARRAY(global_inode_uid, u64, 1);
-BPF_HASH(inodes, unsigned long, struct saved_inode_t);
+BPF_TABLE("lru_hash", unsigned long, struct saved_inode_t, inodes, INODE_MAP_SIZE);
 
-// This struct is transmitted multiple times per open for each segment of the path (from back to front).
-struct event_transmit_path_t
+// Successful inserts and deletes per map (per cpu), at 2 * map_index_t and 2 * map_index_t + 1. The entries inserted but neither
+// deleted nor in the map anymore were evicted, user space counts the entries.
+enum map_index_t
 {
-    u64 uid;
-    u8 event_type;
-    u8 path_type;
-    u8 final; // last path for the event
-    u8 last; // last path fragment for the event
-    char filename[FILENAME_BUFSIZE];
+    MAP_OPENED = 0,
+    MAP_INODES = 1,
+    MAP_SAVE = 2,
+    MAP_SAVE_DELETE = 3,
+    MAP_AGGREGATES = 4,
+    MAP_BLOCK_REQUESTS = 5
 };
 
-BPF_RINGBUF_OUTPUT(event_transmit_path, RB_PAGES_EVENT_PATH);
+BPF_PERCPU_ARRAY(map_stats, u64, 12);
+
+static void CountInsert(int map, int res)
+{
+    if (res == 0)
+        map_stats.increment(2 * map);
+}
+
+static void CountDelete(int map, int res)
+{
+    if (res == 0)
+        map_stats.increment(2 * map + 1);
+}
 
 enum event_type_t : u8
 {
@@ -103,7 +155,10 @@ enum event_type_t : u8
     TYPE_CLOSE = 'C',
     TYPE_READ = 'R',
     TYPE_WRITE = 'W',
-    TYPE_DELETE = 'U'
+    TYPE_DELETE = 'U',
+    TYPE_READ_AGGREGATE = 'r',
+    TYPE_WRITE_AGGREGATE = 'w',
+    TYPE_BLOCK = 'B'
 };
 
 // This struct is submitted for every event.
@@ -125,8 +180,154 @@ struct event_main_t
     u64 flags;
 };
 
+// Opens and unlinks submit this instead of the plain event_main_t, with the paths of the file appended.
+// Per path the names of the dentries are stored null terminated, from the file up to the root, as read by bpf_probe_read_kernel_str.
+// Only offsetof(data) + the used part of data is submitted.
+struct event_path_t
+{
+    struct event_main_t event;
+    u64 path_id; // id of the paths in the path cache, 0 if not cached
+    u16 path_length[3]; // bytes in data of the file ('F'), mount root ('M') and superblock root ('S') path
+    u16 path_reference; // 1 if there is no data as the paths were sent with an earlier record of path_id
+    char data[PATH_BUFSIZE + FILENAME_BUFSIZE]; // the masked write offset stays below PATH_BUFSIZE
+};
+
+#if TRACK_PAGE_CACHE
+// Submitted instead of event_main_t for reads with page cache tracking. Pages are counted like cachestat does: the pages
+// accessed (mark_page_accessed / folio_mark_accessed) minus those added to the page cache (the misses, including readahead).
+// On kernels with large folios these are folios.
+struct event_read_t
+{
+    struct event_main_t event;
+    u64 cache_hits;
+    u64 cache_misses;
+};
+#endif
+
+// Scratch space to build event_path_t in, too big for the stack.
+BPF_PERCPU_ARRAY(path_scratch, struct event_path_t, 1);
+
+#if PATH_CACHE_SIZE
+// Opened paths are cached by dentry and mount, so opening the same file again only sends the path id.
+// Dentries are reused, so an entry is only valid if the dentry still describes the same file at the same place: a renamed file
+// changes parent or name, an unlinked one loses its inode and a reused inode number has another generation. A renamed directory
+// changes the path of everything below it, which would be expensive to find, so it increments path_epoch and invalidates all entries.
+// It does so at the start and the end of the rename, paths resolved and cached meanwhile may be those before.
+struct path_key_t
+{
+    struct dentry* dentry;
+    struct vfsmount* mnt;
+};
+
+struct path_cache_t
+{
+    u64 path_id;
+    u64 epoch;
+    struct dentry* parent;
+    u64 name_hash_len;
+    unsigned long ino;
+    u32 generation;
+};
+
+BPF_TABLE("lru_hash", struct path_key_t, struct path_cache_t, path_cache, PATH_CACHE_SIZE);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
+BPF_ARRAY(global_path_id, u64, 1);
+#else
+BPF_PERCPU_ARRAY(global_path_id, u64, 1); // no atomics with fetch, ids are counted per cpu and the cpu put into the low bits
+#endif
+BPF_ARRAY(path_epoch, u64, 1);
+BPF_HASH(renaming_directory, u64, u8, 1024); // threads in a vfs_rename of a directory
+
+enum path_cache_stat_t
+{
+    PATH_CACHE_HITS = 0,
+    PATH_CACHE_MISSES = 1
+};
+
+BPF_PERCPU_ARRAY(path_cache_stats, u64, 2);
+#endif
+
 BPF_RINGBUF_OUTPUT(event_main, RB_PAGES_EVENT_MAIN);
 
+// Number of records that could not be submitted because the ring buffer was full (per cpu).
+enum lost_index_t
+{
+    LOST_EVENT_MAIN = 0
+};
+
+BPF_PERCPU_ARRAY(lost_events, u64, 1);
+
+#if RB_WAKEUP_BYTES
+BPF_ARRAY(last_wakeup, u64, 1);
+#endif
+
+// Waking up the consumer for every record makes context switches dominate at high event rates, so records are submitted without
+// wakeup until enough data is pending or the last wakeup is too long ago. Records of a quiet phase are picked up by the consumer
+// on its poll timeout.
+static u64 WakeupFlags(u32 size)
+{
+#if RB_WAKEUP_BYTES
+    int zero = 0;
+    u64 now = bpf_ktime_get_ns();
+    u64* last = last_wakeup.lookup(&zero);
+
+    if (last == NULL) // will not fail, BPF wants the check though
+        return 0;
+
+    if (event_main.ringbuf_query(BPF_RB_AVAIL_DATA) + size >= RB_WAKEUP_BYTES || now - *last >= RB_WAKEUP_NS)
+    {
+        *last = now;
+        return BPF_RB_FORCE_WAKEUP;
+    }
+    return BPF_RB_NO_WAKEUP;
+#else
+    return 0;
+#endif
+}
+
+#if AGGREGATE_READWRITES
+#define AGGREGATE_BUCKETS 8 // requested sizes < 16, < 256, ..., < 16^7, >= 16^7 bytes
+
+// Reads or writes of a handle summed up in the kernel.
+struct io_aggregate_t
+{
+    u64 time_first; // start of the first operation
+    u64 time_last; // end of the last operation
+    u64 ops;
+    u64 errors;
+    u64 bytes; // sum of the positive results
+    u64 offset_start; // lowest offset accessed
+    u64 offset_end; // highest offset + result accessed
+    u64 busy; // ns spent in the operations
+    u64 utime; // user / system time spent in the operations
+    u64 stime;
+    u32 histogram[AGGREGATE_BUCKETS]; // operations by requested size
+    u64 cache_hits; // pages, only counted with TRACK_PAGE_CACHE
+    u64 cache_misses;
+};
+
+struct handle_aggregate_t
+{
+    struct io_aggregate_t io[2]; // reads, writes
+};
+
+BPF_TABLE("lru_hash", u64, struct handle_aggregate_t, aggregates, HANDLE_MAP_SIZE); // by handle uid
+
+// Submitted with type 'r' / 'w' at the final close of a handle, before the close event. In event time_start / time_end are those
+// of the first / last operation, utime_end / stime_end the cpu time spent (the starts are 0), result the number of operations,
+// offset the lowest offset accessed and size the number of bytes transferred.
+struct event_aggregate_t
+{
+    struct event_main_t event;
+    u64 offset_end;
+    u64 busy;
+    u64 errors;
+    u32 histogram[AGGREGATE_BUCKETS];
+    u64 cache_hits;
+    u64 cache_misses;
+};
+#endif
+
 static void PrepareMainEvent(struct event_main_t* event)
 {
     struct task_struct *task = (struct task_struct *)bpf_get_current_task();
@@ -150,7 +351,7 @@ static void SetEventFileStuff(struct event_main_t* event, struct file* file)
         if (p_global_inode_uid != NULL) // will not fail, BPF wants the check though
             event->inode_uid = new_saved_inode.inode_uid = ++(*p_global_inode_uid);
         new_saved_inode.opened_handles = 1; // new inode also means new handle
-        inodes.insert(&inode, &new_saved_inode);
+        CountInsert(MAP_INODES, inodes.insert(&inode, &new_saved_inode));
     }
     else
         event->inode_uid = saved_inode->inode_uid;
@@ -164,7 +365,7 @@ static void SetEventFileStuff(struct event_main_t* event, struct file* file)
         if (p_global_handle_uid != NULL) // will not fail, BPF wants the check though
             event->handle_uid = new_saved_handle = ++(*p_global_handle_uid);
 
-        opened.insert(&file, &new_saved_handle);
+        CountInsert(MAP_OPENED, opened.insert(&file, &new_saved_handle));
 
         if (saved_inode != NULL)
             saved_inode->opened_handles++;
@@ -176,58 +377,270 @@ static void SetEventFileStuff(struct event_main_t* event, struct file* file)
     event->flags = file->f_flags;
 }
 
-static void FinalizeAndSubmitMainEvent(struct pt_regs* ctx, struct event_main_t* event)
+static void FinalizeMainEvent(struct event_main_t* event)
 {
     struct task_struct *task = (struct task_struct *)bpf_get_current_task();
 
     event->time_end = bpf_ktime_get_ns();
     event->utime_end = task->utime;
     event->stime_end = task->stime;
+}
 
-    event_main.ringbuf_output(event, sizeof(*event), 0);
+static void SubmitMainEvent(struct pt_regs* ctx, struct event_main_t* event)
+{
+    int res = event_main.ringbuf_output(event, sizeof(*event), WakeupFlags(sizeof(*event)));
+    if (res != 0)
+        lost_events.increment(LOST_EVENT_MAIN);
 }
 
-static void OutputDentry(struct pt_regs* ctx, struct event_transmit_path_t* path_data, struct dentry* entry, bool finalize)
+static void FinalizeAndSubmitMainEvent(struct pt_regs* ctx, struct event_main_t* event)
 {
-    path_data->last = 0;
+    FinalizeMainEvent(event);
+    SubmitMainEvent(ctx, event);
+}
 
+#if AGGREGATE_READWRITES
+// adds a finalized read / write event to the aggregate of its handle
+static void AggregateReadWrite(struct event_main_t* event, u64 cache_hits, u64 cache_misses)
+{
+    struct handle_aggregate_t* aggregate = aggregates.lookup(&event->handle_uid);
+
+    if (aggregate == NULL)
+    {
+        struct handle_aggregate_t empty = {};
+        CountInsert(MAP_AGGREGATES, aggregates.insert(&event->handle_uid, &empty)); // fails if another cpu was faster, which is fine
+        aggregate = aggregates.lookup(&event->handle_uid);
+        if (aggregate == NULL) // map full
+            return;
+    }
+
+    struct io_aggregate_t* io = &aggregate->io[0];
+    if (event->type == TYPE_WRITE)
+        io = &aggregate->io[1];
+
+    u32 bucket = 0;
+    #pragma unroll
+    for (int i = 1; i < AGGREGATE_BUCKETS; i++)
+    {
+        if (event->size >= (1ULL << (4 * i)))
+            bucket = i;
+    }
+
+    __sync_fetch_and_add(&io->ops, 1);
+    if (event->result < 0)
+        __sync_fetch_and_add(&io->errors, 1);
+    else
+        __sync_fetch_and_add(&io->bytes, event->result);
+    __sync_fetch_and_add(&io->busy, event->time_end - event->time_start);
+    __sync_fetch_and_add(&io->utime, event->utime_end - event->utime_start);
+    __sync_fetch_and_add(&io->stime, event->stime_end - event->stime_start);
+    __sync_fetch_and_add(&io->histogram[bucket & (AGGREGATE_BUCKETS - 1)], 1);
+#if TRACK_PAGE_CACHE
+    __sync_fetch_and_add(&io->cache_hits, cache_hits);
+    __sync_fetch_and_add(&io->cache_misses, cache_misses);
+#endif
+
+    // not atomic, concurrent operations on the same handle may rarely widen the ranges less than they should
+    u64 end = event->offset + (event->result > 0 ? event->result : 0);
+    if (io->time_first == 0 || event->offset < io->offset_start)
+        io->offset_start = event->offset;
+    if (end > io->offset_end)
+        io->offset_end = end;
+    if (io->time_first == 0)
+        io->time_first = event->time_start;
+    io->time_last = event->time_end;
+}
+
+// submits the aggregates of the handle of a (final) close event and removes them
+static void SubmitAggregates(struct pt_regs* ctx, struct event_main_t* close)
+{
+    struct handle_aggregate_t* aggregate = aggregates.lookup(&close->handle_uid);
+
+    if (aggregate == NULL)
+        return;
+
+    struct event_aggregate_t record = {};
+    record.event = *close; // pid, inode, handle and flags
+
+    #pragma unroll (2)
+    for (int i = 0; i < 2; i++)
+    {
+        struct io_aggregate_t* io = &aggregate->io[i];
+        if (io->ops == 0)
+            continue;
+
+        record.event.type = (i == 0) ? TYPE_READ_AGGREGATE : TYPE_WRITE_AGGREGATE;
+        record.event.time_start = io->time_first;
+        record.event.time_end = io->time_last;
+        record.event.utime_start = 0;
+        record.event.utime_end = io->utime;
+        record.event.stime_start = 0;
+        record.event.stime_end = io->stime;
+        record.event.result = io->ops;
+        record.event.offset = io->offset_start;
+        record.event.size = io->bytes;
+        record.offset_end = io->offset_end;
+        record.busy = io->busy;
+        record.errors = io->errors;
+        __builtin_memcpy(record.histogram, io->histogram, sizeof(record.histogram));
+        record.cache_hits = io->cache_hits;
+        record.cache_misses = io->cache_misses;
+
+        int res = event_main.ringbuf_output(&record, sizeof(record), WakeupFlags(sizeof(record)));
+        if (res != 0)
+            lost_events.increment(LOST_EVENT_MAIN);
+    }
+
+    CountDelete(MAP_AGGREGATES, aggregates.delete(&close->handle_uid));
+}
+#endif
+
+// copies the names from entry up to the root to data at offset, returns the new offset
+static u32 CopyDentries(struct event_path_t* record, u32 offset, struct dentry* entry)
+{
     #pragma unroll (PATH_DEPTH)
     for (int i = 0; i < PATH_DEPTH; i++)
     {
         if (!entry) break;
 
-        int copied_size = bpf_probe_read_kernel_str(path_data->filename, sizeof(path_data->filename), entry->d_name.name);
+        int copied_size = bpf_probe_read_kernel_str(&record->data[offset & (PATH_BUFSIZE - 1)], FILENAME_BUFSIZE, entry->d_name.name);
 
-        if (copied_size > 0)
-        {
-            event_transmit_path.ringbuf_output(path_data, sizeof(*path_data), 0);
-            entry = entry->d_parent;
-        }
-        else
-        {
-            entry = NULL;
-        }
+        if (copied_size <= 0)
+            break;
+
+        offset += copied_size;
+        struct dentry* parent = entry->d_parent;
+        entry = (parent != entry) ? parent : NULL; // the root is its own parent
     }
 
-    if (finalize)
+    return offset;
+}
+
+#if FILTER_BY_PATH
+// checks the path of entry (up to the root of its filesystem, like the 'F' path) against the allowed prefixes
+static bool PathAllowed(struct dentry* entry)
+{
+    int zero = 0;
+    struct path_filter_scratch_t* key = path_filter_scratch.lookup(&zero);
+
+    if (key == NULL) // will not fail, BPF wants the check though
+        return false;
+
+    // the names come file first, so collect the dentries and copy them in reverse
+    struct dentry* dentries[PATH_DEPTH] = {};
+    #pragma unroll (PATH_DEPTH)
+    for (int i = 0; i < PATH_DEPTH; i++)
     {
-        path_data->last = 1; // communicate end
-        event_transmit_path.ringbuf_output(path_data, sizeof(*path_data), 0);
+        struct dentry* parent = entry->d_parent;
+        if (parent == entry) // the root is its own parent, its name "/" is not part of the path
+            break;
+        dentries[i] = entry;
+        entry = parent;
     }
+
+    u32 offset = 0;
+    #pragma unroll (PATH_DEPTH)
+    for (int i = PATH_DEPTH - 1; i >= 0; i--)
+    {
+        if (dentries[i] == NULL || offset >= PATH_FILTER_BYTES)
+            continue;
+
+        key->data[offset & (PATH_FILTER_BYTES - 1)] = '/';
+        offset++;
+        if (offset >= PATH_FILTER_BYTES)
+            continue;
+
+        int copied_size = bpf_probe_read_kernel_str(&key->data[offset & (PATH_FILTER_BYTES - 1)], FILENAME_BUFSIZE, dentries[i]->d_name.name);
+        if (copied_size > 1)
+            offset += copied_size - 1; // without the null
+    }
+
+    if (offset > PATH_FILTER_BYTES)
+        offset = PATH_FILTER_BYTES;
+    key->prefixlen = offset * 8;
+    return log_paths.lookup((struct path_filter_key_t*)key) != NULL;
+}
+#endif
+
+// finalizes event and submits it together with the paths in one record, without file only a reference to path_id is sent
+// returns false if the record could not be submitted
+static bool FinalizeAndSubmitPathEvent(struct pt_regs* ctx, struct event_main_t* event, u64 path_id, struct dentry* file, struct dentry* mnt_root, struct dentry* sb_root)
+{
+    int zero = 0;
+    struct event_path_t* record = path_scratch.lookup(&zero);
+
+    if (record == NULL) // will not fail, BPF wants the check though
+        return false;
+
+    record->path_id = path_id;
+    record->path_reference = (path_id != 0 && file == NULL);
+
+    u32 offset = CopyDentries(record, 0, file);
+    record->path_length[0] = offset;
+    u32 next = CopyDentries(record, offset, mnt_root);
+    record->path_length[1] = next - offset;
+    offset = CopyDentries(record, next, sb_root);
+    record->path_length[2] = offset - next;
+
+    FinalizeMainEvent(event);
+    record->event = *event;
+
+    if (offset > PATH_BUFSIZE)
+        offset = PATH_BUFSIZE;
+    u32 length = offsetof(struct event_path_t, data) + offset;
+    int res = event_main.ringbuf_output(record, length, WakeupFlags(length));
+    if (res != 0)
+        lost_events.increment(LOST_EVENT_MAIN);
+    return res == 0;
 }
 
-static void OutputFilePaths(struct pt_regs* ctx, struct event_transmit_path_t* path_data, struct file* fp)
+// finalizes and submits an open event, the paths are only sent if they are not known in user space yet
+static void FinalizeAndSubmitOpenEvent(struct pt_regs* ctx, struct event_main_t* event, struct file* fp)
 {
-    path_data->final = 0;
-    path_data->path_type = 'F';
-    OutputDentry(ctx, path_data, fp->f_path.dentry, true);
+    struct dentry* dentry = fp->f_path.dentry;
+    struct vfsmount* mnt = fp->f_path.mnt;
 
-    path_data->path_type = 'M';
-    OutputDentry(ctx, path_data, fp->f_path.mnt->mnt_root, true);
+#if PATH_CACHE_SIZE
+    int zero = 0;
+    struct path_key_t key = {};
+    key.dentry = dentry;
+    key.mnt = mnt;
+
+    struct path_cache_t current = {};
+    u64* epoch = path_epoch.lookup(&zero);
+    if (epoch != NULL) // will not fail, BPF wants the check though
+        current.epoch = *epoch;
+    current.parent = dentry->d_parent;
+    current.name_hash_len = dentry->d_name.hash_len;
+    current.ino = dentry->d_inode->i_ino;
+    current.generation = dentry->d_inode->i_generation;
+
+    struct path_cache_t* cached = path_cache.lookup(&key);
+    if (cached != NULL && cached->epoch == current.epoch && cached->parent == current.parent && cached->name_hash_len == current.name_hash_len
+        && cached->ino == current.ino && cached->generation == current.generation)
+    {
+        path_cache_stats.increment(PATH_CACHE_HITS);
+        FinalizeAndSubmitPathEvent(ctx, event, cached->path_id, NULL, NULL, NULL);
+        return;
+    }
+
+    path_cache_stats.increment(PATH_CACHE_MISSES);
+    u64* p_global_path_id = global_path_id.lookup(&zero);
+    if (p_global_path_id != NULL) // will not fail, BPF wants the check though
+    {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
+        current.path_id = __sync_fetch_and_add(p_global_path_id, 1) + 1; // misses on other cpus increment it at the same time
+#else
+        current.path_id = (++(*p_global_path_id) << 12) | (bpf_get_smp_processor_id() & 0xfff);
+#endif
+    }
 
-    path_data->final = 1;
-    path_data->path_type = 'S';
-    OutputDentry(ctx, path_data, fp->f_path.mnt->mnt_sb->s_root, true); // not sure what the functional difference is between this line and the one above
+    // cached only once the paths are in the ring buffer, opens on other cpus must not reference them before
+    if (FinalizeAndSubmitPathEvent(ctx, event, current.path_id, dentry, mnt->mnt_root, mnt->mnt_sb->s_root))
+        path_cache.update(&key, &current);
+#else
+    FinalizeAndSubmitPathEvent(ctx, event, 0, dentry, mnt->mnt_root, mnt->mnt_sb->s_root);
+#endif
 }
 
 static bool CheckToLog()
@@ -253,6 +666,22 @@ static bool CheckToLog()
         return false;
 #endif
 
+#if FILTER_BY_CGROUP
+    bool in_cgroup = false;
+    #pragma unroll
+    for (int i = 0; i < CGROUP_FILTER_SIZE; i++)
+    {
+        if (log_cgroups.check_current_task(i) == 1)
+        {
+            in_cgroup = true;
+            break;
+        }
+    }
+
+    if (!in_cgroup)
+        return false;
+#endif
+
     return true;
 }
 
@@ -261,6 +690,7 @@ struct save_t
     union
     {
         const struct path* path; // open
+        struct dentry* dentry; // unlink
         struct
         { // close
             unsigned long inode; // if -1, handle is not actually freed as there are other references to it
@@ -270,9 +700,70 @@ struct save_t
 
     struct file *fp;
     struct event_main_t event;
+#if TRACK_PAGE_CACHE
+    u32 cache_accessed; // pages accessed / added to the page cache during a read
+    u32 cache_added;
+#endif
+};
+
+// The save_t of a task between entry and return of a probed function.
+#if USE_FENTRY
+struct save_slot_t
+{
+    struct save_t saved;
+    bool active;
 };
 
-BPF_HASH(save, u64, struct save_t);
+BPF_TASK_STORAGE(save_slots, struct save_slot_t);
+
+static struct save_t* SaveLookup()
+{
+    struct save_slot_t* slot = save_slots.task_storage_get(bpf_get_current_task_btf(), NULL, 0);
+    return (slot != NULL && slot->active) ? &slot->saved : NULL;
+}
+
+// with insert an active save_t is kept (like BPF_NOEXIST)
+static void SaveStore(struct save_t* saved, bool insert)
+{
+    struct save_slot_t* slot = save_slots.task_storage_get(bpf_get_current_task_btf(), NULL, BPF_LOCAL_STORAGE_GET_F_CREATE);
+
+    if (slot == NULL || (insert && slot->active))
+        return;
+
+    slot->saved = *saved;
+    slot->active = true;
+}
+
+static void SaveDelete()
+{
+    struct save_slot_t* slot = save_slots.task_storage_get(bpf_get_current_task_btf(), NULL, 0);
+    if (slot != NULL)
+        slot->active = false; // the slot is kept for the next call and freed with the task
+}
+#else
+BPF_TABLE("lru_hash", u64, struct save_t, save, SAVE_MAP_SIZE);
+
+static struct save_t* SaveLookup()
+{
+    u64 id = bpf_get_current_pid_tgid();
+    return save.lookup(&id);
+}
+
+static void SaveStore(struct save_t* saved, bool insert)
+{
+    u64 id = bpf_get_current_pid_tgid();
+    if (insert || save.lookup(&id) == NULL)
+        CountInsert(MAP_SAVE, save.insert(&id, saved));
+    else
+        save.update(&id, saved);
+}
+
+static void SaveDelete()
+{
+    u64 id = bpf_get_current_pid_tgid();
+    CountDelete(MAP_SAVE, save.delete(&id));
+}
+#endif
 
 // internal function handling most logic for open kprobes to reduce redundancy
 static void do_open(bool insert, struct file* fp)
@@ -280,42 +771,45 @@ static void do_open(bool insert, struct file* fp)
     if (!CheckToLog())
         return;
 
-    u64 id = bpf_get_current_pid_tgid();
     struct save_t saved = {};
     saved.fp = fp;
     PrepareMainEvent(&saved.event);
     saved.event.type = TYPE_OPEN;
-    if (insert)
-        save.insert(&id, &saved);
-    else
-        save.update(&id, &saved);
+    SaveStore(&saved, insert);
 }
 
 // internal function handling most logic for open kretprobes to reduce redundancy
 // if fp is NULL, the FP saved in open is used
 static void do_ret_open(struct pt_regs *ctx, s64 result, struct file* fp)
 {
-    u64 id = bpf_get_current_pid_tgid();
-    struct save_t* saved = save.lookup(&id);
+    struct save_t* saved = SaveLookup();
 
     if (saved != NULL)
     {
         if (fp != NULL)
             saved->fp = fp;
 
-        if (saved->fp && !IS_ERR_VALUE(saved->fp)) // no error opening the file / valid file struct pointer
-            SetEventFileStuff(&saved->event, saved->fp); // will not be executed on error -> therefor won't save handle
-        else // error; todo: maybe save flags / filename from original call
+        if (!saved->fp || IS_ERR_VALUE(saved->fp)) // error; todo: maybe save flags / filename from original call
             saved->fp = NULL;
 
-        struct event_transmit_path_t path_data = {};
-        path_data.event_type = TYPE_OPEN;
-        path_data.uid = saved->event.handle_uid;
+#if FILTER_BY_PATH
+        // failed opens have no path to match, files not matching are not tracked, so their reads, writes and closes are ignored
+        if (saved->fp == NULL || !PathAllowed(saved->fp->f_path.dentry))
+        {
+            SaveDelete();
+            return;
+        }
+#endif
+
+        if (saved->fp) // no error opening the file / valid file struct pointer
+            SetEventFileStuff(&saved->event, saved->fp); // will not be executed on error -> therefor won't save handle
 
         saved->event.result = result;
-        OutputFilePaths(ctx, &path_data, saved->fp);
-        FinalizeAndSubmitMainEvent(ctx, &saved->event);
-        save.delete(&id);
+        if (saved->fp)
+            FinalizeAndSubmitOpenEvent(ctx, &saved->event, saved->fp);
+        else
+            FinalizeAndSubmitPathEvent(ctx, &saved->event, 0, NULL, NULL, NULL);
+        SaveDelete();
     }
 }
 
@@ -351,7 +845,7 @@ int ret_open_without_file(struct pt_regs *ctx)
     return 0;
 }
 
-int kprobe__filp_close(struct pt_regs *ctx, struct file *file)
+static int do_close(struct file *file)
 {
     if (!CheckToLog())
         return 0;
@@ -360,7 +854,6 @@ int kprobe__filp_close(struct pt_regs *ctx, struct file *file)
 
     if (saved_handle != NULL)
     {
-        u64 id = bpf_get_current_pid_tgid();
         struct save_t saved = {};
         if (file->f_count.counter <= 1)
         {
@@ -373,41 +866,56 @@ int kprobe__filp_close(struct pt_regs *ctx, struct file *file)
         PrepareMainEvent(&saved.event);
         SetEventFileStuff(&saved.event, file);
         saved.event.type = TYPE_CLOSE;
-        save.insert(&id, &saved);
+        SaveStore(&saved, true);
     }
 
     return 0;
 }
 
-int kretprobe__filp_close(struct pt_regs *ctx)
+static int do_ret_close(struct pt_regs *ctx, int result)
 {
-    u64 id = bpf_get_current_pid_tgid();
-    struct save_t* saved = save.lookup(&id);
+    struct save_t* saved = SaveLookup();
 
     if (saved != NULL)
     {
-        saved->event.result = PT_REGS_RC(ctx);
+        saved->event.result = result;
 
         if (saved->event.result == 0 && saved->inode != (unsigned long)-1)
         {
-            opened.delete(&saved->fp);
+            CountDelete(MAP_OPENED, opened.delete(&saved->fp));
             struct saved_inode_t* saved_inode = inodes.lookup(&saved->inode);
 
             if (saved_inode != NULL) // should always be the case
             {
                 if (--saved_inode->opened_handles == 0 && saved->unlinked_inode)
-                    inodes.delete(&saved->inode);
+                    CountDelete(MAP_INODES, inodes.delete(&saved->inode));
             }
+
+#if AGGREGATE_READWRITES
+            SubmitAggregates(ctx, &saved->event);
+#endif
         }
 
         FinalizeAndSubmitMainEvent(ctx, &saved->event);
-        save.delete(&id);
+        SaveDelete();
     }
 
     return 0;
 }
 
-BPF_HASH(save_delete, u64, unsigned long);
+#if !USE_FENTRY
+int kprobe__filp_close(struct pt_regs *ctx, struct file *file)
+{
+    return do_close(file);
+}
+
+int kretprobe__filp_close(struct pt_regs *ctx)
+{
+    return do_ret_close(ctx, PT_REGS_RC(ctx));
+}
+#endif
+
+BPF_TABLE("lru_hash", u64, unsigned long, save_delete, SAVE_MAP_SIZE);
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 12, 0)
 int kprobe__vfs_unlink(struct pt_regs *ctx, struct inode *dir, struct dentry *dentry, struct inode **delegated_inode)
@@ -424,35 +932,30 @@ int kprobe__vfs_unlink(struct pt_regs *ctx, struct user_namespace *mnt_userns, s
         saved_inode = inodes.lookup(&inode);
 
         if (saved_inode != NULL && saved_inode->opened_handles == 0) // also it's one of "our" inodes that have no handles anymore, so we have to delete it, if unlink is successful
-            save_delete.insert(&id, &inode);
+            CountInsert(MAP_SAVE_DELETE, save_delete.insert(&id, &inode));
     }
 
 #if LOG_DELETES
+#if FILTER_BY_PATH
+    if (CheckToLog() && PathAllowed(dentry))
+#else
     if (CheckToLog())
+#endif
     {
         if (saved_inode == NULL)
             saved_inode = inodes.lookup(&inode);
 
-        struct event_transmit_path_t path_data = {};
-        path_data.event_type = TYPE_DELETE;
-        path_data.last = 0;
         struct save_t saved = {};
         PrepareMainEvent(&saved.event);
         saved.event.type = TYPE_DELETE;
+        saved.dentry = dentry; // still referenced by the caller when vfs_unlink returns, the path is read then
 
         if (saved_inode != NULL)
-            path_data.uid = saved.event.inode_uid = saved_inode->inode_uid;
+            saved.event.inode_uid = saved_inode->inode_uid;
         else
-            path_data.uid = saved.event.inode_uid = (u64)-inode;
-
-        path_data.final = 0;
-        path_data.path_type = 'F';
-        OutputDentry(ctx, &path_data, dentry, true);
-        path_data.final = 1;
-        path_data.path_type = 'S';
-        OutputDentry(ctx, &path_data, dentry->d_sb->s_root, true);
+            saved.event.inode_uid = (u64)-inode;
 
-        save.insert(&id, &saved);
+        SaveStore(&saved, true);
     }
 #endif
 
@@ -467,25 +970,76 @@ int kretprobe__vfs_unlink(struct pt_regs *ctx)
     if (saved_inode != NULL)
     {
         if (PT_REGS_RC(ctx) == 0) // unlink succeeded
-            inodes.delete(saved_inode);
+            CountDelete(MAP_INODES, inodes.delete(saved_inode));
 
-        save_delete.delete(&id);
+        CountDelete(MAP_SAVE_DELETE, save_delete.delete(&id));
     }
 
 #if LOG_DELETES
-    struct save_t* saved = save.lookup(&id);
+    struct save_t* saved = SaveLookup();
 
     if (saved != NULL)
     {
         saved->event.result = PT_REGS_RC(ctx);
-        FinalizeAndSubmitMainEvent(ctx, &saved->event);
-        save.delete(&id);
+        FinalizeAndSubmitPathEvent(ctx, &saved->event, 0, saved->dentry, NULL, saved->dentry->d_sb->s_root);
+        SaveDelete();
     }
 #endif
 
     return 0;
 }
 
+#if PATH_CACHE_SIZE
+static void IncrementPathEpoch()
+{
+    int zero = 0;
+    u64* epoch = path_epoch.lookup(&zero);
+    if (epoch != NULL) // will not fail, BPF wants the check though
+        __sync_fetch_and_add(epoch, 1);
+}
+
+static void CheckRenamedDirectory(struct dentry* dentry)
+{
+    struct inode* inode = dentry->d_inode;
+
+    if (inode != NULL && S_ISDIR(inode->i_mode))
+    {
+        u64 id = bpf_get_current_pid_tgid();
+        u8 one = 1;
+        IncrementPathEpoch();
+        renaming_directory.update(&id, &one);
+    }
+}
+
+// invalidates the path cache when a directory is renamed (also if the rename fails, which is rare and only costs some misses),
+// again when it returns as opens meanwhile may have cached the old paths
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 12, 0)
+int kprobe__vfs_rename(struct pt_regs *ctx, struct inode *old_dir, struct dentry *old_dentry, struct inode *new_dir, struct dentry *new_dentry)
+{
+#else
+int kprobe__vfs_rename(struct pt_regs *ctx, struct renamedata *rd)
+{
+    struct dentry *old_dentry = rd->old_dentry;
+    struct dentry *new_dentry = rd->new_dentry;
+#endif
+    CheckRenamedDirectory(old_dentry);
+    CheckRenamedDirectory(new_dentry); // RENAME_EXCHANGE
+    return 0;
+}
+
+int kretprobe__vfs_rename(struct pt_regs *ctx)
+{
+    u64 id = bpf_get_current_pid_tgid();
+
+    if (renaming_directory.lookup(&id) != NULL)
+    {
+        IncrementPathEpoch();
+        renaming_directory.delete(&id);
+    }
+    return 0;
+}
+#endif
+
 static int do_readwrite(struct file* file, size_t size, loff_t* pos, u8 type)
 {
     if (!CheckToLog())
@@ -502,8 +1056,7 @@ static int do_readwrite(struct file* file, size_t size, loff_t* pos, u8 type)
         saved.event.size = size;
         saved.event.offset = *pos;
 
-        u64 id = bpf_get_current_pid_tgid();
-        save.insert(&id, &saved);
+        SaveStore(&saved, true);
     }
 
     return 0;
@@ -547,22 +1100,213 @@ int probe__vfs_iocb_iter_read(struct pt_regs *ctx, struct file *file, struct kio
     return do_readwrite(file, iter->count, &iocb->ki_pos, TYPE_READ);
 }
 
-int retprobe__readwrites(struct pt_regs *ctx)
+static int do_ret_readwrite(struct pt_regs *ctx, s64 result)
 {
-    u64 id = bpf_get_current_pid_tgid();
-    struct save_t* saved = save.lookup(&id);
+    struct save_t* saved = SaveLookup();
 
     if (saved != NULL)
     {
-        saved->event.result = PT_REGS_RC(ctx);
-        FinalizeAndSubmitMainEvent(ctx, &saved->event);
-        save.delete(&id);
+        u64 cache_hits = 0;
+        u64 cache_misses = 0;
+#if TRACK_PAGE_CACHE
+        cache_misses = saved->cache_added;
+        if (saved->cache_accessed > saved->cache_added) // readahead may add more pages than the read accesses
+            cache_hits = saved->cache_accessed - saved->cache_added;
+#endif
+        saved->event.result = result;
+        FinalizeMainEvent(&saved->event);
+#if AGGREGATE_READWRITES
+        AggregateReadWrite(&saved->event, cache_hits, cache_misses);
+#endif
+#if SUBMIT_READWRITES
+#if TRACK_PAGE_CACHE
+        if (saved->event.type == TYPE_READ)
+        {
+            struct event_read_t record = {};
+            record.event = saved->event;
+            record.cache_hits = cache_hits;
+            record.cache_misses = cache_misses;
+            int res = event_main.ringbuf_output(&record, sizeof(record), WakeupFlags(sizeof(record)));
+            if (res != 0)
+                lost_events.increment(LOST_EVENT_MAIN);
+        }
+        else
+#endif
+        SubmitMainEvent(ctx, &saved->event);
+#endif
+        SaveDelete();
     }
 
     return 0;
 }
 
-#if FILTER_BY_PID
+int retprobe__readwrites(struct pt_regs *ctx)
+{
+    return do_ret_readwrite(ctx, PT_REGS_RC(ctx));
+}
+
+#if TRACK_BLOCK_IO
+// Block requests between issue to the device and completion. A request is attributed to the handle of the traced read / write
+// the current task is in when it is issued (reads, direct I/O, synchronous writes), else to the traced inode of its first page
+// (writeback, readahead issued by kworkers). Requests of neither are not tracked.
+// Submitted as event_main_t of type 'B': time_start / time_end are issue and last completion (the device service time), pid is
+// that of the read / write (0 if attributed by inode), handle_uid 0 if attributed by inode, result the first error, offset the
+// position on the device in bytes, size the bytes completed and flags the cmd_flags of the request (the operation in the low 8
+// bits). Drivers may complete a request in parts, it is submitted once all its bytes are.
+struct block_request_t
+{
+    struct event_main_t event;
+    unsigned int remaining; // bytes not completed yet
+};
+
+BPF_TABLE("lru_hash", struct request*, struct block_request_t, block_requests, SAVE_MAP_SIZE);
+
+// blk_mq_start_request, the request is handed to the driver
+int probe__block_issue(struct pt_regs *ctx, struct request *rq)
+{
+    struct block_request_t request = {};
+    struct save_t* saved = SaveLookup();
+
+    if (saved != NULL && (saved->event.type == TYPE_READ || saved->event.type == TYPE_WRITE))
+    {
+        request.event.pid = saved->event.pid;
+        request.event.inode_uid = saved->event.inode_uid;
+        request.event.handle_uid = saved->event.handle_uid;
+    }
+    else
+    {
+        struct bio* bio = rq->bio;
+        if (bio == NULL)
+            return 0;
+        struct address_space* mapping = bio->bi_io_vec->bv_page->mapping;
+        if (mapping == NULL || ((unsigned long)mapping & 1)) // anonymous pages (direct I/O of another task)
+            return 0;
+        unsigned long inode = mapping->host->i_ino;
+        struct saved_inode_t* saved_inode = inodes.lookup(&inode);
+        if (saved_inode == NULL)
+            return 0;
+        request.event.inode_uid = saved_inode->inode_uid;
+    }
+
+    request.event.type = TYPE_BLOCK;
+    request.event.time_start = bpf_ktime_get_ns();
+    request.event.offset = rq->__sector << 9;
+    request.event.flags = rq->cmd_flags;
+    request.remaining = rq->__data_len;
+    CountInsert(MAP_BLOCK_REQUESTS, block_requests.insert(&rq, &request));
+    return 0;
+}
+
+// block_rq_complete(struct request *rq, blk_status_t error, unsigned int nr_bytes), once per completed part of the request
+RAW_TRACEPOINT_PROBE(block_rq_complete)
+{
+    struct request* rq = (struct request*)ctx->args[0];
+    struct block_request_t* request = block_requests.lookup(&rq);
+
+    if (request == NULL)
+        return 0;
+
+    unsigned int nr_bytes = (unsigned int)ctx->args[2];
+    request->event.time_end = bpf_ktime_get_ns();
+    if (request->event.result == 0)
+        request->event.result = (int)ctx->args[1];
+    request->event.size += nr_bytes;
+    request->remaining = (nr_bytes < request->remaining) ? request->remaining - nr_bytes : 0;
+    if (request->remaining != 0)
+        return 0; // more parts follow
+
+    SubmitMainEvent((struct pt_regs*)ctx, &request->event);
+    CountDelete(MAP_BLOCK_REQUESTS, block_requests.delete(&rq));
+    return 0;
+}
+#endif
+
+#if TRACK_PAGE_CACHE
+// Page cache functions, called in the context of the reading task for the pages it reads. Only a lookup for tasks not in a
+// traced read. Attached to folio_mark_accessed / filemap_add_folio or, on kernels before folios, to mark_page_accessed /
+// add_to_page_cache_lru (the latter are wrappers of the former on newer kernels, so only one of each pair is attached).
+int probe__page_accessed(struct pt_regs *ctx)
+{
+    struct save_t* saved = SaveLookup();
+    if (saved != NULL && saved->event.type == TYPE_READ)
+        saved->cache_accessed++;
+    return 0;
+}
+
+int probe__page_added(struct pt_regs *ctx)
+{
+    struct save_t* saved = SaveLookup();
+    if (saved != NULL && saved->event.type == TYPE_READ)
+        saved->cache_added++;
+    return 0;
+}
+#endif
+
+#if USE_FENTRY
+// fentry / fexit programs for the functions called most, the fexit programs get arguments and return value. They are attached
+// automatically by their names. ctx is only used in perf buffer mode, which is not supported together with them.
+#if !FILESYSTEM_OPENS
+KFUNC_PROBE(vfs_open, const struct path *path, struct file *file)
+{
+    do_open(false, file);
+    return 0;
+}
+
+KFUNC_PROBE(do_filp_open, int dfd, struct filename *pathname, const struct open_flags *op)
+{
+    do_open(true, NULL);
+    return 0;
+}
+#endif
+
+KRETFUNC_PROBE(vfs_open, const struct path *path, struct file *file, int ret)
+{
+    do_ret_open((struct pt_regs*)ctx, ret, NULL);
+    return 0;
+}
+
+KRETFUNC_PROBE(do_filp_open, int dfd, struct filename *pathname, const struct open_flags *op, struct file *ret)
+{
+    do_ret_open((struct pt_regs*)ctx, IS_ERR_VALUE(ret) ? (s64)ret : 0, ret);
+    return 0;
+}
+
+KFUNC_PROBE(filp_close, struct file *file, fl_owner_t id)
+{
+    return do_close(file);
+}
+
+KRETFUNC_PROBE(filp_close, struct file *file, fl_owner_t id, int ret)
+{
+    return do_ret_close((struct pt_regs*)ctx, ret);
+}
+
+#if LOG_READS
+KFUNC_PROBE(vfs_read, struct file *file, char *buf, size_t count, loff_t *pos)
+{
+    return do_readwrite(file, count, pos, TYPE_READ);
+}
+
+KRETFUNC_PROBE(vfs_read, struct file *file, char *buf, size_t count, loff_t *pos, ssize_t ret)
+{
+    return do_ret_readwrite((struct pt_regs*)ctx, ret);
+}
+#endif
+
+#if LOG_WRITES
+KFUNC_PROBE(vfs_write, struct file *file, const char *buf, size_t count, loff_t *pos)
+{
+    return do_readwrite(file, count, pos, TYPE_WRITE);
+}
+
+KRETFUNC_PROBE(vfs_write, struct file *file, const char *buf, size_t count, loff_t *pos, ssize_t ret)
+{
+    return do_ret_readwrite((struct pt_regs*)ctx, ret);
+}
+#endif
+#endif
+
+// called for every exiting thread, drops what it left in the maps (a call it did not return from) and removes it from the pid filter
 TRACEPOINT_PROBE(sched, sched_process_exit)
 {
     // args is defined as seen /sys/kernel/debug/tracing/events/sched/sched_process_exit/format
@@ -581,8 +1325,16 @@ TRACEPOINT_PROBE(sched, sched_process_exit)
     #define args real_args
     #endif
 
+    u64 id = bpf_get_current_pid_tgid(); // of the exiting thread
+#if !USE_FENTRY // task local storage is freed with the task
+    CountDelete(MAP_SAVE, save.delete(&id));
+#endif
+    CountDelete(MAP_SAVE_DELETE, save_delete.delete(&id));
+
+#if FILTER_BY_PID
     pid_t pid = args->pid;
     log_pids.delete(&pid);
+#endif
 
     #ifdef EDITOR_ONLY
     #undef args
@@ -590,7 +1342,7 @@ TRACEPOINT_PROBE(sched, sched_process_exit)
     return 0;
 }
 
-#if INCLUDE_CHILD_PROCESSES
+#if FILTER_BY_PID && INCLUDE_CHILD_PROCESSES
 TRACEPOINT_PROBE(sched, sched_process_fork)
 {
     // args is defined as seen /sys/kernel/debug/tracing/events/sched/sched_process_fork/format
@@ -625,6 +1377,5 @@ TRACEPOINT_PROBE(sched, sched_process_fork)
     return 0;
 }
 #endif
-#endif
 
 //------BPF_END------
@@ -1,10 +1,18 @@
+// core/cgroup_informer.bpf.c is the precompiled CO-RE version of this program, changes have to be made in both
+
 // don't include in string to compile with BCC:
 #include <helpers.h> // BPF stuff
 #include <linux/err.h>
 
 #define EDITOR_ONLY // stuff only defined for editing this file and having autocomplete, not relevant for the actual BPF program
 
+#define FILTER_BY_CGROUP 1
+#define CGROUP_FILTER_SIZE 4 // number of cgroups to report the forks in
+#define TRACK_EXITS 1 // also report the exits of tasks (every thread, like the forks)
+
 #define RB_PAGES_EVENT_MAIN 8
+#define RB_WAKEUP_BYTES 8192 // wake up the consumer only once this many bytes are pending, 0 to wake it up for every record
+#define RB_WAKEUP_NS 10000000 // or once this long passed since the last wakeup
 
 // compile with BCC the code below:
 //------BPF_START------
@@ -17,16 +25,76 @@
 #include <linux/sched.h>
 #include <linux/cgroup.h>
 
+enum event_type_t : u8
+{
+    TYPE_FORK = 'F',
+    TYPE_EXIT = 'E'
+};
+
 struct event_main_t
 {
     u64 time;
-    u32 ppid;
+    u32 ppid; // 0 for exits
     u32 pid;
     u64 cgroupid;
+    u8 type;
 };
 
 BPF_RINGBUF_OUTPUT(event_main, RB_PAGES_EVENT_MAIN);
 
+#if FILTER_BY_CGROUP
+// cgroup v2 directories to report the forks in, including all cgroups below them
+BPF_CGROUP_ARRAY(log_cgroups, CGROUP_FILTER_SIZE);
+#endif
+
+// the child is in the cgroup of the parent, which is the current task
+static bool CheckToLog()
+{
+#if FILTER_BY_CGROUP
+    bool in_cgroup = false;
+    #pragma unroll
+    for (int i = 0; i < CGROUP_FILTER_SIZE; i++)
+    {
+        if (log_cgroups.check_current_task(i) == 1)
+        {
+            in_cgroup = true;
+            break;
+        }
+    }
+
+    if (!in_cgroup)
+        return false;
+#endif
+
+    return true;
+}
+
+#if RB_WAKEUP_BYTES
+BPF_ARRAY(last_wakeup, u64, 1);
+#endif
+
+// same as in bpf.cpp: only wake up the consumer once enough data is pending or the last wakeup is too long ago
+static u64 WakeupFlags(u32 size)
+{
+#if RB_WAKEUP_BYTES
+    int zero = 0;
+    u64 now = bpf_ktime_get_ns();
+    u64* last = last_wakeup.lookup(&zero);
+
+    if (last == NULL) // will not fail, BPF wants the check though
+        return 0;
+
+    if (event_main.ringbuf_query(BPF_RB_AVAIL_DATA) + size >= RB_WAKEUP_BYTES || now - *last >= RB_WAKEUP_NS)
+    {
+        *last = now;
+        return BPF_RB_FORCE_WAKEUP;
+    }
+    return BPF_RB_NO_WAKEUP;
+#else
+    return 0;
+#endif
+}
+
 // use internal function 'wake_up_new_task' instead of the fork tracepoint / syscall as here we get the fully prepared task struct of the child (which the fork tracepoint does not provide)
 // source: https://research.nccgroup.com/2021/08/06/some-musings-on-common-ebpf-linux-tracing-bugs/
 /*
@@ -63,13 +131,55 @@ TRACEPOINT_PROBE(sched, sched_process_fork)
     #endif
     #define ctx args // args can be used as ctx for perfbuf mode
 
-    struct event_main_t event;
+    if (!CheckToLog())
+        return 0;
+
+    struct event_main_t event = {};
     event.time = bpf_ktime_get_ns();
     event.ppid = args->parent_pid;
     event.pid = args->child_pid;
     //event.cgroupid = task_dfl_cgroup(child)->kn->id; // this is what bpf_get_current_cgroup_id does (on the current task)
     event.cgroupid = bpf_get_current_cgroup_id();
-    event_main.ringbuf_output(&event, sizeof(event), 0);
+    event.type = TYPE_FORK;
+    event_main.ringbuf_output(&event, sizeof(event), WakeupFlags(sizeof(event)));
+
+    #undef ctx
+    #ifdef EDITOR_ONLY
+    #undef args
+    #endif
+    return 0;
+}
+
+#if TRACK_EXITS
+TRACEPOINT_PROBE(sched, sched_process_exit)
+{
+    // args is defined as seen /sys/kernel/debug/tracing/events/sched/sched_process_exit/format
+    #ifdef EDITOR_ONLY
+    struct
+    {
+        u16 common_type;
+        u8 common_flags;
+        u8 common_preempt_count;
+        s32 common_pid;
+
+        char comm[16];
+        pid_t pid;
+        int prio;
+    } *real_args;
+    #define args real_args
+    #endif
+    #define ctx args // args can be used as ctx for perfbuf mode
+
+    if (!CheckToLog())
+        return 0;
+
+    // called for every thread like the fork tracepoint, the exiting task is the current one
+    struct event_main_t event = {};
+    event.time = bpf_ktime_get_ns();
+    event.pid = args->pid;
+    event.cgroupid = bpf_get_current_cgroup_id();
+    event.type = TYPE_EXIT;
+    event_main.ringbuf_output(&event, sizeof(event), WakeupFlags(sizeof(event)));
 
     #undef ctx
     #ifdef EDITOR_ONLY
@@ -77,3 +187,4 @@ TRACEPOINT_PROBE(sched, sched_process_fork)
     #endif
     return 0;
 }
+#endif
@@ -3,6 +3,7 @@ import sys
 
 # takes csv log on stdin and puts it into the sqlite db specified in argument 1
 # example usage: cat log.csv | python3 log2db.py log.db
+# native/log2db imports large logs much faster into the same table
 
 conn = sqlite3.connect(sys.argv[1])
 c = conn.cursor()
@@ -0,0 +1,110 @@
+import ctypes
+import os
+import sys
+import time
+
+# python bindings of liblogparse (data/native), parses a whole log into columns on all cores
+# example usage:
+#   log = logparse.LogFile('trace.csv')
+#   reads = log.column('size')[log.column('type') == ord('R')]  # numpy arrays if numpy is installed
+#   log.path(0)
+# run directly it prints the number of records and the parse time: python3 logparse.py trace.csv
+
+# name, ctypes type, as in LogAnalysis::Column
+COLUMNS = [
+    ('time_start', ctypes.c_uint64),    # realtime ns
+    ('time_end', ctypes.c_uint64),
+    ('utime_start', ctypes.c_uint64),   # ns
+    ('utime_end', ctypes.c_uint64),
+    ('stime_start', ctypes.c_uint64),
+    ('stime_end', ctypes.c_uint64),
+    ('pid', ctypes.c_int32),
+    ('inode', ctypes.c_uint64),
+    ('type', ctypes.c_uint8),           # ascii code of the event type
+    ('result', ctypes.c_int64),
+    ('handle', ctypes.c_int64),
+    ('offset', ctypes.c_uint64),
+    ('size', ctypes.c_uint64),
+    ('flags', ctypes.c_uint64),
+    ('cgroup_id', ctypes.c_uint64),     # 0 for text logs
+]
+FORMAT_TEXT = 0
+FORMAT_BINARY = 1
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+_library = None
+
+
+def load_library(path=None):
+    global _library
+    if _library is None:
+        path = path or os.environ.get('LOGPARSE_LIBRARY') or os.path.join(os.path.dirname(os.path.abspath(__file__)), 'native', 'build', 'liblogparse.so')
+        _library = ctypes.CDLL(path)
+        _library.logparse_open.restype = ctypes.c_void_p
+        _library.logparse_open.argtypes = [ctypes.c_char_p, ctypes.c_uint, ctypes.POINTER(ctypes.c_int)]
+        _library.logparse_close.argtypes = [ctypes.c_void_p]
+        _library.logparse_format.argtypes = [ctypes.c_void_p]
+        _library.logparse_records.restype = ctypes.c_uint64
+        _library.logparse_records.argtypes = [ctypes.c_void_p]
+        _library.logparse_column.restype = ctypes.c_void_p
+        _library.logparse_column.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_uint64)]
+        _library.logparse_path.restype = ctypes.c_void_p
+        _library.logparse_path.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.POINTER(ctypes.c_uint64)]
+    return _library
+
+
+class LogFile:
+    # csv of fileaccess.py / fileaccess or a logfs segment, threads 0 uses all cores
+    def __init__(self, path, threads=0):
+        self._handle = None
+        self._lib = load_library()
+        error = ctypes.c_int(0)
+        self._handle = self._lib.logparse_open(os.fsencode(path), threads, ctypes.byref(error))
+        if not self._handle:
+            raise OSError(-error.value, os.strerror(-error.value), path)
+        self.records = self._lib.logparse_records(self._handle)
+        self.format = self._lib.logparse_format(self._handle)
+
+    def close(self):
+        if self._handle:
+            self._lib.logparse_close(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def __len__(self):
+        return self.records
+
+    # the column without a copy, only valid until close
+    def column(self, name):
+        index = [column[0] for column in COLUMNS].index(name)
+        data = self._lib.logparse_column(self._handle, index, None)
+        array = (COLUMNS[index][1] * self.records).from_address(data) if self.records else (COLUMNS[index][1] * 0)()
+        return numpy.ctypeslib.as_array(array) if numpy is not None and self.records else array
+
+    def path(self, index):
+        length = ctypes.c_uint64(0)
+        data = self._lib.logparse_path(self._handle, index, ctypes.byref(length))
+        if data is None:
+            raise IndexError(index)
+        return ctypes.string_at(data, length.value).decode(errors='replace')
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('usage: logparse.py <log> [threads]')
+        sys.exit(1)
+    start = time.perf_counter()
+    with LogFile(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 0) as log:
+        print('Records: %d (%s), parsed in %.3f s' % (log.records, 'binary' if log.format == FORMAT_BINARY else 'text', time.perf_counter() - start))
@@ -0,0 +1,75 @@
+#ifndef LOGANALYSIS_COVERAGEMAP_HPP
+#define LOGANALYSIS_COVERAGEMAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LogAnalysis
+{
+    // How often each byte of a file was accessed, as a step function: sorted steps (offset, count), the count holds up to the
+    // next step, the last step has count 0. Ranges are added in any order and buffered, the buffer is sorted and merged into the
+    // steps once it is as large as them, so memory grows with the distinct range boundaries instead of the records. Maps of the
+    // same file built by different threads are combined with merge().
+    class CoverageMap
+    {
+    public:
+        struct Step
+        {
+            uint64_t offset;
+            uint32_t count;
+        };
+
+        // counts [begin, end) count times more
+        void add(uint64_t begin, uint64_t end, uint32_t count = 1)
+        {
+            if (begin < end && count != 0)
+            {
+                pending.push_back({ begin, end, count });
+                if (pending.size() >= std::max<size_t>(MinPending, steps.size()))
+                {
+                    flush();
+                }
+            }
+        }
+
+        void merge(const CoverageMap &other);
+        // merges the buffered ranges into the steps, queries do so as well (so a map must not be queried by several threads
+        // while ranges are buffered)
+        void flush() const;
+
+        // the bytes accessed at least minCount times
+        uint64_t covered(uint32_t minCount = 1) const;
+        // the bytes accessed, repeated accesses counted each time
+        uint64_t total() const;
+        // the bytes accessed again after their first access
+        uint64_t repeated() const { return total() - covered(); }
+        // share of [0, size) accessed at least once
+        double fraction(uint64_t size) const;
+        // the bytes accessed in both maps
+        uint64_t overlap(const CoverageMap &other) const;
+        // the bytes accessed as a map with count 1, summing these counts in how many maps a byte was accessed
+        CoverageMap presence() const;
+
+        bool empty() const { return pending.empty() && steps.empty(); }
+        uint64_t lower() const; // start of the first and end of the last accessed byte, only if not empty
+        uint64_t upper() const;
+        const std::vector<Step> &intervals() const { flush(); return steps; }
+
+    private:
+        struct Range
+        {
+            uint64_t begin;
+            uint64_t end;
+            uint32_t count;
+        };
+
+        static constexpr size_t MinPending = 1024;
+
+        mutable std::vector<Step> steps;
+        mutable std::vector<Range> pending;
+    };
+}
+
+#endif // guard
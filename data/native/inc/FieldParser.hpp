@@ -0,0 +1,132 @@
+#ifndef LOGANALYSIS_FIELDPARSER_HPP
+#define LOGANALYSIS_FIELDPARSER_HPP
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+// Parsing of the right aligned, space padded number fields of the fixed width text records (LogFs::TextRecord).
+// Digits are converted 8 at a time within a 64 bit register (SWAR), which needs no instruction set specific code.
+namespace LogAnalysis
+{
+    static_assert(std::endian::native == std::endian::little, "The SWAR parsing assumes little endian.");
+
+    namespace Swar
+    {
+        constexpr uint64_t Repeat(uint8_t byte) { return 0x0101010101010101ULL * byte; }
+
+        inline uint64_t Load(const char *data)
+        {
+            uint64_t chunk;
+            std::memcpy(&chunk, data, sizeof(chunk));
+            return chunk;
+        }
+
+        // all 8 bytes are '0' - '9'
+        inline bool AllDigits(uint64_t chunk)
+        {
+            return (((chunk & Repeat(0xF0)) | (((chunk + Repeat(0x06)) & Repeat(0xF0)) >> 4)) == Repeat(0x33));
+        }
+
+        // value of 8 digits, the first one is the most significant
+        inline uint64_t Parse8(uint64_t chunk)
+        {
+            chunk -= Repeat('0');
+            chunk = (chunk * 10) + (chunk >> 8); // pairs
+            chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+                + (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+            return chunk;
+        }
+
+        // number of leading spaces of the 8 bytes
+        inline int LeadingSpaces(uint64_t chunk)
+        {
+            uint64_t other = chunk ^ Repeat(' '); // 0 bytes are spaces
+            return (other == 0) ? 8 : std::countr_zero(other) / 8;
+        }
+    }
+
+    // Parses a field of width bytes: spaces, an optional '-' and digits. Parsing stops at the first other character.
+    inline int64_t ParseSigned(const char *field, int width)
+    {
+        const char *cur = field;
+        const char *end = field + width;
+        while (end - cur >= 8)
+        {
+            int spaces = Swar::LeadingSpaces(Swar::Load(cur));
+            cur += spaces;
+            if (spaces != 8)
+            {
+                break;
+            }
+        }
+        while (cur != end && *cur == ' ')
+        {
+            cur++;
+        }
+        bool negative = (cur != end && *cur == '-');
+        if (negative)
+        {
+            cur++;
+        }
+
+        uint64_t value = 0;
+        while (end - cur >= 8)
+        {
+            uint64_t chunk = Swar::Load(cur);
+            if (!Swar::AllDigits(chunk))
+            {
+                break;
+            }
+            value = value * 100000000 + Swar::Parse8(chunk);
+            cur += 8;
+        }
+        for (; cur != end && *cur >= '0' && *cur <= '9'; cur++)
+        {
+            value = value * 10 + (*cur - '0');
+        }
+        return negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    }
+
+    inline uint64_t ParseUnsigned(const char *field, int width)
+    {
+        return static_cast<uint64_t>(ParseSigned(field, width));
+    }
+
+    // "seconds.milliseconds" as written for the times, in ns
+    inline uint64_t ParseTime(const char *field, int secWidth, int msecWidth)
+    {
+        uint64_t sec = ParseUnsigned(field, secWidth);
+        uint64_t msec = ParseUnsigned(field + secWidth + 1, msecWidth);
+        return (sec * 1000 + msec) * 1000000;
+    }
+
+    // "0x" followed by width - 2 hex digits
+    inline uint64_t ParseHex(const char *field, int width)
+    {
+        uint64_t value = 0;
+        for (const char *cur = field + 2; cur != field + width; cur++)
+        {
+            char c = *cur;
+            int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0)
+            {
+                break;
+            }
+            value = (value << 4) | digit;
+        }
+        return value;
+    }
+
+    // length of the path without the padding
+    inline int TrimmedLength(const char *field, int width)
+    {
+        while (width > 0 && (field[width - 1] == ' ' || field[width - 1] == '\0'))
+        {
+            width--;
+        }
+        return width;
+    }
+}
+
+#endif // guard
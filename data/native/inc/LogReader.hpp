@@ -0,0 +1,119 @@
+#ifndef LOGANALYSIS_LOGREADER_HPP
+#define LOGANALYSIS_LOGREADER_HPP
+
+#include <LogFormat.hpp>
+#include <MappedFile.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Columnar parser of the file access logs: the csv of fileaccess.py / fileaccess (fixed width text records) and
+// logfs segments (text, binary or lz4 compressed). The file is mapped and the records are split across threads by index.
+namespace LogAnalysis
+{
+    enum class Column : int
+    {
+        TimeStart = 0, // uint64_t realtime ns (ms resolution for text records)
+        TimeEnd,
+        UTimeStart, // uint64_t ns
+        UTimeEnd,
+        STimeStart,
+        STimeEnd,
+        Pid, // int32_t
+        Inode, // uint64_t
+        Type, // char
+        Result, // int64_t
+        Handle, // int64_t
+        Offset, // uint64_t
+        Size,
+        Flags,
+        CgroupId, // uint64_t, 0 for text records
+        Count
+    };
+
+    struct LogColumns
+    {
+        std::vector<uint64_t> timeStart, timeEnd, uTimeStart, uTimeEnd, sTimeStart, sTimeEnd;
+        std::vector<int32_t> pid;
+        std::vector<uint64_t> inode;
+        std::vector<char> type;
+        std::vector<int64_t> result, handle;
+        std::vector<uint64_t> offset, size, flags, cgroupId;
+        // path of record i: pathLength[i] bytes at pathOffset[i] of LogReader::data()
+        std::vector<uint64_t> pathOffset;
+        std::vector<uint16_t> pathLength;
+
+        size_t records() const { return type.size(); }
+        void resize(size_t records);
+        // data and element size of a column
+        const void *column(Column column, size_t &elementSize) const;
+    };
+
+    class LogReader
+    {
+    public:
+        // maps the log and locates its records, returns -errno (-ENOTSUP for compressed segments without lz4).
+        // Without locateRecords binary records are not walked, records() is 0 then and they are only read by offset.
+        int open(const std::string &path, unsigned threads = 0, bool locateRecords = true);
+        void close();
+
+        LogFs::LogFormat format() const { return logFormat; }
+        size_t records() const { return (logFormat == LogFs::LogFormat::Text) ? recordCount : starts.size(); }
+        // the records (decompressed for compressed segments)
+        const char *data() const { return begin; }
+        size_t dataSize() const { return end - begin; }
+        // byte offset of record index in data()
+        uint64_t recordOffset(size_t index) const { return (logFormat == LogFs::LogFormat::Text && starts.empty()) ? index * entrySize : starts[index]; }
+
+        // parses count records from first into columns (resized to count) using the threads of open
+        void parse(size_t first, size_t count, LogColumns &columns) const;
+        void parse(LogColumns &columns) const { parse(0, records(), columns); }
+        // parses the records at the offsets (see recordOffset) into columns
+        void parseAt(const uint64_t *offsets, size_t count, LogColumns &columns) const;
+        // offsets of up to count records from the one at offset
+        void walk(uint64_t offset, size_t count, std::vector<uint64_t> &offsets) const;
+
+        std::string_view path(const LogColumns &columns, size_t index) const
+        {
+            return { begin + columns.pathOffset[index], columns.pathLength[index] };
+        }
+
+    private:
+        int locate(const char *data, size_t size, bool locateRecords);
+        int decompress(const char *data, size_t size);
+        // text records not all of entrySize bytes, located by their newlines into starts
+        void locateLines(const char *data, size_t size);
+        // bytes of the text record at offset including its newline, 0 if it is incomplete
+        size_t textLength(uint64_t offset) const;
+        void parseText(size_t first, size_t count, size_t out, LogColumns &columns) const;
+        void parseBinary(size_t first, size_t count, size_t out, LogColumns &columns) const;
+        void parseTextRecord(const char *record, size_t length, size_t out, LogColumns &columns) const;
+        void parseBinaryRecord(const char *record, size_t out, LogColumns &columns) const;
+
+        MappedFile file;
+        std::vector<char> raw; // decompressed segment
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        LogFs::LogFormat logFormat = LogFs::LogFormat::Text;
+        size_t entrySize = LogFs::TextRecord::SizeEntry; // depends on --pathoutput of fileaccess.py
+        size_t recordCount = 0; // text
+        std::vector<uint64_t> starts; // binary or text of different lengths, offsets of the records
+        unsigned threads = 1;
+    };
+}
+
+// C API of liblogparse, e.g. for ctypes (see data/logparse.py). The whole log is parsed by logparse_open.
+extern "C"
+{
+    void *logparse_open(const char *path, unsigned threads, int *error); // threads 0: all cores, nullptr on error (-errno)
+    void logparse_close(void *log);
+    int logparse_format(void *log); // LogFs::LogFormat
+    uint64_t logparse_records(void *log);
+    const void *logparse_column(void *log, int column, uint64_t *elementSize); // LogAnalysis::Column, nullptr if invalid
+    const char *logparse_path(void *log, uint64_t index, uint64_t *length);
+}
+
+#endif // guard
@@ -0,0 +1,31 @@
+#ifndef LOGANALYSIS_MAPPEDFILE_HPP
+#define LOGANALYSIS_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace LogAnalysis
+{
+    // Read-only mapping of a whole file.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile &operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        // returns -errno on error, sequential: the file is read front to back (more readahead)
+        int open(const std::string &path, bool sequential = true);
+        void close();
+
+        const char *data() const { return base; }
+        size_t size() const { return length; }
+
+    private:
+        const char *base = nullptr;
+        size_t length = 0;
+    };
+}
+
+#endif // guard
@@ -0,0 +1,42 @@
+#ifndef LOGANALYSIS_PARALLEL_HPP
+#define LOGANALYSIS_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace LogAnalysis
+{
+    // threads to use for a thread count option, 0 meaning all cores
+    inline unsigned Threads(unsigned threads)
+    {
+        return (threads != 0) ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Calls fn(first, last) for consecutive ranges of [0, count) on up to threads threads, ranges are at least minChunk long
+    // (another thread is not worth starting for less). The calling thread takes the first range.
+    template<typename Function>
+    void ParallelFor(size_t count, unsigned threads, size_t minChunk, Function fn)
+    {
+        size_t chunks = std::clamp<size_t>(count / std::max<size_t>(minChunk, 1), 1, std::max(threads, 1u));
+        if (chunks == 1)
+        {
+            fn(size_t(0), count);
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(chunks - 1);
+        for (size_t i = 1; i < chunks; i++)
+        {
+            workers.emplace_back(fn, count * i / chunks, count * (i + 1) / chunks);
+        }
+        fn(size_t(0), count / chunks);
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+#endif // guard
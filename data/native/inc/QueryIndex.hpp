@@ -0,0 +1,92 @@
+#ifndef LOGANALYSIS_QUERYINDEX_HPP
+#define LOGANALYSIS_QUERYINDEX_HPP
+
+#include <MappedFile.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Sidecar index of a log (<log>.qidx) for logfs-query: a sparse time index over blocks of records and the offsets of the records
+// of every pid, inode and handle. Offsets are those of LogReader::recordOffset, so records are read without scanning the log.
+namespace LogAnalysis
+{
+    // Records [offset, offset + records) in log order, the times are the min / max time_start of the block.
+    struct QueryIndexBlock
+    {
+        uint64_t minTime;
+        uint64_t maxTime;
+        uint64_t offset;
+        uint64_t records;
+    };
+
+    // Value of a key and its postings[first, first + count), which are sorted record offsets.
+    struct QueryIndexKey
+    {
+        uint64_t value;
+        uint64_t first;
+        uint64_t count;
+    };
+
+    // The header is followed by the blocks, then per key the QueryIndexKeys (sorted by value) and the postings.
+    struct QueryIndexHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t blockRecords;
+        uint64_t logSize; // size and modification time of the log when indexed, the index is rebuilt if they differ
+        int64_t logMtime;
+        uint64_t records;
+        uint64_t blocks;
+        uint64_t keys[3];
+        uint64_t postings[3];
+
+        static constexpr char Magic[8] = { 'L', 'O', 'G', 'Q', 'I', 'D', 'X', '\0' };
+        static constexpr uint32_t Version = 1;
+    };
+
+    static_assert(sizeof(QueryIndexHeader) % 8 == 0, "QueryIndexHeader has to keep the sections aligned.");
+
+    class QueryIndex
+    {
+    public:
+        enum Key
+        {
+            Pid = 0,
+            Inode,
+            Handle,
+            KeyCount
+        };
+
+        static constexpr uint32_t BlockRecords = 4096;
+
+        static std::string SidecarPath(const std::string &log) { return log + ".qidx"; }
+        // the logs of path: the file itself or the logfs segments (segment-*.log) and csv files of a directory, in order
+        static std::vector<std::string> Logs(const std::string &path);
+        // whether the sidecar of log exists and matches it
+        static bool Fresh(const std::string &log);
+        // indexes log, the sidecar is replaced atomically. Returns -errno.
+        static int Build(const std::string &log, unsigned threads = 0);
+        // builds the sidecars of the logs that have none or a stale one, returns the number built or -errno
+        static int Update(const std::vector<std::string> &logs, unsigned threads = 0, bool verbose = false);
+
+        // maps the sidecar of log, -ESTALE if it does not match the log
+        int open(const std::string &log);
+
+        std::span<const QueryIndexBlock> blocks() const { return { blockData, header.blocks }; }
+        // sorted offsets of the records with the value of key, empty if none
+        std::span<const uint64_t> find(Key key, uint64_t value) const;
+        uint64_t records() const { return header.records; }
+
+    private:
+        MappedFile file;
+        QueryIndexHeader header{};
+        const QueryIndexBlock *blockData = nullptr;
+        const QueryIndexKey *keyData[KeyCount] = {};
+        const uint64_t *postingData[KeyCount] = {};
+    };
+}
+
+#endif // guard
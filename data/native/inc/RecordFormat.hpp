@@ -0,0 +1,79 @@
+#ifndef LOGANALYSIS_RECORDFORMAT_HPP
+#define LOGANALYSIS_RECORDFORMAT_HPP
+
+#include <LogReader.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Writing parsed records in the log formats again.
+namespace LogAnalysis
+{
+    // header line of fileaccess.py
+    constexpr const char TextHeader[] = "time_start,time_end,pid,utime_start,utime_end,stime_start,stime_end,inode_uid,type,result,handle_uid,offset,size,flags,path\n";
+
+    // longest path of a binary record, its length is 16 bit
+    constexpr size_t MaxBinaryPath = 4096;
+
+    // appends record i as fixed width text record (LogFs::TextRecord, same as LogEntry::getTextBuf of logfs)
+    inline void AppendText(std::string &out, const LogColumns &columns, size_t i, std::string_view path)
+    {
+        using T = LogFs::TextRecord;
+        auto Sec = [](uint64_t ns) { return static_cast<unsigned long long>(ns / 1000000000); };
+        auto Msec = [](uint64_t ns) { return static_cast<unsigned long long>((ns % 1000000000) / 1000000); };
+        char buffer[T::OffPath + 1];
+        std::snprintf(buffer, sizeof(buffer),
+            "%*llu.%0*llu,%*llu.%0*llu,%*d,%*llu.%0*llu,%*llu.%0*llu,%*llu.%0*llu,%*llu.%0*llu,%*llu,%c,%*lld,%*lld,%*llu,%*llu,0x%0*llx,",
+            T::SizeTimeSec, Sec(columns.timeStart[i]), T::SizeTimeNsec, Msec(columns.timeStart[i]),
+            T::SizeTimeSec, Sec(columns.timeEnd[i]), T::SizeTimeNsec, Msec(columns.timeEnd[i]),
+            T::SizePid, columns.pid[i],
+            T::SizeTimeSec, Sec(columns.uTimeStart[i]), T::SizeTimeNsec, Msec(columns.uTimeStart[i]),
+            T::SizeTimeSec, Sec(columns.uTimeEnd[i]), T::SizeTimeNsec, Msec(columns.uTimeEnd[i]),
+            T::SizeTimeSec, Sec(columns.sTimeStart[i]), T::SizeTimeNsec, Msec(columns.sTimeStart[i]),
+            T::SizeTimeSec, Sec(columns.sTimeEnd[i]), T::SizeTimeNsec, Msec(columns.sTimeEnd[i]),
+            T::SizeInode, static_cast<unsigned long long>(columns.inode[i]),
+            columns.type[i],
+            T::SizeResult, static_cast<long long>(columns.result[i]),
+            T::SizeFilehandle, static_cast<long long>(columns.handle[i]),
+            T::SizeOffset, static_cast<unsigned long long>(columns.offset[i]),
+            T::SizeSize, static_cast<unsigned long long>(columns.size[i]),
+            T::SizeFlags - 2, static_cast<unsigned long long>(columns.flags[i]));
+        out.append(buffer, T::OffPath);
+        path = path.substr(0, T::SizePath);
+        out.append(path);
+        out.append(T::SizePath - path.size(), ' ');
+        out.push_back('\n');
+    }
+
+    // appends record i as LogFs::BinaryRecord with its path, comm is not parsed and stays empty
+    inline void AppendBinary(std::string &out, const LogColumns &columns, size_t i, std::string_view path)
+    {
+        path = path.substr(0, MaxBinaryPath);
+        LogFs::BinaryRecord record{};
+        record.length = LogFs::BinaryRecord::RecordLength(path.size());
+        record.pathLength = path.size();
+        record.event = columns.type[i];
+        record.pid = columns.pid[i];
+        record.result = static_cast<int32_t>(std::clamp<int64_t>(columns.result[i], INT32_MIN, INT32_MAX));
+        record.flags = columns.flags[i];
+        record.rTimeStart = columns.timeStart[i];
+        record.rTimeEnd = columns.timeEnd[i];
+        record.uTimeStart = columns.uTimeStart[i];
+        record.uTimeEnd = columns.uTimeEnd[i];
+        record.sTimeStart = columns.sTimeStart[i];
+        record.sTimeEnd = columns.sTimeEnd[i];
+        record.inode = columns.inode[i];
+        record.filehandle = columns.handle[i];
+        record.offset = columns.offset[i];
+        record.size = columns.size[i];
+        record.cgroupId = columns.cgroupId[i];
+        out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        out.append(path);
+        out.append(record.length - sizeof(record) - path.size(), '\0');
+    }
+}
+
+#endif // guard
@@ -0,0 +1,118 @@
+#ifndef LOGANALYSIS_WORKFLOWANALYSIS_HPP
+#define LOGANALYSIS_WORKFLOWANALYSIS_HPP
+
+#include <CoverageMap.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Native version of the data preparation of nextflow_eval.py: tasks from the Nextflow log, their pids from the cgroups.csv and
+// the opens of .command.sh / .versions.yml, and per file and pid the accesses of the tasks with the same statistics.
+// Times are realtime ns (ms resolution of the text logs).
+namespace LogAnalysis
+{
+    enum AccessPattern : uint32_t
+    {
+        PatternRead = 0b0001,
+        PatternWrite = 0b0010,
+        PatternRandom = 0b0100,
+        PatternSequential = 0b1000
+    };
+
+    // analyse_accesses of nextflow_eval.py over the reads or writes of a pid, ranges are [offset, offset + size)
+    struct AccessAnalysis
+    {
+        uint64_t minOffset = 0;
+        uint64_t maxOffset = 0;
+        uint64_t uniqueBytes = 0;
+        uint64_t repetitiveBytes = 0;
+        uint64_t totalBytes = 0;
+        bool seekUp = false;
+        bool seekDown = false;
+        uint64_t firstAccess = 0; // time of the first and the last access in log order
+        uint64_t lastAccess = 0;
+    };
+
+    // how a pid accesses a file
+    struct FileAccesses
+    {
+        int32_t pid = 0;
+        bool hasPath = false;
+        std::string path; // of the last open
+        uint64_t opens = 0, closes = 0, reads = 0, writes = 0, deletes = 0;
+        uint32_t pattern = 0;
+        AccessAnalysis analysisReads;
+        AccessAnalysis analysisWrites;
+        uint64_t firstLog = UINT64_MAX;
+        uint64_t lastLog = 0;
+    };
+
+    // the bytes of a file read by the pids of a task
+    struct TaskCoverage
+    {
+        size_t task = 0; // index in WorkflowAnalysis::tasks()
+        CoverageMap reads;
+    };
+
+    struct FileStats
+    {
+        size_t folder = 0;
+        uint64_t inode = 0;
+        std::string path; // first path the file was opened through, empty if none
+        uint64_t totalReads = 0, totalReadSize = 0, totalWrites = 0, totalWriteSize = 0;
+        uint64_t fileSize = 0; // max offset read from or written to
+        std::vector<FileAccesses> accesses; // by pid
+        CoverageMap reads, writes; // of all pids, by offset and size like analyse_accesses
+        std::vector<TaskCoverage> taskReads; // by task
+    };
+
+    // one TaskHandler line of the Nextflow log
+    struct TaskInfo
+    {
+        int64_t id = 0;
+        std::string name, status, exit, error, workdir, logicalName;
+        uint64_t firstLog = UINT64_MAX; // UINT64_MAX: no records of the task
+        uint64_t lastLog = 0;
+        std::vector<int32_t> pids; // sorted
+        std::vector<size_t> files; // indexes in WorkflowAnalysis::files(), sorted
+    };
+
+    class WorkflowAnalysis
+    {
+    public:
+        // Analyses the folders below the given ones that contain a cgroups.csv and file-bpf.csv. workdirPrefix is removed from the
+        // work directories of the tasks. Returns -errno, problems with single records are reported to stderr like the script does.
+        int run(const std::string &nextflowLog, const std::string &workdirPrefix, const std::vector<std::string> &folders, unsigned threads = 0);
+
+        const std::vector<std::string> &folders() const { return dataFolders; }
+        const std::vector<TaskInfo> &tasks() const { return taskList; }
+        const std::vector<FileStats> &files() const { return fileList; }
+
+        // the bytes of the files read by both tasks
+        uint64_t overlap(size_t taskA, size_t taskB) const;
+
+        // overlaps adds the overlap of all task pairs that read the same bytes
+        std::string json(bool overlaps = false) const;
+
+    private:
+        int readTasks(const std::string &nextflowLog, const std::string &workdirPrefix);
+        int analyseFolder(size_t folder);
+
+        unsigned threads = 1;
+        std::vector<std::string> dataFolders;
+        std::vector<TaskInfo> taskList;
+        std::vector<FileStats> fileList;
+    };
+}
+
+// C API of libworkflow for ctypes (see data/workflow_analysis.py), the results are returned as json.
+extern "C"
+{
+    void *workflow_analyse(const char *nextflowLog, const char *workdirPrefix, const char **folders, int folderCount, unsigned threads, int *error);
+    const char *workflow_json(void *analysis); // valid until workflow_close
+    void workflow_close(void *analysis);
+}
+
+#endif // guard
@@ -0,0 +1,179 @@
+#include <CoverageMap.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace LogAnalysis
+{
+    namespace
+    {
+        // the count changes by delta at offset
+        struct Change
+        {
+            uint64_t offset;
+            int64_t delta;
+        };
+
+        bool ByOffset(const Change &a, const Change &b)
+        {
+            return a.offset < b.offset;
+        }
+
+        void AppendChanges(const std::vector<CoverageMap::Step> &steps, std::vector<Change> &changes)
+        {
+            int64_t previous = 0;
+            for (const auto &step : steps)
+            {
+                changes.push_back({ step.offset, static_cast<int64_t>(step.count) - previous });
+                previous = step.count;
+            }
+        }
+
+        // the steps of changes sorted by offset, offsets that do not change the count are dropped
+        std::vector<CoverageMap::Step> Sweep(const std::vector<Change> &changes)
+        {
+            std::vector<CoverageMap::Step> steps;
+            int64_t count = 0;
+            for (size_t i = 0; i < changes.size();)
+            {
+                uint64_t offset = changes[i].offset;
+                for (; i < changes.size() && changes[i].offset == offset; i++)
+                {
+                    count += changes[i].delta;
+                }
+                if ((steps.empty() && count != 0) || (!steps.empty() && steps.back().count != count))
+                {
+                    steps.push_back({ offset, static_cast<uint32_t>(count) });
+                }
+            }
+            return steps;
+        }
+
+        std::vector<CoverageMap::Step> Combine(const std::vector<CoverageMap::Step> &steps, const std::vector<Change> &sorted)
+        {
+            std::vector<Change> existing;
+            existing.reserve(steps.size());
+            AppendChanges(steps, existing);
+            std::vector<Change> changes;
+            changes.reserve(existing.size() + sorted.size());
+            std::merge(existing.begin(), existing.end(), sorted.begin(), sorted.end(), std::back_inserter(changes), ByOffset);
+            return Sweep(changes);
+        }
+    }
+
+    void CoverageMap::flush() const
+    {
+        if (pending.empty())
+        {
+            return;
+        }
+        std::vector<Change> changes;
+        changes.reserve(pending.size() * 2);
+        for (const auto &range : pending)
+        {
+            changes.push_back({ range.begin, range.count });
+            changes.push_back({ range.end, -static_cast<int64_t>(range.count) });
+        }
+        std::sort(changes.begin(), changes.end(), ByOffset);
+        steps = Combine(steps, changes);
+        pending.clear();
+    }
+
+    void CoverageMap::merge(const CoverageMap &other)
+    {
+        other.flush();
+        std::vector<Change> changes;
+        changes.reserve(other.steps.size());
+        AppendChanges(other.steps, changes);
+        flush();
+        steps = Combine(steps, changes);
+    }
+
+    uint64_t CoverageMap::covered(uint32_t minCount) const
+    {
+        flush();
+        uint64_t bytes = 0;
+        for (size_t i = 0; i + 1 < steps.size(); i++)
+        {
+            bytes += (steps[i].count >= minCount) ? steps[i + 1].offset - steps[i].offset : 0;
+        }
+        return bytes;
+    }
+
+    uint64_t CoverageMap::total() const
+    {
+        flush();
+        uint64_t bytes = 0;
+        for (size_t i = 0; i + 1 < steps.size(); i++)
+        {
+            bytes += steps[i].count * (steps[i + 1].offset - steps[i].offset);
+        }
+        return bytes;
+    }
+
+    double CoverageMap::fraction(uint64_t size) const
+    {
+        flush();
+        if (size == 0)
+        {
+            return 0.0;
+        }
+        uint64_t bytes = 0;
+        for (size_t i = 0; i + 1 < steps.size() && steps[i].offset < size; i++)
+        {
+            bytes += (steps[i].count != 0) ? std::min(steps[i + 1].offset, size) - steps[i].offset : 0;
+        }
+        return static_cast<double>(bytes) / size;
+    }
+
+    uint64_t CoverageMap::overlap(const CoverageMap &other) const
+    {
+        flush();
+        other.flush();
+        const auto &a = steps, &b = other.steps;
+        uint64_t bytes = 0, position = 0;
+        uint32_t countA = 0, countB = 0;
+        for (size_t i = 0, j = 0; i < a.size() || j < b.size();)
+        {
+            uint64_t next = std::min((i < a.size()) ? a[i].offset : UINT64_MAX, (j < b.size()) ? b[j].offset : UINT64_MAX);
+            bytes += (countA != 0 && countB != 0) ? next - position : 0;
+            for (; i < a.size() && a[i].offset == next; i++)
+            {
+                countA = a[i].count;
+            }
+            for (; j < b.size() && b[j].offset == next; j++)
+            {
+                countB = b[j].count;
+            }
+            position = next;
+        }
+        return bytes;
+    }
+
+    CoverageMap CoverageMap::presence() const
+    {
+        flush();
+        CoverageMap result;
+        for (const auto &step : steps)
+        {
+            uint32_t count = (step.count != 0) ? 1 : 0;
+            if (result.steps.empty() || result.steps.back().count != count)
+            {
+                result.steps.push_back({ step.offset, count });
+            }
+        }
+        return result;
+    }
+
+    uint64_t CoverageMap::lower() const
+    {
+        flush();
+        return steps.front().offset;
+    }
+
+    uint64_t CoverageMap::upper() const
+    {
+        flush();
+        return steps.back().offset;
+    }
+}
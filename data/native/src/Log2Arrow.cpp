@@ -0,0 +1,402 @@
+// Converts logs to a columnar Arrow IPC or Parquet file, e.g. for pandas.read_parquet(columns=[...]).
+// Paths and types are dictionary encoded, batches / row groups are split by time.
+#include <LogReader.hpp>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/util/compression.h>
+#ifdef LOGANALYSIS_WITH_PARQUET
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using LogAnalysis::LogColumns;
+    using LogAnalysis::LogReader;
+
+    enum LongOption
+    {
+        OptGroupTime = 256,
+        OptGroupSize
+    };
+
+    const option LongOptions[] =
+    {
+        { "format",    required_argument, nullptr, 'f' },
+        { "threads",   required_argument, nullptr, 't' },
+        { "grouptime", required_argument, nullptr, OptGroupTime },
+        { "groupsize", required_argument, nullptr, OptGroupSize },
+        { "help",      no_argument,       nullptr, 'h' },
+        { nullptr,     0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-f parquet|ipc] [-t THREADS] [--grouptime SEC] [--groupsize RECORDS] OUTPUT LOG [LOG ...]\n"
+            "Convert csv logs of fileaccess.py / fileaccess or logfs segments to one Parquet or Arrow IPC file.\n";
+    }
+
+    struct Options
+    {
+        bool parquet = true;
+        unsigned threads = 0;
+        uint64_t groupTime = 60; // s
+        size_t groupSize = 1 << 20;
+    };
+
+    constexpr size_t ParseBatch = 1 << 20; // records parsed at once
+
+    // distinct values of a string column, they are copied as the logs are closed between the passes
+    class Dictionary
+    {
+    public:
+        int32_t add(std::string_view value)
+        {
+            auto it = indexes.find(value);
+            if (it != indexes.end())
+            {
+                return it->second;
+            }
+            const std::string &stored = values.emplace_back(value);
+            return indexes.emplace(stored, static_cast<int32_t>(values.size() - 1)).first->second;
+        }
+
+        int32_t at(std::string_view value) const { return indexes.at(value); }
+
+        arrow::Result<std::shared_ptr<arrow::Array>> array() const
+        {
+            arrow::StringBuilder builder;
+            ARROW_RETURN_NOT_OK(builder.Reserve(values.size()));
+            for (const auto &value : values)
+            {
+                ARROW_RETURN_NOT_OK(builder.Append(value));
+            }
+            return builder.Finish();
+        }
+
+        size_t size() const { return values.size(); }
+
+    private:
+        std::deque<std::string> values; // stable, indexes refers to them
+        std::unordered_map<std::string_view, int32_t> indexes;
+    };
+
+    std::shared_ptr<arrow::Schema> Schema()
+    {
+        auto time = arrow::timestamp(arrow::TimeUnit::NANO);
+        return arrow::schema(
+        {
+            arrow::field("time_start", time),
+            arrow::field("time_end", time),
+            arrow::field("pid", arrow::int32()),
+            arrow::field("utime_start", arrow::int64()), // ns
+            arrow::field("utime_end", arrow::int64()),
+            arrow::field("stime_start", arrow::int64()),
+            arrow::field("stime_end", arrow::int64()),
+            arrow::field("inode", arrow::uint64()),
+            arrow::field("type", arrow::dictionary(arrow::int8(), arrow::utf8())),
+            arrow::field("result", arrow::int64()),
+            arrow::field("handle", arrow::int64()),
+            arrow::field("offset", arrow::uint64()),
+            arrow::field("size", arrow::uint64()),
+            arrow::field("flags", arrow::uint64()),
+            arrow::field("cgroup_id", arrow::uint64()),
+            arrow::field("path", arrow::dictionary(arrow::int32(), arrow::utf8()))
+        });
+    }
+
+    // columns of the schema that hold times, delta encoded in Parquet
+    constexpr const char *TimeColumns[] = { "time_start", "time_end", "utime_start", "utime_end", "stime_start", "stime_end" };
+
+    // IPC batches or Parquet row groups
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+        virtual arrow::Status write(const std::shared_ptr<arrow::RecordBatch> &batch) = 0;
+        virtual arrow::Status newGroup() = 0; // the following batches go into a new row group
+        virtual arrow::Status close() = 0;
+    };
+
+    class IpcSink : public Sink
+    {
+    public:
+        arrow::Status open(const std::string &path, const std::shared_ptr<arrow::Schema> &schema)
+        {
+            ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::FileOutputStream::Open(path));
+            auto options = arrow::ipc::IpcWriteOptions::Defaults();
+            if (arrow::util::Codec::IsAvailable(arrow::Compression::LZ4_FRAME))
+            {
+                ARROW_ASSIGN_OR_RAISE(options.codec, arrow::util::Codec::Create(arrow::Compression::LZ4_FRAME));
+            }
+            ARROW_ASSIGN_OR_RAISE(writer, arrow::ipc::MakeFileWriter(file, schema, options));
+            return arrow::Status::OK();
+        }
+
+        arrow::Status write(const std::shared_ptr<arrow::RecordBatch> &batch) override { return writer->WriteRecordBatch(*batch); }
+        arrow::Status newGroup() override { return arrow::Status::OK(); } // every batch is a group
+        arrow::Status close() override { return writer->Close(); }
+
+    private:
+        std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+    };
+
+#ifdef LOGANALYSIS_WITH_PARQUET
+    class ParquetSink : public Sink
+    {
+    public:
+        arrow::Status open(const std::string &path, const std::shared_ptr<arrow::Schema> &schema, size_t groupSize)
+        {
+            ARROW_ASSIGN_OR_RAISE(auto file, arrow::io::FileOutputStream::Open(path));
+            parquet::WriterProperties::Builder properties;
+            properties.max_row_group_length(groupSize);
+            if (arrow::util::Codec::IsAvailable(arrow::Compression::ZSTD))
+            {
+                properties.compression(arrow::Compression::ZSTD);
+            }
+            for (const char *column : TimeColumns)
+            {
+                properties.disable_dictionary(column)->encoding(column, parquet::Encoding::DELTA_BINARY_PACKED);
+            }
+            auto arrowProperties = parquet::ArrowWriterProperties::Builder().store_schema()->build(); // restores the dictionaries
+            ARROW_ASSIGN_OR_RAISE(writer, parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), file, properties.build(), arrowProperties));
+            return arrow::Status::OK();
+        }
+
+        arrow::Status write(const std::shared_ptr<arrow::RecordBatch> &batch) override { return writer->WriteRecordBatch(*batch); }
+        arrow::Status newGroup() override { return writer->NewBufferedRowGroup(); }
+        arrow::Status close() override { return writer->Close(); }
+
+    private:
+        std::unique_ptr<parquet::arrow::FileWriter> writer;
+    };
+#endif
+
+    class Converter
+    {
+    public:
+        explicit Converter(const Options &options) : options(options), schema(Schema()) {}
+
+        arrow::Status run(const std::string &output, const std::vector<std::string> &logs);
+
+    private:
+        arrow::Status open(LogReader &reader, const std::string &path);
+        arrow::Status writeBatch(const LogReader &reader, const LogColumns &columns);
+        arrow::Result<std::shared_ptr<arrow::RecordBatch>> makeBatch(const LogReader &reader, const LogColumns &columns);
+
+        const Options &options;
+        std::shared_ptr<arrow::Schema> schema;
+        std::unique_ptr<Sink> sink;
+        Dictionary paths;
+        Dictionary types;
+        std::shared_ptr<arrow::Array> pathValues;
+        std::shared_ptr<arrow::Array> typeValues;
+        uint64_t groupEnd = 0; // time the current group ends
+        size_t records = 0;
+    };
+
+    arrow::Status Converter::open(LogReader &reader, const std::string &path)
+    {
+        int res = reader.open(path, options.threads);
+        if (res != 0)
+        {
+            return arrow::Status::IOError("opening ", path, ": ", (res == -ENOTSUP) ? "compressed segment, built without lz4" : ::strerror(-res));
+        }
+        return arrow::Status::OK();
+    }
+
+    arrow::Status Converter::run(const std::string &output, const std::vector<std::string> &logs)
+    {
+        // The dictionaries have to be complete before the first batch, IPC files cannot replace them.
+        // The first pass only collects the paths and types, parsing is much faster than writing.
+        for (const auto &path : logs)
+        {
+            LogReader reader;
+            ARROW_RETURN_NOT_OK(open(reader, path));
+            LogColumns columns;
+            for (size_t first = 0; first < reader.records(); first += ParseBatch)
+            {
+                reader.parse(first, std::min(ParseBatch, reader.records() - first), columns);
+                for (size_t i = 0; i < columns.records(); i++)
+                {
+                    paths.add(reader.path(columns, i));
+                    types.add(std::string_view(&columns.type[i], 1));
+                }
+            }
+        }
+        if (types.size() > INT8_MAX)
+        {
+            return arrow::Status::Invalid("more than ", INT8_MAX, " event types");
+        }
+        ARROW_ASSIGN_OR_RAISE(pathValues, paths.array());
+        ARROW_ASSIGN_OR_RAISE(typeValues, types.array());
+
+        if (options.parquet)
+        {
+#ifdef LOGANALYSIS_WITH_PARQUET
+            auto parquetSink = std::make_unique<ParquetSink>();
+            ARROW_RETURN_NOT_OK(parquetSink->open(output, schema, options.groupSize));
+            sink = std::move(parquetSink);
+#else
+            return arrow::Status::NotImplemented("built without Parquet, use -f ipc");
+#endif
+        }
+        else
+        {
+            auto ipcSink = std::make_unique<IpcSink>();
+            ARROW_RETURN_NOT_OK(ipcSink->open(output, schema));
+            sink = std::move(ipcSink);
+        }
+
+        for (const auto &path : logs)
+        {
+            LogReader reader;
+            ARROW_RETURN_NOT_OK(open(reader, path));
+            LogColumns columns;
+            for (size_t first = 0; first < reader.records(); first += ParseBatch)
+            {
+                reader.parse(first, std::min(ParseBatch, reader.records() - first), columns);
+                ARROW_RETURN_NOT_OK(writeBatch(reader, columns));
+                std::cerr << "\rRecords " << (records += columns.records()) << std::flush;
+            }
+        }
+        if (records != 0)
+        {
+            std::cerr << std::endl;
+        }
+        std::cerr << "Paths: " << paths.size() << std::endl;
+        return sink->close();
+    }
+
+    // splits the parsed records into groups of --grouptime seconds, records are only roughly ordered by time,
+    // so a group starts with the first record at or after the end of the last one
+    arrow::Status Converter::writeBatch(const LogReader &reader, const LogColumns &columns)
+    {
+        ARROW_ASSIGN_OR_RAISE(auto batch, makeBatch(reader, columns));
+        const uint64_t groupTime = options.groupTime * 1000000000;
+        size_t start = 0;
+        for (size_t i = 0; i <= columns.records(); i++)
+        {
+            bool end = (i == columns.records());
+            if (!end && (groupTime == 0 || columns.timeStart[i] < groupEnd))
+            {
+                continue;
+            }
+            if (i > start)
+            {
+                ARROW_RETURN_NOT_OK(sink->write(batch->Slice(start, i - start)));
+            }
+            if (!end)
+            {
+                groupEnd = (columns.timeStart[i] / groupTime + 1) * groupTime;
+                ARROW_RETURN_NOT_OK(sink->newGroup());
+                start = i;
+            }
+        }
+        return arrow::Status::OK();
+    }
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> Converter::makeBatch(const LogReader &reader, const LogColumns &columns)
+    {
+        const int64_t length = columns.records();
+        // the vectors outlive the batch, which is written before the next parse
+        auto Wrap = [](const auto &vector) { return arrow::Buffer::Wrap(vector.data(), vector.size()); };
+        auto time = schema->field(0)->type();
+
+        arrow::Int8Builder typeIndexes;
+        arrow::Int32Builder pathIndexes;
+        ARROW_RETURN_NOT_OK(typeIndexes.Reserve(length));
+        ARROW_RETURN_NOT_OK(pathIndexes.Reserve(length));
+        for (int64_t i = 0; i < length; i++)
+        {
+            typeIndexes.UnsafeAppend(static_cast<int8_t>(types.at(std::string_view(&columns.type[i], 1))));
+            pathIndexes.UnsafeAppend(paths.at(reader.path(columns, i)));
+        }
+        ARROW_ASSIGN_OR_RAISE(auto typeIndexArray, typeIndexes.Finish());
+        ARROW_ASSIGN_OR_RAISE(auto pathIndexArray, pathIndexes.Finish());
+        ARROW_ASSIGN_OR_RAISE(auto typeArray, arrow::DictionaryArray::FromArrays(schema->GetFieldByName("type")->type(), typeIndexArray, typeValues));
+        ARROW_ASSIGN_OR_RAISE(auto pathArray, arrow::DictionaryArray::FromArrays(schema->GetFieldByName("path")->type(), pathIndexArray, pathValues));
+
+        return arrow::RecordBatch::Make(schema, length,
+        {
+            std::make_shared<arrow::TimestampArray>(time, length, Wrap(columns.timeStart)),
+            std::make_shared<arrow::TimestampArray>(time, length, Wrap(columns.timeEnd)),
+            std::make_shared<arrow::Int32Array>(length, Wrap(columns.pid)),
+            std::make_shared<arrow::Int64Array>(length, Wrap(columns.uTimeStart)),
+            std::make_shared<arrow::Int64Array>(length, Wrap(columns.uTimeEnd)),
+            std::make_shared<arrow::Int64Array>(length, Wrap(columns.sTimeStart)),
+            std::make_shared<arrow::Int64Array>(length, Wrap(columns.sTimeEnd)),
+            std::make_shared<arrow::UInt64Array>(length, Wrap(columns.inode)),
+            typeArray,
+            std::make_shared<arrow::Int64Array>(length, Wrap(columns.result)),
+            std::make_shared<arrow::Int64Array>(length, Wrap(columns.handle)),
+            std::make_shared<arrow::UInt64Array>(length, Wrap(columns.offset)),
+            std::make_shared<arrow::UInt64Array>(length, Wrap(columns.size)),
+            std::make_shared<arrow::UInt64Array>(length, Wrap(columns.flags)),
+            std::make_shared<arrow::UInt64Array>(length, Wrap(columns.cgroupId)),
+            pathArray
+        });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int c; (c = ::getopt_long(argc, argv, "f:t:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'f':
+            if (std::strcmp(optarg, "parquet") != 0 && std::strcmp(optarg, "ipc") != 0)
+            {
+                Usage(argv[0]);
+                return 2;
+            }
+            options.parquet = (std::strcmp(optarg, "parquet") == 0);
+            break;
+        case 't':
+            options.threads = std::atoi(optarg);
+            break;
+        case OptGroupTime:
+            options.groupTime = std::atoll(optarg);
+            break;
+        case OptGroupSize:
+            options.groupSize = std::max(1, std::atoi(optarg));
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind < 2)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    Converter converter(options);
+    arrow::Status status = converter.run(argv[optind], std::vector<std::string>(argv + optind + 1, argv + argc));
+    if (!status.ok())
+    {
+        std::cerr << "Error converting: " << status.ToString() << std::endl;
+        return 1;
+    }
+    return 0;
+}
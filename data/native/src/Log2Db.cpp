@@ -0,0 +1,355 @@
+// Native counterpart of log2db.py: imports logs into the event table of an sqlite database.
+// Worker threads parse batches of records, the main thread inserts them in order through one prepared statement.
+#include <LogReader.hpp>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using LogAnalysis::LogColumns;
+    using LogAnalysis::LogReader;
+
+    // same as log2db.py
+    constexpr const char *CreateTable = "CREATE TABLE IF NOT EXISTS event ("
+        "time_start UNSIGNED INT64,"
+        "time_end UNSIGNED INT64,"
+        "pid UNSIGNED INT32,"
+        "utime_start UNSIGNED INT64,"
+        "utime_end UNSIGNED INT64,"
+        "stime_start UNSIGNED INT64,"
+        "stime_end UNSIGNED INT64,"
+        "inode_uid UNSIGNED INT64,"
+        "type CHAR,"
+        "result INT64,"
+        "handle_uid UNSIGNED INT64,"
+        "offset UNSIGNED INT64,"
+        "size UNSIGNED INT64,"
+        "flags UNSIGNED INT64,"
+        "path TEXT)";
+
+    // created after the import, inserting into indexed tables is much slower
+    constexpr const char *Indexes[][2] =
+    {
+        { "event_time_start", "time_start" },
+        { "event_pid", "pid" },
+        { "event_inode_uid", "inode_uid" }
+    };
+
+    enum LongOption
+    {
+        OptBatch = 256,
+        OptTransaction,
+        OptNoIndex
+    };
+
+    const option LongOptions[] =
+    {
+        { "threads",     required_argument, nullptr, 't' },
+        { "batch",       required_argument, nullptr, OptBatch },
+        { "transaction", required_argument, nullptr, OptTransaction },
+        { "noindex",     no_argument,       nullptr, OptNoIndex },
+        { "help",        no_argument,       nullptr, 'h' },
+        { nullptr,       0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-t THREADS] [--batch RECORDS] [--transaction RECORDS] [--noindex] DB LOG [LOG ...]\n"
+            "Import csv logs of fileaccess.py / fileaccess or logfs segments (text, binary, compressed) into the event table of DB.\n";
+    }
+
+    bool Exec(sqlite3 *db, const std::string &sql)
+    {
+        char *error = nullptr;
+        if (::sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK)
+        {
+            std::cerr << "Error executing \"" << sql << "\": " << (error != nullptr ? error : "") << std::endl;
+            ::sqlite3_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    struct Options
+    {
+        unsigned threads = 0;
+        size_t batch = 65536;
+        size_t transaction = 1000000;
+        bool index = true;
+    };
+
+    class Importer
+    {
+    public:
+        Importer(sqlite3 *db, sqlite3_stmt *insert, const Options &options) : db(db), insert(insert), options(options) {}
+
+        // returns the number of records imported, -1 on error
+        int64_t import(const std::string &path);
+
+    private:
+        bool insertBatch(const LogReader &reader, const LogColumns &columns);
+
+        sqlite3 *db;
+        sqlite3_stmt *insert;
+        const Options &options;
+        size_t inTransaction = 0;
+        std::string pathBuffer;
+    };
+
+    int64_t Importer::import(const std::string &path)
+    {
+        LogReader reader;
+        int res = reader.open(path, 1); // the workers parse in parallel
+        if (res != 0)
+        {
+            std::cerr << "Error opening " << path << ": " << ((res == -ENOTSUP) ? "compressed segment, built without lz4" : ::strerror(-res)) << std::endl;
+            return -1;
+        }
+
+        const size_t records = reader.records();
+        const size_t batches = (records + options.batch - 1) / options.batch;
+        const unsigned workerCount = std::max<unsigned>(1, std::min<size_t>(options.threads, batches));
+        const size_t queueDepth = 2 * workerCount; // parsed batches waiting for the writer
+
+        std::mutex mutex;
+        std::condition_variable parsed; // a batch was parsed
+        std::condition_variable written; // a batch was written
+        std::map<size_t, LogColumns> queue; // batches are inserted in log order
+        size_t writtenBatches = 0;
+        bool failed = false;
+        std::atomic<size_t> next = 0;
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < workerCount; i++)
+        {
+            workers.emplace_back([&]()
+            {
+                for (size_t batch; (batch = next++) < batches;)
+                {
+                    {
+                        std::unique_lock lock(mutex);
+                        written.wait(lock, [&]() { return failed || batch < writtenBatches + queueDepth; });
+                        if (failed)
+                        {
+                            return;
+                        }
+                    }
+                    LogColumns columns;
+                    size_t first = batch * options.batch;
+                    reader.parse(first, std::min(options.batch, records - first), columns);
+                    {
+                        std::lock_guard lock(mutex);
+                        queue.emplace(batch, std::move(columns));
+                    }
+                    parsed.notify_one();
+                }
+            });
+        }
+
+        for (size_t batch = 0; batch < batches; batch++)
+        {
+            LogColumns columns;
+            {
+                std::unique_lock lock(mutex);
+                parsed.wait(lock, [&]() { return queue.count(batch) != 0; });
+                columns = std::move(queue.at(batch));
+                queue.erase(batch);
+            }
+            bool ok = insertBatch(reader, columns);
+            {
+                std::lock_guard lock(mutex);
+                writtenBatches++;
+                failed = !ok;
+            }
+            written.notify_all();
+            if (!ok)
+            {
+                break;
+            }
+            std::cerr << "\rRecords " << std::min(records, (batch + 1) * options.batch) << " / " << records << std::flush;
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        if (batches != 0)
+        {
+            std::cerr << std::endl;
+        }
+        return failed ? -1 : static_cast<int64_t>(records);
+    }
+
+    // sqlite stores integers above INT64_MAX given as text (as by log2db.py) as reals
+    void BindUnsigned(sqlite3_stmt *statement, int index, uint64_t value)
+    {
+        if (value > INT64_MAX)
+        {
+            ::sqlite3_bind_double(statement, index, static_cast<double>(value));
+        }
+        else
+        {
+            ::sqlite3_bind_int64(statement, index, static_cast<int64_t>(value));
+        }
+    }
+
+    bool Importer::insertBatch(const LogReader &reader, const LogColumns &columns)
+    {
+        constexpr uint64_t NsPerMs = 1000000; // log2db.py drops the '.' of "seconds.milliseconds"
+        for (size_t i = 0; i < columns.records(); i++)
+        {
+            if (inTransaction == 0 && !Exec(db, "BEGIN"))
+            {
+                return false;
+            }
+
+            // log2db.py splits the line at ',' and joins the path back with '_'
+            std::string_view path = reader.path(columns, i);
+            if (path.find(',') != std::string_view::npos)
+            {
+                pathBuffer.assign(path);
+                std::replace(pathBuffer.begin(), pathBuffer.end(), ',', '_');
+                path = pathBuffer;
+            }
+
+            ::sqlite3_bind_int64(insert, 1, columns.timeStart[i] / NsPerMs);
+            ::sqlite3_bind_int64(insert, 2, columns.timeEnd[i] / NsPerMs);
+            ::sqlite3_bind_int64(insert, 3, columns.pid[i]);
+            ::sqlite3_bind_int64(insert, 4, columns.uTimeStart[i] / NsPerMs);
+            ::sqlite3_bind_int64(insert, 5, columns.uTimeEnd[i] / NsPerMs);
+            ::sqlite3_bind_int64(insert, 6, columns.sTimeStart[i] / NsPerMs);
+            ::sqlite3_bind_int64(insert, 7, columns.sTimeEnd[i] / NsPerMs);
+            BindUnsigned(insert, 8, columns.inode[i]);
+            ::sqlite3_bind_text(insert, 9, &columns.type[i], 1, SQLITE_STATIC);
+            ::sqlite3_bind_int64(insert, 10, columns.result[i]);
+            ::sqlite3_bind_int64(insert, 11, columns.handle[i]);
+            BindUnsigned(insert, 12, columns.offset[i]);
+            BindUnsigned(insert, 13, columns.size[i]);
+            // the flags are not converted to a number by log2db.py either
+            char flags[24];
+            int flagsLength = std::snprintf(flags, sizeof(flags), "0x%08llx", static_cast<unsigned long long>(columns.flags[i]));
+            ::sqlite3_bind_text(insert, 14, flags, flagsLength, SQLITE_TRANSIENT);
+            ::sqlite3_bind_text(insert, 15, path.data(), path.size(), SQLITE_STATIC);
+            int res = ::sqlite3_step(insert);
+            ::sqlite3_reset(insert);
+            if (res != SQLITE_DONE)
+            {
+                std::cerr << "\nError inserting record: " << ::sqlite3_errmsg(db) << std::endl;
+                return false;
+            }
+
+            if (++inTransaction == options.transaction)
+            {
+                if (!Exec(db, "COMMIT"))
+                {
+                    return false;
+                }
+                inTransaction = 0;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int c; (c = ::getopt_long(argc, argv, "t:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 't':
+            options.threads = std::atoi(optarg);
+            break;
+        case OptBatch:
+            options.batch = std::max(1, std::atoi(optarg));
+            break;
+        case OptTransaction:
+            options.transaction = std::max(1, std::atoi(optarg));
+            break;
+        case OptNoIndex:
+            options.index = false;
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind < 2)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+    if (options.threads == 0)
+    {
+        // one core is left for the writer, which is the bottleneck anyway
+        options.threads = std::max(1u, std::thread::hardware_concurrency() - 1);
+    }
+
+    sqlite3 *db = nullptr;
+    if (::sqlite3_open(argv[optind], &db) != SQLITE_OK)
+    {
+        std::cerr << "Error opening " << argv[optind] << ": " << ::sqlite3_errmsg(db) << std::endl;
+        ::sqlite3_close(db);
+        return 1;
+    }
+    sqlite3_stmt *insert = nullptr;
+    bool ok = Exec(db, "PRAGMA synchronous = 0") && Exec(db, "PRAGMA journal_mode = OFF") && Exec(db, "PRAGMA cache_size = -262144")
+        && Exec(db, CreateTable);
+    for (const auto &index : Indexes)
+    {
+        ok = ok && Exec(db, std::string("DROP INDEX IF EXISTS ") + index[0]);
+    }
+    if (ok && ::sqlite3_prepare_v2(db, "INSERT INTO event VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", -1, &insert, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Error preparing insert: " << ::sqlite3_errmsg(db) << std::endl;
+        ok = false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t total = 0;
+    Importer importer(db, insert, options);
+    for (int i = optind + 1; ok && i < argc; i++)
+    {
+        int64_t records = importer.import(argv[i]);
+        ok = (records >= 0);
+        total += std::max<int64_t>(records, 0);
+    }
+    ::sqlite3_finalize(insert);
+    if (!::sqlite3_get_autocommit(db))
+    {
+        ok = Exec(db, "COMMIT") && ok; // the last transaction, also what was imported before an error
+    }
+
+    if (options.index)
+    {
+        std::cerr << "Creating indexes" << std::endl;
+        for (const auto &index : Indexes)
+        {
+            ok = Exec(db, std::string("CREATE INDEX IF NOT EXISTS ") + index[0] + " ON event(" + index[1] + ")") && ok;
+        }
+    }
+    ::sqlite3_close(db);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Processed lines / events: " << total << " in " << seconds << " s" << std::endl;
+    return ok ? 0 : 1;
+}
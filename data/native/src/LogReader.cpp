@@ -0,0 +1,502 @@
+#include <LogReader.hpp>
+
+#include <FieldParser.hpp>
+#include <Parallel.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#ifdef LOGANALYSIS_WITH_LZ4
+#include <lz4.h>
+#endif
+
+namespace LogAnalysis
+{
+    using LogFs::BinaryRecord;
+    using LogFs::FrameHeader;
+    using LogFs::LogFormat;
+    using LogFs::SegmentHeader;
+    using T = LogFs::TextRecord;
+
+    namespace
+    {
+        constexpr size_t MinChunk = 16384; // records (frames) below which another thread is not worth starting
+
+        bool IsTextRecord(const char *data, size_t size)
+        {
+            return size >= T::OffPid && data[T::OffRTimeStart + T::SizeTimeSec] == '.' && data[T::OffRTimeEnd - 1] == ',';
+        }
+    }
+
+    void LogColumns::resize(size_t records)
+    {
+        for (auto *column : { &timeStart, &timeEnd, &uTimeStart, &uTimeEnd, &sTimeStart, &sTimeEnd, &inode, &offset, &size, &flags, &cgroupId, &pathOffset })
+        {
+            column->resize(records);
+        }
+        pid.resize(records);
+        type.resize(records);
+        result.resize(records);
+        handle.resize(records);
+        pathLength.resize(records);
+    }
+
+    const void *LogColumns::column(Column column, size_t &elementSize) const
+    {
+        auto Get = [&elementSize](const auto &vector) -> const void*
+        {
+            elementSize = sizeof(vector[0]);
+            return vector.data();
+        };
+        switch (column)
+        {
+        case Column::TimeStart: return Get(timeStart);
+        case Column::TimeEnd: return Get(timeEnd);
+        case Column::UTimeStart: return Get(uTimeStart);
+        case Column::UTimeEnd: return Get(uTimeEnd);
+        case Column::STimeStart: return Get(sTimeStart);
+        case Column::STimeEnd: return Get(sTimeEnd);
+        case Column::Pid: return Get(pid);
+        case Column::Inode: return Get(inode);
+        case Column::Type: return Get(type);
+        case Column::Result: return Get(result);
+        case Column::Handle: return Get(handle);
+        case Column::Offset: return Get(offset);
+        case Column::Size: return Get(size);
+        case Column::Flags: return Get(flags);
+        case Column::CgroupId: return Get(cgroupId);
+        default: return nullptr;
+        }
+    }
+
+    int LogReader::open(const std::string &path, unsigned threads, bool locateRecords)
+    {
+        close();
+        this->threads = Threads(threads);
+        int res = file.open(path);
+        if (res != 0)
+        {
+            return res;
+        }
+        return locate(file.data(), file.size(), locateRecords);
+    }
+
+    void LogReader::close()
+    {
+        file.close();
+        raw.clear();
+        raw.shrink_to_fit();
+        starts.clear();
+        begin = end = nullptr;
+        recordCount = 0;
+        entrySize = T::SizeEntry;
+        logFormat = LogFormat::Text;
+    }
+
+    int LogReader::locate(const char *data, size_t size, bool locateRecords)
+    {
+        bool open = false; // segment still written, the records end at the first empty one
+        SegmentHeader header;
+        if (size >= SegmentHeader::Size && ::memcmp(data, SegmentHeader::Magic, sizeof(header.magic)) == 0)
+        {
+            ::memcpy(&header, data, sizeof(header));
+            if (header.version != SegmentHeader::Version)
+            {
+                return -EINVAL;
+            }
+            logFormat = header.format;
+            open = (header.dataSize == 0);
+            size_t available = size - SegmentHeader::Size;
+            data += SegmentHeader::Size;
+            size = open ? available : std::min<size_t>(header.dataSize, available);
+            if (header.compression != LogFs::Compression::None)
+            {
+                int res = decompress(data, size);
+                if (res != 0)
+                {
+                    return res;
+                }
+                data = raw.data();
+                size = raw.size();
+                open = false; // complete frames only
+            }
+        }
+        else
+        {
+            // csv of fileaccess.py, maybe with its header line
+            static constexpr std::string_view HeaderLine = "time_start";
+            if (std::string_view(data, std::min(size, HeaderLine.size())) == HeaderLine)
+            {
+                const char *newline = static_cast<const char*>(::memchr(data, '\n', size));
+                size_t skip = (newline != nullptr) ? newline + 1 - data : size;
+                data += skip;
+                size -= skip;
+            }
+            logFormat = (size == 0 || IsTextRecord(data, size)) ? LogFormat::Text : LogFormat::Binary;
+        }
+        begin = data;
+        end = data + size;
+
+        if (logFormat == LogFormat::Text)
+        {
+            const char *newline = static_cast<const char*>(::memchr(data, '\n', size));
+            if (newline == nullptr)
+            {
+                return 0; // no complete record
+            }
+            entrySize = newline + 1 - data;
+            recordCount = size / entrySize;
+            if (open)
+            {
+                // records are appended in order, so the first empty one is found by bisection
+                size_t low = 0, high = recordCount;
+                while (low < high)
+                {
+                    size_t mid = low + (high - low) / 2;
+                    if (data[mid * entrySize] == '\0')
+                    {
+                        high = mid;
+                    }
+                    else
+                    {
+                        low = mid + 1;
+                    }
+                }
+                recordCount = low;
+            }
+            if (!locateRecords)
+            {
+                return 0; // read by offset, textLength() finds the end of each
+            }
+            // fileaccess.py pads paths to a number of characters, so a path with multi-byte characters makes its record longer
+            // and shifts all behind it off the stride
+            std::atomic<bool> misaligned = false;
+            ParallelFor(recordCount, threads, MinChunk, [&](size_t first, size_t last)
+            {
+                for (size_t i = first; i < last && !misaligned; i++)
+                {
+                    if (data[(i + 1) * entrySize - 1] != '\n')
+                    {
+                        misaligned = true;
+                    }
+                }
+            });
+            if (misaligned)
+            {
+                locateLines(data, size);
+            }
+            return 0;
+        }
+
+        if (!locateRecords)
+        {
+            return 0;
+        }
+        // binary records have to be walked by their lengths, which is one load per record
+        starts.reserve(size / (sizeof(BinaryRecord) + 64));
+        for (size_t offset = 0; size - offset >= sizeof(BinaryRecord);)
+        {
+            uint16_t length;
+            ::memcpy(&length, data + offset, sizeof(length));
+            if (length < sizeof(BinaryRecord) || length > size - offset)
+            {
+                break; // end of an open segment or truncated
+            }
+            starts.push_back(offset);
+            offset += length;
+        }
+        return 0;
+    }
+
+    void LogReader::locateLines(const char *data, size_t size)
+    {
+        // the newlines of every chunk are collected in parallel, a record starts after each but the last
+        constexpr size_t ChunkSize = size_t(1) << 24;
+        std::vector<std::vector<uint64_t>> newlines((size + ChunkSize - 1) / ChunkSize);
+        ParallelFor(newlines.size(), threads, 1, [&](size_t first, size_t last)
+        {
+            for (size_t chunk = first; chunk < last; chunk++)
+            {
+                const char *from = data + chunk * ChunkSize, *to = data + std::min(size, (chunk + 1) * ChunkSize);
+                for (const char *newline; (newline = static_cast<const char*>(::memchr(from, '\n', to - from))) != nullptr; from = newline + 1)
+                {
+                    newlines[chunk].push_back(newline - data);
+                }
+            }
+        });
+        starts.clear();
+        starts.push_back(0);
+        for (const auto &chunk : newlines)
+        {
+            for (uint64_t newline : chunk)
+            {
+                starts.push_back(newline + 1);
+            }
+        }
+        starts.pop_back(); // behind the last newline, incomplete or the empty records of an open segment
+        recordCount = starts.size();
+    }
+
+    size_t LogReader::textLength(uint64_t offset) const
+    {
+        const size_t size = dataSize();
+        if (offset >= size)
+        {
+            return 0;
+        }
+        if (size - offset >= entrySize && begin[offset + entrySize - 1] == '\n')
+        {
+            return entrySize;
+        }
+        const char *newline = static_cast<const char*>(::memchr(begin + offset, '\n', size - offset));
+        return (newline != nullptr) ? newline + 1 - (begin + offset) : 0;
+    }
+
+    int LogReader::decompress(const char *data, size_t size)
+    {
+#ifdef LOGANALYSIS_WITH_LZ4
+        struct Frame
+        {
+            size_t in;
+            size_t out;
+            FrameHeader header;
+        };
+        std::vector<Frame> frames;
+        size_t rawSize = 0;
+        for (size_t offset = 0; size - offset >= sizeof(FrameHeader);)
+        {
+            FrameHeader header;
+            ::memcpy(&header, data + offset, sizeof(header));
+            if (header.magic != FrameHeader::Magic || header.compressedSize > size - offset - sizeof(header))
+            {
+                break; // end of an open segment
+            }
+            frames.push_back({ offset + sizeof(header), rawSize, header });
+            rawSize += header.rawSize;
+            offset += sizeof(header) + header.compressedSize;
+        }
+
+        raw.resize(rawSize);
+        std::atomic<bool> failed = false;
+        ParallelFor(frames.size(), threads, 1, [&](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; i++)
+            {
+                const Frame &frame = frames[i];
+                int res = ::LZ4_decompress_safe(data + frame.in, raw.data() + frame.out, frame.header.compressedSize, frame.header.rawSize);
+                if (res != static_cast<int>(frame.header.rawSize))
+                {
+                    failed = true;
+                }
+            }
+        });
+        return failed ? -EIO : 0;
+#else
+        (void)data;
+        (void)size;
+        return -ENOTSUP;
+#endif
+    }
+
+    void LogReader::parse(size_t first, size_t count, LogColumns &columns) const
+    {
+        columns.resize(count);
+        ParallelFor(count, threads, MinChunk, [&](size_t from, size_t to)
+        {
+            if (logFormat == LogFormat::Text)
+            {
+                parseText(first + from, to - from, from, columns);
+            }
+            else
+            {
+                parseBinary(first + from, to - from, from, columns);
+            }
+        });
+    }
+
+    void LogReader::parseText(size_t first, size_t count, size_t out, LogColumns &columns) const
+    {
+        if (!starts.empty()) // records of different lengths
+        {
+            for (size_t i = 0; i < count; i++, out++)
+            {
+                parseTextRecord(begin + starts[first + i], textLength(starts[first + i]), out, columns);
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; i++, out++)
+        {
+            parseTextRecord(begin + (first + i) * entrySize, entrySize, out, columns);
+        }
+    }
+
+    void LogReader::parseBinary(size_t first, size_t count, size_t out, LogColumns &columns) const
+    {
+        for (size_t i = 0; i < count; i++, out++)
+        {
+            parseBinaryRecord(begin + starts[first + i], out, columns);
+        }
+    }
+
+    void LogReader::parseTextRecord(const char *record, size_t length, size_t out, LogColumns &columns) const
+    {
+        columns.timeStart[out] = ParseTime(record + T::OffRTimeStart, T::SizeTimeSec, T::SizeTimeNsec);
+        columns.timeEnd[out] = ParseTime(record + T::OffRTimeEnd, T::SizeTimeSec, T::SizeTimeNsec);
+        columns.pid[out] = static_cast<int32_t>(ParseSigned(record + T::OffPid, T::SizePid));
+        columns.uTimeStart[out] = ParseTime(record + T::OffUTimeStart, T::SizeTimeSec, T::SizeTimeNsec);
+        columns.uTimeEnd[out] = ParseTime(record + T::OffUTimeEnd, T::SizeTimeSec, T::SizeTimeNsec);
+        columns.sTimeStart[out] = ParseTime(record + T::OffSTimeStart, T::SizeTimeSec, T::SizeTimeNsec);
+        columns.sTimeEnd[out] = ParseTime(record + T::OffSTimeEnd, T::SizeTimeSec, T::SizeTimeNsec);
+        columns.inode[out] = ParseUnsigned(record + T::OffInode, T::SizeInode);
+        columns.type[out] = record[T::OffEvent];
+        columns.result[out] = ParseSigned(record + T::OffResult, T::SizeResult);
+        columns.handle[out] = ParseSigned(record + T::OffFilehandle, T::SizeFilehandle);
+        columns.offset[out] = ParseUnsigned(record + T::OffOffset, T::SizeOffset);
+        columns.size[out] = ParseUnsigned(record + T::OffSize, T::SizeSize);
+        columns.flags[out] = ParseHex(record + T::OffFlags, T::SizeFlags);
+        columns.cgroupId[out] = 0;
+        columns.pathOffset[out] = record + T::OffPath - begin;
+        columns.pathLength[out] = static_cast<uint16_t>(TrimmedLength(record + T::OffPath, std::max(static_cast<int>(length) - 1 - T::OffPath, 0)));
+    }
+
+    void LogReader::parseBinaryRecord(const char *data, size_t out, LogColumns &columns) const
+    {
+        BinaryRecord record;
+        ::memcpy(&record, data, sizeof(record));
+        columns.timeStart[out] = record.rTimeStart;
+        columns.timeEnd[out] = record.rTimeEnd;
+        columns.pid[out] = record.pid;
+        columns.uTimeStart[out] = record.uTimeStart;
+        columns.uTimeEnd[out] = record.uTimeEnd;
+        columns.sTimeStart[out] = record.sTimeStart;
+        columns.sTimeEnd[out] = record.sTimeEnd;
+        columns.inode[out] = record.inode;
+        columns.type[out] = record.event;
+        columns.result[out] = record.result;
+        columns.handle[out] = record.filehandle;
+        columns.offset[out] = record.offset;
+        columns.size[out] = record.size;
+        columns.flags[out] = record.flags;
+        columns.cgroupId[out] = record.cgroupId;
+        columns.pathOffset[out] = data + sizeof(record) - begin;
+        columns.pathLength[out] = std::min<uint16_t>(record.pathLength, record.length - sizeof(record));
+    }
+
+    void LogReader::parseAt(const uint64_t *offsets, size_t count, LogColumns &columns) const
+    {
+        columns.resize(count);
+        ParallelFor(count, threads, MinChunk, [&](size_t from, size_t to)
+        {
+            for (size_t i = from; i < to; i++)
+            {
+                if (logFormat == LogFormat::Text)
+                {
+                    parseTextRecord(begin + offsets[i], textLength(offsets[i]), i, columns);
+                }
+                else
+                {
+                    parseBinaryRecord(begin + offsets[i], i, columns);
+                }
+            }
+        });
+    }
+
+    void LogReader::walk(uint64_t offset, size_t count, std::vector<uint64_t> &offsets) const
+    {
+        offsets.clear();
+        const size_t size = dataSize();
+        for (; offsets.size() < count && offset < size;)
+        {
+            uint64_t length = 0;
+            if (logFormat == LogFormat::Binary)
+            {
+                uint16_t recordLength = 0;
+                if (size - offset >= sizeof(BinaryRecord))
+                {
+                    ::memcpy(&recordLength, begin + offset, sizeof(recordLength));
+                }
+                if (recordLength < sizeof(BinaryRecord) || recordLength > size - offset)
+                {
+                    break;
+                }
+                length = recordLength;
+            }
+            else
+            {
+                length = (begin[offset] != '\0') ? textLength(offset) : 0;
+                if (length == 0)
+                {
+                    break;
+                }
+            }
+            offsets.push_back(offset);
+            offset += length;
+        }
+    }
+}
+
+namespace
+{
+    struct ParsedLog
+    {
+        LogAnalysis::LogReader reader;
+        LogAnalysis::LogColumns columns;
+    };
+}
+
+void *logparse_open(const char *path, unsigned threads, int *error)
+{
+    auto log = std::make_unique<ParsedLog>();
+    int res = log->reader.open(path, threads);
+    if (error != nullptr)
+    {
+        *error = res;
+    }
+    if (res != 0)
+    {
+        return nullptr;
+    }
+    log->reader.parse(log->columns);
+    return log.release();
+}
+
+void logparse_close(void *log)
+{
+    delete static_cast<ParsedLog*>(log);
+}
+
+int logparse_format(void *log)
+{
+    return static_cast<int>(static_cast<ParsedLog*>(log)->reader.format());
+}
+
+uint64_t logparse_records(void *log)
+{
+    return static_cast<ParsedLog*>(log)->columns.records();
+}
+
+const void *logparse_column(void *log, int column, uint64_t *elementSize)
+{
+    size_t size = 0;
+    const void *data = static_cast<ParsedLog*>(log)->columns.column(static_cast<LogAnalysis::Column>(column), size);
+    if (elementSize != nullptr)
+    {
+        *elementSize = size;
+    }
+    return data;
+}
+
+const char *logparse_path(void *log, uint64_t index, uint64_t *length)
+{
+    auto *parsed = static_cast<ParsedLog*>(log);
+    if (index >= parsed->columns.records())
+    {
+        return nullptr;
+    }
+    std::string_view path = parsed->reader.path(parsed->columns, index);
+    *length = path.size();
+    return path.data();
+}
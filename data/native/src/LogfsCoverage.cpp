@@ -0,0 +1,217 @@
+// Prints per file which bytes were read and written how often: the bytes read, read again and written, the share of the file
+// read and the bytes read by more than one pid (or cgroup). Every thread builds the CoverageMaps of its part of each batch of
+// records, the maps of the threads are merged at the end.
+#include <CoverageMap.hpp>
+#include <LogReader.hpp>
+#include <Parallel.hpp>
+#include <QueryIndex.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using LogAnalysis::CoverageMap;
+    using LogAnalysis::LogColumns;
+    using LogAnalysis::LogReader;
+
+    enum class Group
+    {
+        Pid,
+        Cgroup
+    };
+
+    const option LongOptions[] =
+    {
+        { "by",      required_argument, nullptr, 'b' },
+        { "threads", required_argument, nullptr, 't' },
+        { "help",    no_argument,       nullptr, 'h' },
+        { nullptr,   0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-b pid|cgroup] [-t THREADS] LOG|DIR [...]\n"
+            "Print per inode the bytes read, read again, read by more than one pid / cgroup (-b) and written as csv.\n"
+            "Reads and writes cover [offset, offset + result), the file size is the end of the last one.\n";
+    }
+
+    struct FileCoverage
+    {
+        CoverageMap reads, writes;
+        std::unordered_map<uint64_t, CoverageMap> groupReads; // by pid or cgroup
+        uint64_t size = 0;
+        std::string path; // of an open
+    };
+
+    using Files = std::unordered_map<uint64_t, FileCoverage>;
+
+    void Add(Files &files, const LogReader &reader, const LogColumns &columns, size_t i, Group group)
+    {
+        char type = columns.type[i];
+        if (type != 'R' && type != 'W' && type != 'O')
+        {
+            return;
+        }
+        FileCoverage &file = files[columns.inode[i]];
+        if (type == 'O')
+        {
+            if (file.path.empty())
+            {
+                file.path = reader.path(columns, i);
+            }
+            return;
+        }
+        if (columns.result[i] <= 0)
+        {
+            return;
+        }
+        uint64_t begin = columns.offset[i], end = begin + columns.result[i];
+        file.size = std::max(file.size, end);
+        if (type == 'W')
+        {
+            file.writes.add(begin, end);
+            return;
+        }
+        file.reads.add(begin, end);
+        file.groupReads[(group == Group::Pid) ? static_cast<uint32_t>(columns.pid[i]) : columns.cgroupId[i]].add(begin, end);
+    }
+
+    void Merge(Files &into, Files &from)
+    {
+        for (auto &[inode, file] : from)
+        {
+            FileCoverage &merged = into[inode];
+            merged.reads.merge(file.reads);
+            merged.writes.merge(file.writes);
+            for (auto &[group, reads] : file.groupReads)
+            {
+                merged.groupReads[group].merge(reads);
+            }
+            merged.size = std::max(merged.size, file.size);
+            if (merged.path.empty())
+            {
+                merged.path = std::move(file.path);
+            }
+        }
+        from.clear();
+    }
+
+    // adds the records of the log to the files of the threads, returns -errno
+    int AddLog(const std::string &log, unsigned threads, Group group, std::vector<Files> &parts)
+    {
+        LogReader reader;
+        int res = reader.open(log, threads);
+        if (res != 0)
+        {
+            std::cerr << "Error opening " << log << ": " << ((res == -ENOTSUP) ? "compressed segment, built without lz4" : ::strerror(-res)) << std::endl;
+            return res;
+        }
+        constexpr size_t ParseBatch = 1 << 20;
+        LogColumns columns;
+        for (size_t first = 0; first < reader.records(); first += ParseBatch)
+        {
+            reader.parse(first, std::min(ParseBatch, reader.records() - first), columns);
+            const size_t count = columns.records();
+            LogAnalysis::ParallelFor(parts.size(), parts.size(), 1, [&](size_t from, size_t to)
+            {
+                for (size_t part = from; part < to; part++)
+                {
+                    for (size_t i = count * part / parts.size(); i < count * (part + 1) / parts.size(); i++)
+                    {
+                        Add(parts[part], reader, columns, i, group);
+                    }
+                }
+            });
+        }
+        return 0;
+    }
+
+    void Print(const Files &files)
+    {
+        std::vector<uint64_t> inodes;
+        inodes.reserve(files.size());
+        for (const auto &[inode, file] : files)
+        {
+            if (!file.reads.empty() || !file.writes.empty())
+            {
+                inodes.push_back(inode);
+            }
+        }
+        std::sort(inodes.begin(), inodes.end());
+        std::printf("inode,size,read_bytes,reread_bytes,read_fraction,shared_read_bytes,readers,written_bytes,rewritten_bytes,path\n");
+        for (uint64_t inode : inodes)
+        {
+            const FileCoverage &file = files.at(inode);
+            CoverageMap readers;
+            for (const auto &[group, reads] : file.groupReads)
+            {
+                readers.merge(reads.presence());
+            }
+            std::printf("%llu,%llu,%llu,%llu,%.6f,%llu,%zu,%llu,%llu,%s\n", static_cast<unsigned long long>(inode), static_cast<unsigned long long>(file.size),
+                static_cast<unsigned long long>(file.reads.covered()), static_cast<unsigned long long>(file.reads.repeated()), file.reads.fraction(file.size),
+                static_cast<unsigned long long>(readers.covered(2)), file.groupReads.size(), static_cast<unsigned long long>(file.writes.covered()),
+                static_cast<unsigned long long>(file.writes.repeated()), file.path.c_str());
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    Group group = Group::Pid;
+    for (int c; (c = ::getopt_long(argc, argv, "b:t:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'b':
+            if (std::strcmp(optarg, "pid") != 0 && std::strcmp(optarg, "cgroup") != 0)
+            {
+                Usage(argv[0]);
+                return 2;
+            }
+            group = (std::strcmp(optarg, "pid") == 0) ? Group::Pid : Group::Cgroup;
+            break;
+        case 't':
+            threads = std::atoi(optarg);
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<Files> parts(LogAnalysis::Threads(threads));
+    for (int i = optind; i < argc; i++)
+    {
+        for (const auto &log : LogAnalysis::QueryIndex::Logs(argv[i]))
+        {
+            if (AddLog(log, threads, group, parts) != 0)
+            {
+                return 1;
+            }
+        }
+    }
+    for (size_t part = 1; part < parts.size(); part++)
+    {
+        Merge(parts[0], parts[part]);
+    }
+    Print(parts[0]);
+    return 0;
+}
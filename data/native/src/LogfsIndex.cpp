@@ -0,0 +1,63 @@
+// Builds the sidecar indexes of logfs-query (QueryIndex) for logs and segment directories, only for logs that changed.
+// Run it periodically (or after logfs closed a segment) to keep the indexes of a growing directory current.
+#include <QueryIndex.hpp>
+
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const option LongOptions[] =
+    {
+        { "threads", required_argument, nullptr, 't' },
+        { "help",    no_argument,       nullptr, 'h' },
+        { nullptr,   0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-t THREADS] LOG|DIR [...]\n"
+            "Index logs (logfs segment directories, segments or csv logs) for logfs-query, writes LOG.qidx next to every log.\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    for (int c; (c = ::getopt_long(argc, argv, "t:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 't':
+            threads = std::atoi(optarg);
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    int built = 0;
+    for (int i = optind; i < argc; i++)
+    {
+        int res = LogAnalysis::QueryIndex::Update(LogAnalysis::QueryIndex::Logs(argv[i]), threads, true);
+        if (res < 0)
+        {
+            return 1;
+        }
+        built += res;
+    }
+    std::cerr << "Indexed " << built << " logs" << std::endl;
+    return 0;
+}
@@ -0,0 +1,447 @@
+// Merges the logs of several nodes into one stream ordered by time_start. The records of a node are only roughly ordered
+// (they are written when their handler finishes), so every node sorts its records in a reorder window: a record is released
+// once a record later by the window was read. A heap over the oldest released record of every node merges the nodes.
+// Times are shifted by the clock offset of their node, inode and handle uids are moved into a cluster wide space.
+#include <LogReader.hpp>
+#include <QueryIndex.hpp>
+#include <RecordFormat.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using LogAnalysis::LogColumns;
+    using LogAnalysis::LogReader;
+
+    enum LongOption
+    {
+        OptSegment = 256,
+        OptKeepIds
+    };
+
+    const option LongOptions[] =
+    {
+        { "window",  required_argument, nullptr, 'w' },
+        { "buffer",  required_argument, nullptr, 'b' },
+        { "shift",   required_argument, nullptr, 's' },
+        { "keepids", no_argument,       nullptr, OptKeepIds },
+        { "format",  required_argument, nullptr, 'f' },
+        { "segment", no_argument,       nullptr, OptSegment },
+        { "header",  no_argument,       nullptr, 'H' },
+        { "output",  required_argument, nullptr, 'O' },
+        { "threads", required_argument, nullptr, 't' },
+        { "help",    no_argument,       nullptr, 'h' },
+        { nullptr,   0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-w SECONDS] [-b RECORDS] [-s NODE=SECONDS ...] [--keepids] [-f text|binary] [--segment] [-H]\n"
+            "       [-O OUTPUT] [-t THREADS] LOG|DIR [...]\n"
+            "Merge the logs of the nodes (one log, segment or directory of segments each) into one stream ordered by time_start.\n"
+            "-w: reorder window per node (default 10 s), -b: records a node buffers at most (default 4194304).\n"
+            "-s: clock offset of node NODE (0 for the first argument) added to its times.\n"
+            "Inode and handle uids get the node + 1 in their upper 16 bits unless --keepids is given.\n"
+            "--segment writes a logfs segment (needs -O), -H the header line of text output.\n";
+    }
+
+    constexpr size_t ParseBatch = 1 << 16;
+    constexpr int IdShift = 48;
+
+    struct Options
+    {
+        uint64_t window = 10000000000ULL;
+        size_t buffer = 1 << 22;
+        std::unordered_map<size_t, int64_t> shifts; // ns by node
+        bool keepIds = false;
+        LogFs::LogFormat format = LogFs::LogFormat::Text;
+        bool segment = false;
+        bool header = false;
+        std::string output;
+        unsigned threads = 0;
+    };
+
+    // parsed records of a log, kept until all of them were written
+    struct Batch
+    {
+        std::shared_ptr<LogReader> reader; // the paths point into its mapping
+        LogColumns columns;
+        size_t pending = 0;
+    };
+
+    struct Pending
+    {
+        uint64_t time;
+        uint64_t sequence; // read order, keeps records of the same time in order
+        Batch *batch;
+        size_t index;
+
+        bool operator>(const Pending &other) const
+        {
+            return (time != other.time) ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    // the logs of a node, read batch by batch into the reorder window
+    class Node
+    {
+    public:
+        Node(size_t index, std::vector<std::string> logs, const Options &options) : index(index), logs(std::move(logs)), options(options)
+        {
+            auto shift = options.shifts.find(index);
+            this->shift = (shift != options.shifts.end()) ? shift->second : 0;
+        }
+
+        // reads until the oldest record can be released, returns -errno
+        int fill()
+        {
+            while (!exhausted && (window.empty() || newest - window.top().time < options.window) && window.size() < options.buffer)
+            {
+                int res = readBatch();
+                if (res != 0)
+                {
+                    return res;
+                }
+            }
+            return 0;
+        }
+
+        bool empty() const { return window.empty(); }
+        const Pending &top() const { return window.top(); }
+
+        void pop()
+        {
+            window.pop();
+            // released records may be in any batch, the completely written ones at the front are dropped
+            while (!batches.empty() && batches.front()->pending == 0)
+            {
+                batches.pop_front();
+            }
+        }
+
+        const size_t index;
+        uint64_t records = 0;
+
+    private:
+        int readBatch()
+        {
+            while (reader == nullptr || next == reader->records())
+            {
+                if (nextLog == logs.size())
+                {
+                    exhausted = true;
+                    return 0;
+                }
+                reader = std::make_shared<LogReader>();
+                next = 0;
+                int res = reader->open(logs[nextLog], options.threads);
+                if (res != 0)
+                {
+                    std::cerr << "Error opening " << logs[nextLog] << ": " << ((res == -ENOTSUP) ? "compressed segment, built without lz4" : ::strerror(-res)) << std::endl;
+                    return res;
+                }
+                nextLog++;
+            }
+            auto batch = std::make_unique<Batch>();
+            batch->reader = reader;
+            size_t count = std::min({ ParseBatch, options.buffer, reader->records() - next });
+            reader->parse(next, count, batch->columns);
+            next += count;
+            rewrite(batch->columns);
+            batch->pending = count;
+            for (size_t i = 0; i < count; i++)
+            {
+                uint64_t time = batch->columns.timeStart[i];
+                window.push({ time, sequence++, batch.get(), i });
+                newest = std::max(newest, time);
+            }
+            records += count;
+            batches.push_back(std::move(batch));
+            return 0;
+        }
+
+        uint64_t Shift(uint64_t time) const
+        {
+            return (shift < 0 && static_cast<uint64_t>(-shift) > time) ? 0 : time + shift;
+        }
+
+        // node + 1 in the upper bits, uids that do not fit get a new one (uids are counters in fileaccess, pointers in logfs)
+        uint64_t Id(uint64_t id, std::unordered_map<uint64_t, uint64_t> &large)
+        {
+            if (id >> IdShift != 0)
+            {
+                auto [entry, added] = large.try_emplace(id, (uint64_t(1) << IdShift) - 1 - large.size());
+                id = entry->second;
+            }
+            return (static_cast<uint64_t>(index + 1) << IdShift) | id;
+        }
+
+        void rewrite(LogColumns &columns)
+        {
+            for (size_t i = 0; i < columns.records(); i++)
+            {
+                columns.timeStart[i] = Shift(columns.timeStart[i]);
+                columns.timeEnd[i] = Shift(columns.timeEnd[i]);
+                if (!options.keepIds)
+                {
+                    columns.inode[i] = (columns.inode[i] != 0) ? Id(columns.inode[i], largeInodes) : 0;
+                    columns.handle[i] = (columns.handle[i] > 0) ? static_cast<int64_t>(Id(columns.handle[i], largeHandles)) : columns.handle[i];
+                }
+            }
+        }
+
+        std::vector<std::string> logs;
+        const Options &options;
+        int64_t shift = 0;
+        size_t nextLog = 0;
+        std::shared_ptr<LogReader> reader;
+        size_t next = 0;
+        bool exhausted = false;
+        uint64_t newest = 0;
+        uint64_t sequence = 0;
+        std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> window;
+        std::deque<std::unique_ptr<Batch>> batches;
+        std::unordered_map<uint64_t, uint64_t> largeInodes, largeHandles;
+    };
+
+    class Output
+    {
+    public:
+        int open(const Options &options)
+        {
+            this->options = &options;
+            file = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "wb");
+            if (file == nullptr)
+            {
+                return -errno;
+            }
+            if (options.segment)
+            {
+                buffer.assign(LogFs::SegmentHeader::Size, '\0'); // written at close, when the size is known
+            }
+            else if (options.header && options.format == LogFs::LogFormat::Text)
+            {
+                buffer = LogAnalysis::TextHeader;
+            }
+            return 0;
+        }
+
+        int write(const LogColumns &columns, size_t i, std::string_view path)
+        {
+            startTime = (records++ == 0) ? columns.timeStart[i] : startTime;
+            if (options->format == LogFs::LogFormat::Binary)
+            {
+                LogAnalysis::AppendBinary(buffer, columns, i, path);
+            }
+            else
+            {
+                LogAnalysis::AppendText(buffer, columns, i, path);
+            }
+            return (buffer.size() >= (1 << 20)) ? flush() : 0;
+        }
+
+        int close()
+        {
+            int res = flush();
+            if (res == 0 && options->segment)
+            {
+                LogFs::SegmentHeader header{};
+                ::memcpy(header.magic, LogFs::SegmentHeader::Magic, sizeof(header.magic));
+                header.version = LogFs::SegmentHeader::Version;
+                header.format = options->format;
+                header.startTime = startTime;
+                header.dataSize = written - LogFs::SegmentHeader::Size;
+                header.compression = LogFs::Compression::None;
+                if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1)
+                {
+                    res = -errno;
+                }
+            }
+            if (file != stdout && std::fclose(file) != 0 && res == 0)
+            {
+                res = -errno;
+            }
+            return res;
+        }
+
+        uint64_t records = 0;
+
+    private:
+        int flush()
+        {
+            if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+            {
+                return -errno;
+            }
+            written += buffer.size();
+            buffer.clear();
+            return 0;
+        }
+
+        const Options *options = nullptr;
+        FILE *file = nullptr;
+        std::string buffer;
+        uint64_t written = 0;
+        uint64_t startTime = 0;
+    };
+
+    bool ParseShift(const char *text, Options &options)
+    {
+        char *end;
+        unsigned long node = std::strtoul(text, &end, 10);
+        if (end == text || *end != '=')
+        {
+            return false;
+        }
+        options.shifts[node] = static_cast<int64_t>(std::llround(std::strtod(end + 1, nullptr) * 1e9));
+        return true;
+    }
+
+    struct Head
+    {
+        uint64_t time;
+        size_t node;
+
+        bool operator>(const Head &other) const
+        {
+            return (time != other.time) ? time > other.time : node > other.node;
+        }
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int c; (c = ::getopt_long(argc, argv, "w:b:s:f:HO:t:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'w':
+            options.window = static_cast<uint64_t>(std::llround(std::strtod(optarg, nullptr) * 1e9));
+            break;
+        case 'b':
+            options.buffer = std::max(1ULL, std::strtoull(optarg, nullptr, 10));
+            break;
+        case 's':
+            if (!ParseShift(optarg, options))
+            {
+                Usage(argv[0]);
+                return 2;
+            }
+            break;
+        case OptKeepIds:
+            options.keepIds = true;
+            break;
+        case 'f':
+            if (std::strcmp(optarg, "text") != 0 && std::strcmp(optarg, "binary") != 0)
+            {
+                Usage(argv[0]);
+                return 2;
+            }
+            options.format = (std::strcmp(optarg, "binary") == 0) ? LogFs::LogFormat::Binary : LogFs::LogFormat::Text;
+            break;
+        case OptSegment:
+            options.segment = true;
+            break;
+        case 'H':
+            options.header = true;
+            break;
+        case 'O':
+            options.output = optarg;
+            break;
+        case 't':
+            options.threads = std::atoi(optarg);
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc || (options.segment && options.output.empty()))
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = optind; i < argc; i++)
+    {
+        nodes.push_back(std::make_unique<Node>(nodes.size(), LogAnalysis::QueryIndex::Logs(argv[i]), options));
+    }
+    Output output;
+    if (int res = output.open(options); res != 0)
+    {
+        std::cerr << "Error opening " << options.output << ": " << ::strerror(-res) << std::endl;
+        return 1;
+    }
+
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (auto &node : nodes)
+    {
+        if (node->fill() != 0)
+        {
+            return 1;
+        }
+        if (!node->empty())
+        {
+            heads.push({ node->top().time, node->index });
+        }
+    }
+    uint64_t last = 0, late = 0;
+    while (!heads.empty())
+    {
+        Node &node = *nodes[heads.top().node];
+        heads.pop();
+        Pending record = node.top();
+        late += (record.time < last) ? 1 : 0;
+        last = std::max(last, record.time);
+        if (int res = output.write(record.batch->columns, record.index, record.batch->reader->path(record.batch->columns, record.index)); res != 0)
+        {
+            std::cerr << "Error writing: " << ::strerror(-res) << std::endl;
+            return 1;
+        }
+        record.batch->pending--;
+        node.pop();
+        if (node.fill() != 0)
+        {
+            return 1;
+        }
+        if (!node.empty())
+        {
+            heads.push({ node.top().time, node.index });
+        }
+    }
+    if (int res = output.close(); res != 0)
+    {
+        std::cerr << "Error writing: " << ::strerror(-res) << std::endl;
+        return 1;
+    }
+
+    for (const auto &node : nodes)
+    {
+        std::cerr << "Node " << node->index << ": " << node->records << " records" << std::endl;
+    }
+    std::cerr << "Merged " << output.records << " records";
+    if (late != 0)
+    {
+        std::cerr << ", " << late << " of them out of order (beyond the window of their node, increase -w / -b)";
+    }
+    std::cerr << std::endl;
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Prints the records of logs matching a pid, inode, handle, type and time range, read through the sidecar indexes of QueryIndex.
+// Missing or stale indexes are built first, so new segments are indexed as they appear.
+#include <LogReader.hpp>
+#include <QueryIndex.hpp>
+#include <RecordFormat.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using LogAnalysis::LogColumns;
+    using LogAnalysis::LogReader;
+    using LogAnalysis::QueryIndex;
+
+    enum LongOption
+    {
+        OptFrom = 256,
+        OptTo,
+        OptNoUpdate
+    };
+
+    const option LongOptions[] =
+    {
+        { "pid",      required_argument, nullptr, 'p' },
+        { "inode",    required_argument, nullptr, 'i' },
+        { "handle",   required_argument, nullptr, 'f' },
+        { "ops",      required_argument, nullptr, 'o' },
+        { "from",     required_argument, nullptr, OptFrom },
+        { "to",       required_argument, nullptr, OptTo },
+        { "header",   no_argument,       nullptr, 'H' },
+        { "count",    no_argument,       nullptr, 'c' },
+        { "threads",  required_argument, nullptr, 't' },
+        { "noupdate", no_argument,       nullptr, OptNoUpdate },
+        { "help",     no_argument,       nullptr, 'h' },
+        { nullptr,    0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-p PID] [-i INODE] [-f HANDLE] [-o TYPES] [--from SEC] [--to SEC] [-H] [-c] [-t THREADS] [--noupdate]\n"
+            "       LOG|DIR [...]\n"
+            "Print the records of the logs (logfs segment directories, segments or csv logs) matching all given conditions.\n"
+            "Times are realtime seconds of time_start as in the log, the range includes both ends.\n";
+    }
+
+    struct Query
+    {
+        std::optional<uint64_t> keys[QueryIndex::KeyCount];
+        std::string types; // empty: all
+        uint64_t from = 0;
+        uint64_t to = UINT64_MAX;
+        bool header = false;
+        bool count = false;
+        bool update = true;
+        unsigned threads = 0;
+
+        bool match(const LogColumns &columns, size_t i) const
+        {
+            return columns.timeStart[i] >= from && columns.timeStart[i] <= to
+                && (types.empty() || types.find(columns.type[i]) != std::string::npos)
+                && (!keys[QueryIndex::Pid] || static_cast<uint32_t>(columns.pid[i]) == *keys[QueryIndex::Pid])
+                && (!keys[QueryIndex::Inode] || columns.inode[i] == *keys[QueryIndex::Inode])
+                && (!keys[QueryIndex::Handle] || static_cast<uint64_t>(columns.handle[i]) == *keys[QueryIndex::Handle]);
+        }
+    };
+
+    uint64_t ParseSeconds(const char *text)
+    {
+        return static_cast<uint64_t>(std::llround(std::strtod(text, nullptr) * 1e9));
+    }
+
+    // offsets of the records that may match: the intersection of the postings of the keys, else the blocks in the time range
+    std::vector<uint64_t> Candidates(const QueryIndex &index, const LogReader &reader, const Query &query)
+    {
+        std::vector<uint64_t> candidates;
+        bool first = true;
+        for (int key = 0; key < QueryIndex::KeyCount; key++)
+        {
+            if (!query.keys[key])
+            {
+                continue;
+            }
+            auto postings = index.find(static_cast<QueryIndex::Key>(key), *query.keys[key]);
+            if (first)
+            {
+                candidates.assign(postings.begin(), postings.end());
+                first = false;
+            }
+            else
+            {
+                std::vector<uint64_t> both;
+                std::set_intersection(candidates.begin(), candidates.end(), postings.begin(), postings.end(), std::back_inserter(both));
+                candidates.swap(both);
+            }
+        }
+        if (!first)
+        {
+            return candidates;
+        }
+
+        std::vector<uint64_t> offsets;
+        for (const auto &block : index.blocks())
+        {
+            if (block.maxTime >= query.from && block.minTime <= query.to)
+            {
+                reader.walk(block.offset, block.records, offsets);
+                candidates.insert(candidates.end(), offsets.begin(), offsets.end());
+            }
+        }
+        return candidates;
+    }
+
+    // returns the number of matching records or -errno
+    int64_t QueryLog(const std::string &log, const Query &query)
+    {
+        QueryIndex index;
+        int res = index.open(log);
+        if ((res == -ENOENT || res == -ESTALE || res == -EINVAL) && query.update)
+        {
+            std::cerr << "Indexing " << log << std::endl;
+            res = QueryIndex::Build(log, query.threads);
+            res = (res != 0) ? res : index.open(log);
+        }
+        if (res != 0)
+        {
+            std::cerr << "Error opening the index of " << log << ": " << ((res == -ENOTSUP) ? "compressed segment, built without lz4" : ::strerror(-res)) << std::endl;
+            return res;
+        }
+        LogReader reader;
+        res = reader.open(log, query.threads, false); // records are read by offset
+        if (res != 0)
+        {
+            std::cerr << "Error opening " << log << ": " << ::strerror(-res) << std::endl;
+            return res;
+        }
+
+        std::vector<uint64_t> candidates = Candidates(index, reader, query);
+        constexpr size_t ParseBatch = 1 << 16;
+        int64_t matches = 0;
+        LogColumns columns;
+        std::string out;
+        for (size_t first = 0; first < candidates.size(); first += ParseBatch)
+        {
+            reader.parseAt(candidates.data() + first, std::min(ParseBatch, candidates.size() - first), columns);
+            out.clear();
+            for (size_t i = 0; i < columns.records(); i++)
+            {
+                if (query.match(columns, i))
+                {
+                    matches++;
+                    if (!query.count)
+                    {
+                        LogAnalysis::AppendText(out, columns, i, reader.path(columns, i));
+                    }
+                }
+            }
+            std::fwrite(out.data(), 1, out.size(), stdout);
+        }
+        return matches;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Query query;
+    for (int c; (c = ::getopt_long(argc, argv, "p:i:f:o:Hct:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 'p':
+            query.keys[QueryIndex::Pid] = static_cast<uint32_t>(std::strtol(optarg, nullptr, 10));
+            break;
+        case 'i':
+            query.keys[QueryIndex::Inode] = std::strtoull(optarg, nullptr, 10);
+            break;
+        case 'f':
+            query.keys[QueryIndex::Handle] = static_cast<uint64_t>(std::strtoll(optarg, nullptr, 10));
+            break;
+        case 'o':
+            query.types = optarg;
+            break;
+        case OptFrom:
+            query.from = ParseSeconds(optarg);
+            break;
+        case OptTo:
+            query.to = ParseSeconds(optarg);
+            break;
+        case 'H':
+            query.header = true;
+            break;
+        case 'c':
+            query.count = true;
+            break;
+        case 't':
+            query.threads = std::atoi(optarg);
+            break;
+        case OptNoUpdate:
+            query.update = false;
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    if (query.header && !query.count)
+    {
+        std::fputs(LogAnalysis::TextHeader, stdout);
+    }
+    int64_t matches = 0;
+    for (int i = optind; i < argc; i++)
+    {
+        for (const auto &log : QueryIndex::Logs(argv[i]))
+        {
+            int64_t res = QueryLog(log, query);
+            if (res < 0)
+            {
+                return 1;
+            }
+            matches += res;
+        }
+    }
+    if (query.count)
+    {
+        std::printf("%lld\n", static_cast<long long>(matches));
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <MappedFile.hpp>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LogAnalysis
+{
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    int MappedFile::open(const std::string &path, bool sequential)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return -errno;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            int res = -errno;
+            ::close(fd);
+            return res;
+        }
+        if (st.st_size == 0)
+        {
+            ::close(fd);
+            return 0; // mmap does not take empty mappings
+        }
+
+        void *mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int res = (mapping == MAP_FAILED) ? -errno : 0;
+        ::close(fd); // the mapping keeps the file
+        if (res != 0)
+        {
+            return res;
+        }
+        ::madvise(mapping, st.st_size, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+        base = static_cast<const char*>(mapping);
+        length = st.st_size;
+        return 0;
+    }
+
+    void MappedFile::close()
+    {
+        if (base != nullptr)
+        {
+            ::munmap(const_cast<char*>(base), length);
+            base = nullptr;
+            length = 0;
+        }
+    }
+}
@@ -0,0 +1,271 @@
+#include <QueryIndex.hpp>
+
+#include <LogReader.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace LogAnalysis
+{
+    namespace
+    {
+        constexpr size_t ParseBatch = 1 << 20;
+
+        int Stat(const std::string &path, uint64_t &size, int64_t &mtime)
+        {
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0)
+            {
+                return -errno;
+            }
+            size = st.st_size;
+            mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+            return 0;
+        }
+
+        int WriteAll(int fd, const void *data, size_t size)
+        {
+            for (size_t written = 0; written < size;)
+            {
+                ssize_t count = ::write(fd, static_cast<const char*>(data) + written, size - written);
+                if (count < 0)
+                {
+                    return -errno;
+                }
+                written += count;
+            }
+            return 0;
+        }
+    }
+
+    std::vector<std::string> QueryIndex::Logs(const std::string &path)
+    {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error))
+        {
+            return { path };
+        }
+        std::vector<std::string> logs;
+        for (const auto &entry : std::filesystem::directory_iterator(path, error))
+        {
+            std::string name = entry.path().filename().string();
+            bool segment = name.starts_with("segment-") && name.ends_with(".log");
+            if (entry.is_regular_file(error) && (segment || name.ends_with(".csv")))
+            {
+                logs.push_back(entry.path().string());
+            }
+        }
+        std::sort(logs.begin(), logs.end()); // the sequence numbers of the segments are zero padded
+        return logs;
+    }
+
+    bool QueryIndex::Fresh(const std::string &log)
+    {
+        uint64_t size;
+        int64_t mtime;
+        if (Stat(log, size, mtime) != 0)
+        {
+            return false;
+        }
+        int fd = ::open(SidecarPath(log).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return false;
+        }
+        QueryIndexHeader header;
+        bool read = ::pread(fd, &header, sizeof(header), 0) == sizeof(header);
+        ::close(fd);
+        return read && ::memcmp(header.magic, QueryIndexHeader::Magic, sizeof(header.magic)) == 0 && header.version == QueryIndexHeader::Version
+            && header.logSize == size && header.logMtime == mtime;
+    }
+
+    int QueryIndex::Build(const std::string &log, unsigned threads)
+    {
+        QueryIndexHeader header{};
+        ::memcpy(header.magic, QueryIndexHeader::Magic, sizeof(header.magic));
+        header.version = QueryIndexHeader::Version;
+        header.blockRecords = BlockRecords;
+        int res = Stat(log, header.logSize, header.logMtime); // before reading, so changes while indexing make it stale
+        if (res != 0)
+        {
+            return res;
+        }
+        LogReader reader;
+        res = reader.open(log, threads);
+        if (res != 0)
+        {
+            return res;
+        }
+
+        std::vector<QueryIndexBlock> blocks;
+        std::vector<std::pair<uint64_t, uint64_t>> postings[KeyCount]; // value, offset
+        for (auto &keyPostings : postings)
+        {
+            keyPostings.reserve(reader.records());
+        }
+        LogColumns columns;
+        for (size_t first = 0; first < reader.records(); first += ParseBatch)
+        {
+            reader.parse(first, std::min(ParseBatch, reader.records() - first), columns);
+            for (size_t i = 0; i < columns.records(); i++)
+            {
+                uint64_t offset = reader.recordOffset(first + i);
+                uint64_t time = columns.timeStart[i];
+                if ((first + i) % BlockRecords == 0)
+                {
+                    blocks.push_back({ time, time, offset, 0 });
+                }
+                QueryIndexBlock &block = blocks.back();
+                block.minTime = std::min(block.minTime, time);
+                block.maxTime = std::max(block.maxTime, time);
+                block.records++;
+
+                postings[Pid].emplace_back(static_cast<uint32_t>(columns.pid[i]), offset);
+                postings[Inode].emplace_back(columns.inode[i], offset);
+                postings[Handle].emplace_back(static_cast<uint64_t>(columns.handle[i]), offset);
+            }
+        }
+        header.records = reader.records();
+        header.blocks = blocks.size();
+        reader.close();
+
+        std::vector<QueryIndexKey> keys[KeyCount];
+        std::vector<uint64_t> offsets[KeyCount];
+        for (int key = 0; key < KeyCount; key++)
+        {
+            auto &keyPostings = postings[key];
+            std::sort(keyPostings.begin(), keyPostings.end());
+            offsets[key].reserve(keyPostings.size());
+            for (const auto &[value, offset] : keyPostings)
+            {
+                if (keys[key].empty() || keys[key].back().value != value)
+                {
+                    keys[key].push_back({ value, offsets[key].size(), 0 });
+                }
+                keys[key].back().count++;
+                offsets[key].push_back(offset);
+            }
+            keyPostings = {}; // free before the next key is sorted
+            header.keys[key] = keys[key].size();
+            header.postings[key] = offsets[key].size();
+        }
+
+        std::string path = SidecarPath(log);
+        std::string temporary = path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            return -errno;
+        }
+        res = WriteAll(fd, &header, sizeof(header));
+        res = (res != 0) ? res : WriteAll(fd, blocks.data(), blocks.size() * sizeof(QueryIndexBlock));
+        for (int key = 0; key < KeyCount; key++)
+        {
+            res = (res != 0) ? res : WriteAll(fd, keys[key].data(), keys[key].size() * sizeof(QueryIndexKey));
+            res = (res != 0) ? res : WriteAll(fd, offsets[key].data(), offsets[key].size() * sizeof(uint64_t));
+        }
+        ::close(fd);
+        if (res == 0 && ::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            res = -errno;
+        }
+        if (res != 0)
+        {
+            ::unlink(temporary.c_str());
+        }
+        return res;
+    }
+
+    int QueryIndex::Update(const std::vector<std::string> &logs, unsigned threads, bool verbose)
+    {
+        int built = 0;
+        for (const auto &log : logs)
+        {
+            if (Fresh(log))
+            {
+                continue;
+            }
+            if (verbose)
+            {
+                std::cerr << "Indexing " << log << std::endl;
+            }
+            int res = Build(log, threads);
+            if (res != 0)
+            {
+                std::cerr << "Error indexing " << log << ": " << ((res == -ENOTSUP) ? "compressed segment, built without lz4" : ::strerror(-res)) << std::endl;
+                return res;
+            }
+            built++;
+        }
+        return built;
+    }
+
+    int QueryIndex::open(const std::string &log)
+    {
+        uint64_t size;
+        int64_t mtime;
+        int res = Stat(log, size, mtime);
+        if (res != 0)
+        {
+            return res;
+        }
+        res = file.open(SidecarPath(log), false);
+        if (res != 0)
+        {
+            return res;
+        }
+        if (file.size() < sizeof(header))
+        {
+            return -EINVAL;
+        }
+        ::memcpy(&header, file.data(), sizeof(header));
+        if (::memcmp(header.magic, QueryIndexHeader::Magic, sizeof(header.magic)) != 0 || header.version != QueryIndexHeader::Version)
+        {
+            return -EINVAL;
+        }
+        if (header.logSize != size || header.logMtime != mtime)
+        {
+            return -ESTALE;
+        }
+
+        // the sections are 8 byte aligned, the mapping is page aligned
+        size_t offset = sizeof(header);
+        size_t expected = offset + header.blocks * sizeof(QueryIndexBlock);
+        for (int key = 0; key < KeyCount; key++)
+        {
+            expected += header.keys[key] * sizeof(QueryIndexKey) + header.postings[key] * sizeof(uint64_t);
+        }
+        if (file.size() != expected)
+        {
+            return -EINVAL;
+        }
+        blockData = reinterpret_cast<const QueryIndexBlock*>(file.data() + offset);
+        offset += header.blocks * sizeof(QueryIndexBlock);
+        for (int key = 0; key < KeyCount; key++)
+        {
+            keyData[key] = reinterpret_cast<const QueryIndexKey*>(file.data() + offset);
+            offset += header.keys[key] * sizeof(QueryIndexKey);
+            postingData[key] = reinterpret_cast<const uint64_t*>(file.data() + offset);
+            offset += header.postings[key] * sizeof(uint64_t);
+        }
+        return 0;
+    }
+
+    std::span<const uint64_t> QueryIndex::find(Key key, uint64_t value) const
+    {
+        std::span<const QueryIndexKey> keys(keyData[key], header.keys[key]);
+        auto it = std::lower_bound(keys.begin(), keys.end(), value, [](const QueryIndexKey &entry, uint64_t value) { return entry.value < value; });
+        if (it == keys.end() || it->value != value)
+        {
+            return {};
+        }
+        return { postingData[key] + it->first, it->count };
+    }
+}
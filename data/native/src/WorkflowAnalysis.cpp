@@ -0,0 +1,687 @@
+#include <WorkflowAnalysis.hpp>
+
+#include <LogReader.hpp>
+#include <Parallel.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace LogAnalysis
+{
+    namespace
+    {
+        constexpr size_t ParseBatch = 1 << 20;
+        constexpr uint32_t NoFile = UINT32_MAX;
+
+        // a record of a pid of a task, in log order
+        struct Access
+        {
+            uint64_t time;
+            uint64_t inode;
+            uint64_t offset;
+            uint64_t size;
+            int64_t result;
+            int32_t pid;
+            uint32_t task;
+            uint32_t file; // index in the files of the folder, NoFile if skipped
+            uint32_t path; // 'O': index in the open paths
+            std::string_view rawPath;
+            char type;
+        };
+
+        // the path column as nextflow_eval.py sees it: ',' joined back as '_', only the part before the first ':', stripped
+        std::string NormalizePath(std::string_view raw)
+        {
+            raw = raw.substr(0, raw.find(':'));
+            size_t first = raw.find_first_not_of(" \t\r\n");
+            size_t last = raw.find_last_not_of(" \t\r\n");
+            std::string path = (first == std::string_view::npos) ? std::string() : std::string(raw.substr(first, last - first + 1));
+            std::replace(path.begin(), path.end(), ',', '_');
+            return path;
+        }
+
+        std::string_view Strip(std::string_view text)
+        {
+            size_t first = text.find_first_not_of(" \t\r\n");
+            if (first == std::string_view::npos)
+            {
+                return {};
+            }
+            return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+        }
+
+        // folders below the given ones (not hidden) that contain the monitoring data
+        std::vector<std::string> FindFolders(const std::vector<std::string> &roots)
+        {
+            std::vector<std::string> found;
+            std::vector<std::filesystem::path> pending;
+            std::error_code error;
+            for (const auto &root : roots)
+            {
+                if (std::filesystem::is_directory(root, error))
+                {
+                    pending.push_back(std::filesystem::absolute(root, error));
+                }
+            }
+            while (!pending.empty())
+            {
+                std::filesystem::path folder = pending.back();
+                pending.pop_back();
+                if (std::filesystem::is_regular_file(folder / "cgroups.csv", error) && std::filesystem::is_regular_file(folder / "file-bpf.csv", error))
+                {
+                    found.push_back(folder.string());
+                }
+                for (const auto &entry : std::filesystem::directory_iterator(folder, error))
+                {
+                    if (!entry.path().filename().string().starts_with('.') && entry.is_directory(error))
+                    {
+                        pending.push_back(entry.path());
+                    }
+                }
+            }
+            std::sort(found.begin(), found.end());
+            return found;
+        }
+
+        // analyse_accesses of nextflow_eval.py, including its handling of empty ranges (portion's empty interval has lower
+        // bound +inf and upper bound -inf, so it counts as a seek up and the next access as well)
+        struct Operation
+        {
+            uint64_t time;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        AccessAnalysis Analyse(const std::vector<Operation> &operations, CoverageMap &accessed)
+        {
+            AccessAnalysis result;
+            if (operations.empty())
+            {
+                return result;
+            }
+            result.firstAccess = operations.front().time;
+            result.lastAccess = operations.back().time;
+            uint64_t lastPtr = operations.front().offset;
+            bool lastPtrMinusInf = false;
+            for (const auto &operation : operations)
+            {
+                result.totalBytes += operation.size;
+                if (operation.size == 0)
+                {
+                    result.seekUp = true;
+                    lastPtrMinusInf = true;
+                    continue;
+                }
+                if (lastPtrMinusInf || operation.offset > lastPtr)
+                {
+                    result.seekUp = true;
+                }
+                else if (operation.offset < lastPtr)
+                {
+                    result.seekDown = true;
+                }
+                lastPtr = operation.offset + operation.size;
+                lastPtrMinusInf = false;
+                accessed.add(operation.offset, operation.offset + operation.size);
+            }
+            result.uniqueBytes = accessed.covered();
+            result.repetitiveBytes = accessed.total() - result.uniqueBytes;
+            if (result.uniqueBytes > 0)
+            {
+                result.minOffset = accessed.lower();
+                result.maxOffset = accessed.upper();
+            }
+            return result;
+        }
+
+        uint32_t Pattern(const AccessAnalysis &analysis, uint32_t access)
+        {
+            if (analysis.uniqueBytes == 0)
+            {
+                return 0;
+            }
+            return access | ((analysis.seekDown || analysis.seekUp) ? PatternRandom : PatternSequential);
+        }
+
+        bool Successful(int64_t result, uint64_t size)
+        {
+            return result > 0 && static_cast<uint64_t>(result) <= size;
+        }
+
+        std::string Seconds(uint64_t ns)
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000000000), static_cast<unsigned long long>((ns % 1000000000) / 1000000));
+            return buffer;
+        }
+
+        void AppendJson(std::string &out, std::string_view text)
+        {
+            out.push_back('"');
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    out.push_back('\\');
+                    out.push_back(c);
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                {
+                    out.push_back(c);
+                }
+            }
+            out.push_back('"');
+        }
+
+        void AppendAnalysis(std::string &out, const AccessAnalysis &analysis)
+        {
+            out += "{\"min_offset\":" + std::to_string(analysis.minOffset) + ",\"max_offset\":" + std::to_string(analysis.maxOffset)
+                + ",\"unique_bytes\":" + std::to_string(analysis.uniqueBytes) + ",\"repetitive_bytes\":" + std::to_string(analysis.repetitiveBytes)
+                + ",\"total_bytes\":" + std::to_string(analysis.totalBytes) + ",\"seek_up\":" + (analysis.seekUp ? "true" : "false")
+                + ",\"seek_down\":" + (analysis.seekDown ? "true" : "false") + ",\"first_access\":\"" + Seconds(analysis.firstAccess)
+                + "\",\"last_access\":\"" + Seconds(analysis.lastAccess) + "\"}";
+        }
+
+        // the coverage of the file by all tasks, shared bytes were read by more than one task
+        void AppendCoverage(std::string &out, const FileStats &file)
+        {
+            CoverageMap tasksReading;
+            for (const auto &task : file.taskReads)
+            {
+                tasksReading.merge(task.reads.presence());
+            }
+            char fraction[32];
+            std::snprintf(fraction, sizeof(fraction), "%.6f", file.reads.fraction(file.fileSize));
+            out += "{\"read_bytes\":" + std::to_string(file.reads.covered()) + ",\"reread_bytes\":" + std::to_string(file.reads.repeated())
+                + ",\"read_fraction\":" + ((file.fileSize != 0) ? std::string(fraction) : "null")
+                + ",\"written_bytes\":" + std::to_string(file.writes.covered()) + ",\"rewritten_bytes\":" + std::to_string(file.writes.repeated())
+                + ",\"shared_read_bytes\":" + std::to_string(tasksReading.covered(2)) + ",\"task_reads\":[";
+            for (size_t i = 0; i < file.taskReads.size(); i++)
+            {
+                out += ((i != 0) ? ",[" : "[") + std::to_string(file.taskReads[i].task) + "," + std::to_string(file.taskReads[i].reads.covered()) + "]";
+            }
+            out += "]}";
+        }
+    }
+
+    int WorkflowAnalysis::run(const std::string &nextflowLog, const std::string &workdirPrefix, const std::vector<std::string> &folders, unsigned threads)
+    {
+        this->threads = Threads(threads);
+        taskList.clear();
+        fileList.clear();
+        int res = readTasks(nextflowLog, workdirPrefix);
+        if (res != 0)
+        {
+            return res;
+        }
+        dataFolders = FindFolders(folders);
+        for (size_t folder = 0; folder < dataFolders.size(); folder++)
+        {
+            res = analyseFolder(folder);
+            if (res != 0)
+            {
+                return res;
+            }
+        }
+        for (auto &task : taskList)
+        {
+            std::sort(task.pids.begin(), task.pids.end());
+            task.pids.erase(std::unique(task.pids.begin(), task.pids.end()), task.pids.end());
+            std::sort(task.files.begin(), task.files.end());
+            task.files.erase(std::unique(task.files.begin(), task.files.end()), task.files.end());
+        }
+        return 0;
+    }
+
+    int WorkflowAnalysis::readTasks(const std::string &nextflowLog, const std::string &workdirPrefix)
+    {
+        std::ifstream log(nextflowLog);
+        if (!log)
+        {
+            return -ENOENT;
+        }
+        static const std::regex Handler(R"(TaskHandler\[id: (\d+); name: (.*?); status: (.*?); exit: (\d+); error: (.*?); workDir: (.*?)\])");
+        static const std::regex Logical(R"((.*?) \((.*?)\))");
+        std::smatch match;
+        for (std::string line; std::getline(log, line);)
+        {
+            if (line.find("TaskHandler[") == std::string::npos || !std::regex_search(line, match, Handler))
+            {
+                continue;
+            }
+            TaskInfo task;
+            task.id = std::stoll(match[1]);
+            task.name = match[2];
+            task.status = match[3];
+            task.exit = match[4];
+            task.error = match[5];
+            task.workdir = match[6];
+            if (task.workdir.starts_with(workdirPrefix))
+            {
+                task.workdir.erase(0, workdirPrefix.size());
+            }
+            std::smatch logical;
+            task.logicalName = std::regex_search(task.name, logical, Logical) ? logical[1].str() : task.name;
+            taskList.push_back(std::move(task));
+        }
+        std::cerr << taskList.size() << " tasks identified." << std::endl;
+        return 0;
+    }
+
+    int WorkflowAnalysis::analyseFolder(size_t folder)
+    {
+        const std::string &path = dataFolders[folder];
+        std::cerr << "Parsing folder " << path << std::endl;
+
+        std::unordered_map<int32_t, uint64_t> pidCgroup;
+        std::unordered_map<uint64_t, std::vector<int32_t>> cgroupPids;
+        std::ifstream cgroups(path + "/cgroups.csv");
+        for (std::string line; std::getline(cgroups, line);)
+        {
+            std::vector<std::string_view> fields;
+            for (size_t start = 0, end; start <= line.size(); start = end + 1)
+            {
+                end = std::min(line.find(',', start), line.size());
+                fields.emplace_back(line.data() + start, end - start);
+            }
+            if (fields.size() < 4)
+            {
+                continue;
+            }
+            int32_t pid = static_cast<int32_t>(std::strtol(std::string(Strip(fields[2])).c_str(), nullptr, 10));
+            uint64_t cgroup = std::strtoull(std::string(Strip(fields[3])).c_str(), nullptr, 10);
+            pidCgroup[pid] = cgroup;
+            cgroupPids[cgroup].push_back(pid);
+        }
+
+        LogReader reader;
+        int res = reader.open(path + "/file-bpf.csv", threads);
+        if (res != 0)
+        {
+            std::cerr << "Error opening " << path << "/file-bpf.csv: " << ::strerror(-res) << std::endl;
+            return res;
+        }
+
+        // 1. the read only opens of .command.sh (and write only ones of .versions.yml) tell the main pid of a task, all pids in
+        //    its cgroup belong to the task
+        std::unordered_map<int32_t, uint32_t> pidTask;
+        LogColumns columns;
+        for (size_t first = 0; first < reader.records(); first += ParseBatch)
+        {
+            reader.parse(first, std::min(ParseBatch, reader.records() - first), columns);
+            for (size_t i = 0; i < columns.records(); i++)
+            {
+                if (columns.type[i] != 'O')
+                {
+                    continue;
+                }
+                std::string openPath = NormalizePath(reader.path(columns, i));
+                uint64_t mode = columns.flags[i] & 0b11;
+                if (!(openPath.ends_with("/.command.sh") && mode == 0) && !(openPath.ends_with("/.versions.yml") && mode == 1))
+                {
+                    continue;
+                }
+                for (int64_t task = taskList.size() - 1; task >= 0; task--) // a task has several handler lines, the last one wins
+                {
+                    if (!openPath.starts_with(taskList[task].workdir))
+                    {
+                        continue;
+                    }
+                    auto cgroup = pidCgroup.find(columns.pid[i]);
+                    if (cgroup == pidCgroup.end())
+                    {
+                        std::cerr << "cgroup for Main-PID " << columns.pid[i] << " for task \"" << taskList[task].name << "\" not found. Skipping ..." << std::endl;
+                        break;
+                    }
+                    for (int32_t pid : cgroupPids[cgroup->second])
+                    {
+                        pidTask[pid] = task;
+                        taskList[task].pids.push_back(pid);
+                    }
+                    break;
+                }
+            }
+        }
+
+        // 2. the records of the pids of tasks, filtered in parallel
+        std::vector<Access> accesses;
+        const unsigned parts = threads;
+        for (size_t first = 0; first < reader.records(); first += ParseBatch)
+        {
+            reader.parse(first, std::min(ParseBatch, reader.records() - first), columns);
+            std::vector<std::vector<Access>> partAccesses(parts);
+            const size_t count = columns.records();
+            ParallelFor(parts, threads, 1, [&](size_t from, size_t to)
+            {
+                for (size_t part = from; part < to; part++)
+                {
+                    for (size_t i = count * part / parts; i < count * (part + 1) / parts; i++)
+                    {
+                        auto task = pidTask.find(columns.pid[i]);
+                        if (task == pidTask.end())
+                        {
+                            continue;
+                        }
+                        partAccesses[part].push_back({ columns.timeStart[i], columns.inode[i], columns.offset[i], columns.size[i], columns.result[i],
+                            columns.pid[i], task->second, NoFile, 0, reader.path(columns, i), columns.type[i] });
+                    }
+                }
+            });
+            for (const auto &part : partAccesses)
+            {
+                accesses.insert(accesses.end(), part.begin(), part.end());
+            }
+        }
+
+        // 3. in log order: the task times, the files by inode and the inodes of unlinks, which are only known by the path of an earlier open
+        std::unordered_map<uint64_t, uint32_t> inodeFile;
+        std::unordered_map<std::string, uint64_t> pathInode;
+        std::vector<std::string> openPaths;
+        const size_t firstFile = fileList.size();
+        for (auto &access : accesses)
+        {
+            TaskInfo &task = taskList[access.task];
+            task.firstLog = std::min(task.firstLog, access.time);
+            task.lastLog = std::max(task.lastLog, access.time);
+
+            if (access.type == 'U')
+            {
+                auto inode = pathInode.find(NormalizePath(access.rawPath));
+                if (inode == pathInode.end())
+                {
+                    std::cerr << "No inode found for \"" << NormalizePath(access.rawPath) << "\", skipping file." << std::endl;
+                    continue;
+                }
+                access.inode = inode->second;
+            }
+            auto [file, added] = inodeFile.try_emplace(access.inode, static_cast<uint32_t>(fileList.size() - firstFile));
+            if (added)
+            {
+                FileStats &stats = fileList.emplace_back();
+                stats.folder = folder;
+                stats.inode = access.inode;
+            }
+            access.file = file->second;
+            task.files.push_back(firstFile + access.file);
+
+            if (access.type == 'O')
+            {
+                FileStats &stats = fileList[firstFile + access.file];
+                access.path = openPaths.size();
+                openPaths.push_back(NormalizePath(access.rawPath));
+                if (stats.path.empty())
+                {
+                    stats.path = openPaths.back();
+                }
+                pathInode[stats.path] = access.inode;
+            }
+        }
+
+        // 4. per file in parallel: totals, accesses per pid and their analysis
+        const size_t fileCount = fileList.size() - firstFile;
+        std::vector<std::vector<uint32_t>> fileAccesses(fileCount);
+        for (uint32_t i = 0; i < accesses.size(); i++)
+        {
+            if (accesses[i].file != NoFile)
+            {
+                fileAccesses[accesses[i].file].push_back(i);
+            }
+        }
+        ParallelFor(fileCount, threads, 64, [&](size_t from, size_t to)
+        {
+            for (size_t file = from; file < to; file++)
+            {
+                FileStats &stats = fileList[firstFile + file];
+                std::unordered_map<int32_t, size_t> pidIndex;
+                std::vector<std::vector<Operation>> reads, writes;
+                std::vector<uint32_t> pidTasks;
+                for (uint32_t index : fileAccesses[file])
+                {
+                    const Access &access = accesses[index];
+                    auto [entry, added] = pidIndex.try_emplace(access.pid, stats.accesses.size());
+                    if (added)
+                    {
+                        stats.accesses.emplace_back().pid = access.pid;
+                        pidTasks.push_back(access.task);
+                        reads.emplace_back();
+                        writes.emplace_back();
+                    }
+                    FileAccesses &pidAccesses = stats.accesses[entry->second];
+                    pidAccesses.firstLog = std::min(pidAccesses.firstLog, access.time);
+                    pidAccesses.lastLog = std::max(pidAccesses.lastLog, access.time);
+                    switch (access.type)
+                    {
+                    case 'O':
+                        pidAccesses.opens++;
+                        pidAccesses.path = openPaths[access.path];
+                        pidAccesses.hasPath = true;
+                        break;
+                    case 'C':
+                        pidAccesses.closes++;
+                        break;
+                    case 'U':
+                        pidAccesses.deletes++;
+                        break;
+                    case 'R':
+                    case 'W':
+                    {
+                        bool read = (access.type == 'R');
+                        (read ? pidAccesses.reads : pidAccesses.writes)++;
+                        (read ? reads : writes)[entry->second].push_back({ access.time, access.offset, access.size });
+                        if (Successful(access.result, access.size))
+                        {
+                            (read ? stats.totalReads : stats.totalWrites)++;
+                            (read ? stats.totalReadSize : stats.totalWriteSize) += access.result;
+                            stats.fileSize = std::max(stats.fileSize, access.offset + access.result);
+                        }
+                        break;
+                    }
+                    }
+                }
+                // the coverage of the pids summed up per file and per task
+                std::map<uint32_t, CoverageMap> taskReads;
+                for (size_t i = 0; i < stats.accesses.size(); i++)
+                {
+                    FileAccesses &pidAccesses = stats.accesses[i];
+                    CoverageMap pidReads, pidWrites;
+                    pidAccesses.analysisReads = Analyse(reads[i], pidReads);
+                    pidAccesses.analysisWrites = Analyse(writes[i], pidWrites);
+                    pidAccesses.pattern = Pattern(pidAccesses.analysisReads, PatternRead) | Pattern(pidAccesses.analysisWrites, PatternWrite);
+                    stats.reads.merge(pidReads);
+                    stats.writes.merge(pidWrites);
+                    if (!pidReads.empty())
+                    {
+                        taskReads[pidTasks[i]].merge(pidReads);
+                    }
+                }
+                for (auto &[task, coverage] : taskReads)
+                {
+                    stats.taskReads.push_back({ task, std::move(coverage) });
+                }
+                std::sort(stats.accesses.begin(), stats.accesses.end(), [](const FileAccesses &a, const FileAccesses &b) { return a.pid < b.pid; });
+            }
+        });
+        std::cerr << accesses.size() << " records of tasks, " << fileCount << " files." << std::endl;
+        return 0;
+    }
+
+    uint64_t WorkflowAnalysis::overlap(size_t taskA, size_t taskB) const
+    {
+        const auto &filesA = taskList[taskA].files, &filesB = taskList[taskB].files;
+        std::vector<size_t> common;
+        std::set_intersection(filesA.begin(), filesA.end(), filesB.begin(), filesB.end(), std::back_inserter(common));
+        uint64_t bytes = 0;
+        for (size_t file : common)
+        {
+            const CoverageMap *reads[2] = { nullptr, nullptr };
+            for (const auto &task : fileList[file].taskReads)
+            {
+                reads[0] = (task.task == taskA) ? &task.reads : reads[0];
+                reads[1] = (task.task == taskB) ? &task.reads : reads[1];
+            }
+            bytes += (reads[0] != nullptr && reads[1] != nullptr) ? reads[0]->overlap(*reads[1]) : 0;
+        }
+        return bytes;
+    }
+
+    std::string WorkflowAnalysis::json(bool overlaps) const
+    {
+        std::string out = "{\"folders\":[";
+        for (size_t i = 0; i < dataFolders.size(); i++)
+        {
+            out += (i != 0) ? "," : "";
+            AppendJson(out, dataFolders[i]);
+        }
+        out += "],\"tasks\":[";
+        for (size_t i = 0; i < taskList.size(); i++)
+        {
+            const TaskInfo &task = taskList[i];
+            out += (i != 0) ? ",{\"id\":" : "{\"id\":";
+            out += std::to_string(task.id);
+            for (auto [name, value] : { std::pair{ "name", &task.name }, { "status", &task.status }, { "exit", &task.exit }, { "error", &task.error },
+                { "workdir", &task.workdir }, { "logical_name", &task.logicalName } })
+            {
+                out += ",\"" + std::string(name) + "\":";
+                AppendJson(out, *value);
+            }
+            bool logged = (task.firstLog != UINT64_MAX);
+            out += ",\"first_log\":" + (logged ? "\"" + Seconds(task.firstLog) + "\"" : "null");
+            out += ",\"last_log\":" + (logged ? "\"" + Seconds(task.lastLog) + "\"" : "null");
+            out += ",\"pids\":[";
+            for (size_t j = 0; j < task.pids.size(); j++)
+            {
+                out += ((j != 0) ? "," : "") + std::to_string(task.pids[j]);
+            }
+            out += "],\"files\":[";
+            for (size_t j = 0; j < task.files.size(); j++)
+            {
+                out += ((j != 0) ? "," : "") + std::to_string(task.files[j]);
+            }
+            out += "]}";
+        }
+        out += "],\"files\":[";
+        for (size_t i = 0; i < fileList.size(); i++)
+        {
+            const FileStats &file = fileList[i];
+            out += (i != 0) ? "," : "";
+            out += "{\"folder\":" + std::to_string(file.folder) + ",\"inode\":" + std::to_string(file.inode) + ",\"path\":";
+            if (file.path.empty())
+            {
+                out += "null";
+            }
+            else
+            {
+                AppendJson(out, file.path);
+            }
+            out += ",\"filesize\":" + std::to_string(file.fileSize) + ",\"total_reads\":" + std::to_string(file.totalReads)
+                + ",\"total_read_size\":" + std::to_string(file.totalReadSize) + ",\"total_writes\":" + std::to_string(file.totalWrites)
+                + ",\"total_write_size\":" + std::to_string(file.totalWriteSize) + ",\"coverage\":";
+            AppendCoverage(out, file);
+            out += ",\"accesses\":[";
+            for (size_t j = 0; j < file.accesses.size(); j++)
+            {
+                const FileAccesses &accesses = file.accesses[j];
+                out += (j != 0) ? ",{\"pid\":" : "{\"pid\":";
+                out += std::to_string(accesses.pid) + ",\"path\":";
+                if (accesses.hasPath)
+                {
+                    AppendJson(out, accesses.path);
+                }
+                else
+                {
+                    out += "null";
+                }
+                out += ",\"opens\":" + std::to_string(accesses.opens) + ",\"closes\":" + std::to_string(accesses.closes)
+                    + ",\"reads\":" + std::to_string(accesses.reads) + ",\"writes\":" + std::to_string(accesses.writes)
+                    + ",\"deletes\":" + std::to_string(accesses.deletes) + ",\"pattern\":" + std::to_string(accesses.pattern)
+                    + ",\"first_log\":\"" + Seconds(accesses.firstLog) + "\",\"last_log\":\"" + Seconds(accesses.lastLog) + "\",\"analysis_reads\":";
+                AppendAnalysis(out, accesses.analysisReads);
+                out += ",\"analysis_writes\":";
+                AppendAnalysis(out, accesses.analysisWrites);
+                out += "}";
+            }
+            out += "]}";
+        }
+        out += "]";
+        if (overlaps)
+        {
+            // pairs of tasks per file, summed up over the files
+            std::map<std::pair<size_t, size_t>, uint64_t> pairs;
+            for (const auto &file : fileList)
+            {
+                for (size_t i = 0; i < file.taskReads.size(); i++)
+                {
+                    for (size_t j = i + 1; j < file.taskReads.size(); j++)
+                    {
+                        if (uint64_t bytes = file.taskReads[i].reads.overlap(file.taskReads[j].reads); bytes != 0)
+                        {
+                            pairs[{ file.taskReads[i].task, file.taskReads[j].task }] += bytes;
+                        }
+                    }
+                }
+            }
+            out += ",\"overlaps\":[";
+            for (auto it = pairs.begin(); it != pairs.end(); ++it)
+            {
+                out += (it != pairs.begin()) ? "," : "";
+                out += "{\"tasks\":[" + std::to_string(it->first.first) + "," + std::to_string(it->first.second) + "],\"bytes\":" + std::to_string(it->second) + "}";
+            }
+            out += "]";
+        }
+        out += "}";
+        return out;
+    }
+}
+
+namespace
+{
+    struct Analysis
+    {
+        LogAnalysis::WorkflowAnalysis analysis;
+        std::string json;
+    };
+}
+
+void *workflow_analyse(const char *nextflowLog, const char *workdirPrefix, const char **folders, int folderCount, unsigned threads, int *error)
+{
+    auto analysis = std::make_unique<Analysis>();
+    int res = analysis->analysis.run(nextflowLog, workdirPrefix, std::vector<std::string>(folders, folders + folderCount), threads);
+    if (error != nullptr)
+    {
+        *error = res;
+    }
+    if (res != 0)
+    {
+        return nullptr;
+    }
+    analysis->json = analysis->analysis.json();
+    return analysis.release();
+}
+
+const char *workflow_json(void *analysis)
+{
+    return static_cast<Analysis*>(analysis)->json.c_str();
+}
+
+void workflow_close(void *analysis)
+{
+    delete static_cast<Analysis*>(analysis);
+}
@@ -0,0 +1,89 @@
+// Command line front end of WorkflowAnalysis: writes the per task and per file statistics of nextflow_eval.py as json.
+#include <WorkflowAnalysis.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    enum LongOption
+    {
+        OptOverlaps = 256
+    };
+
+    const option LongOptions[] =
+    {
+        { "threads",  required_argument, nullptr, 't' },
+        { "output",   required_argument, nullptr, 'O' },
+        { "overlaps", no_argument,       nullptr, OptOverlaps },
+        { "help",     no_argument,       nullptr, 'h' },
+        { nullptr,    0,                 nullptr, 0 }
+    };
+
+    void Usage(const char *name)
+    {
+        std::cerr << "usage: " << name << " [-t THREADS] [-O OUTPUT] [--overlaps] NEXTFLOW_LOG WORKDIR_PREFIX FOLDER [...]\n"
+            "Compute the task and file statistics of nextflow_eval.py (same arguments) and write them as json.\n"
+            "--overlaps adds the bytes read by both tasks of all pairs of tasks reading the same bytes.\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    std::string outputPath;
+    bool overlaps = false;
+    for (int c; (c = ::getopt_long(argc, argv, "t:O:h", LongOptions, nullptr)) != -1;)
+    {
+        switch (c)
+        {
+        case 't':
+            threads = std::atoi(optarg);
+            break;
+        case 'O':
+            outputPath = optarg;
+            break;
+        case OptOverlaps:
+            overlaps = true;
+            break;
+        case 'h':
+            Usage(argv[0]);
+            return 0;
+        default:
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind < 3)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    LogAnalysis::WorkflowAnalysis analysis;
+    int res = analysis.run(argv[optind], argv[optind + 1], std::vector<std::string>(argv + optind + 2, argv + argc), threads);
+    if (res != 0)
+    {
+        std::cerr << "Error analysing: " << ::strerror(-res) << std::endl;
+        return 1;
+    }
+    std::string json = analysis.json(overlaps);
+    if (outputPath.empty())
+    {
+        std::cout << json << std::endl;
+    }
+    else
+    {
+        std::ofstream(outputPath) << json << std::endl;
+    }
+    std::cerr << "Analysed " << analysis.tasks().size() << " tasks and " << analysis.files().size() << " files in "
+        << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+    return 0;
+}
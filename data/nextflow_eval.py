@@ -140,6 +140,7 @@ class FileAccesses:
 
 class File:
     inode = None
+    folder = None # monitoring folder of the inode, inodes are only unique per node
     path = None # last path the file was opened through
     total_read = 0
     total_read_size = 0
@@ -151,6 +152,7 @@ class File:
 
     def __init__(self) -> None:
         self.inode = None
+        self.folder = None
         self.path = None
         self.total_reads = self.total_read_size = self.total_writes = self.total_write_size = self.filesize = 0
         self.accesses = dict()
@@ -351,6 +353,7 @@ for folder in folders:
             else:
                 file = File()
                 file.inode = inode
+                file.folder = folder
                 inode_file_dict[inode] = file
                 files.add(file)
 
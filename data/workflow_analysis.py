@@ -0,0 +1,178 @@
+import ctypes
+import json
+import os
+import sys
+import time
+from decimal import Decimal
+
+# python bindings of libworkflow (data/native), the data preparation of nextflow_eval.py on all cores
+# example usage:
+#   analysis = workflow_analysis.analyse('.nextflow.log', '/global/space', ['monitoring'])
+#   for task in analysis['tasks']: ...   # see list_files_per_task below for the fields
+# run directly it prints the files per task (list_files_per_task of nextflow_eval.py):
+#   python3 workflow_analysis.py <.nextflow.log file path> <global shared space prefix> <folder> [folder [...]]
+# with --compare first, the preparation of nextflow_eval.py runs as well, the results are compared and both times printed
+
+PATTERN_READ = 0b0001
+PATTERN_WRITE = 0b0010
+PATTERN_RANDOM = 0b0100
+PATTERN_SEQUENTIAL = 0b1000
+
+_library = None
+
+
+def load_library(path=None):
+    global _library
+    if _library is None:
+        path = path or os.environ.get('WORKFLOW_LIBRARY') or os.path.join(os.path.dirname(os.path.abspath(__file__)), 'native', 'build', 'libworkflow.so')
+        _library = ctypes.CDLL(path)
+        _library.workflow_analyse.restype = ctypes.c_void_p
+        _library.workflow_analyse.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_uint, ctypes.POINTER(ctypes.c_int)]
+        _library.workflow_json.restype = ctypes.c_char_p
+        _library.workflow_json.argtypes = [ctypes.c_void_p]
+        _library.workflow_close.argtypes = [ctypes.c_void_p]
+    return _library
+
+
+# returns {'folders': [...], 'tasks': [...], 'files': [...]}, times are strings of seconds like in the logs, None if missing
+def analyse(nflogpath, workdirprefix, folders, threads=0):
+    lib = load_library()
+    paths = (ctypes.c_char_p * len(folders))(*[os.fsencode(os.path.abspath(f)) for f in folders])
+    error = ctypes.c_int(0)
+    handle = lib.workflow_analyse(os.fsencode(nflogpath), os.fsencode(workdirprefix), paths, len(folders), threads, ctypes.byref(error))
+    if not handle:
+        raise OSError(-error.value, os.strerror(-error.value), nflogpath)
+    try:
+        return json.loads(lib.workflow_json(handle))
+    finally:
+        lib.workflow_close(handle)
+
+
+def pattern_string(pattern):
+    names = [('PATTERN_READ', PATTERN_READ), ('PATTERN_WRITE', PATTERN_WRITE), ('PATTERN_SEQUENTIAL', PATTERN_SEQUENTIAL), ('PATTERN_RANDOM', PATTERN_RANDOM)]
+    return ' | '.join([name for (name, bit) in names if pattern & bit != 0])
+
+
+def list_files_per_task(analysis):
+    for t in analysis['tasks']:
+        print('Task ', t['name'], ':', sep='')
+        pids = set(t['pids'])
+        for index in t['files']:
+            f = analysis['files'][index]
+            pattern = 0
+            for accesses in f['accesses']:
+                if accesses['pid'] in pids:
+                    pattern = pattern | accesses['pattern']
+            print("\t", f['path'], ' (fs ', f['filesize'], ' bytes, ', f['total_reads'], ' reads ', f['total_read_size'], ' bytes, ', f['total_writes'], ' writes ', f['total_write_size'], ' bytes) - ', pattern_string(pattern), sep='')
+    print()
+
+
+# runs the data preparation of nextflow_eval.py (everything before its evals) and returns its globals
+def run_script(argv):
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'nextflow_eval.py')
+    with open(script) as f:
+        source = f.read()
+    source = source[:source.index('\n# evals\n')]
+    saved = sys.argv
+    sys.argv = [script] + argv
+    try:
+        scope = {'__name__': 'nextflow_eval'}
+        exec(compile(source, script, 'exec'), scope)
+        return scope
+    finally:
+        sys.argv = saved
+
+
+# times without records are Infinity / 0 in the script (first / last) and None or 0 in native, all None here
+def time_value(value):
+    if value is None:
+        return None
+    value = Decimal(str(value))
+    return None if value == 0 or value.is_infinite() else value.quantize(Decimal('0.001'))
+
+
+def analysis_values(a):
+    return (a.min_offset, a.max_offset, a.unique_bytes, a.repetitive_bytes, a.total_bytes, a.seek_up, a.seek_down, time_value(a.first_access), time_value(a.last_access))
+
+
+def json_analysis_values(a):
+    return (a['min_offset'], a['max_offset'], a['unique_bytes'], a['repetitive_bytes'], a['total_bytes'], a['seek_up'], a['seek_down'], time_value(a['first_access']), time_value(a['last_access']))
+
+
+# Every TaskHandler line of the log is a task on both sides, a task usually has several (submitted, completed). A pid goes to
+# any of them in the script and to the last in native, so the lines are merged per id: names and workdirs, the earliest and
+# latest record, the pids and the files of all of them.
+def merge_tasks(tasks):
+    merged = dict()
+    for (id, name, workdir, first_log, last_log, pids, files) in tasks:
+        names, workdirs, first, last, all_pids, all_files = merged.get(id, (set(), set(), None, None, set(), set()))
+        first_log, last_log = time_value(first_log), time_value(last_log)
+        merged[id] = (names | {name}, workdirs | {workdir}, first_log if first is None or (first_log is not None and first_log < first) else first,
+                      last_log if last is None or (last_log is not None and last_log > last) else last, all_pids | set(pids), all_files | set(files))
+    return {id: (tuple(sorted(names)), tuple(sorted(workdirs)), first, last, tuple(sorted(pids)), tuple(sorted(files)))
+            for (id, (names, workdirs, first, last, pids, files)) in merged.items()}
+
+
+# the objects of the script as comparable tuples, files by folder, inode and path
+def script_results(scope):
+    def key(f):
+        return (f.folder, f.inode, f.path)
+    tasks = merge_tasks((t.id, t.name, t.workdir, t.first_log, t.last_log, t.pids, [key(f) for f in t.files]) for t in scope['tasks'])
+    files = dict()
+    for f in scope['files']:
+        accesses = {pid: (a.path, len(a.opens), len(a.closes), len(a.reads), len(a.writes), len(a.deletes), a.pattern, time_value(a.first_log), time_value(a.last_log),
+                          analysis_values(a.analysis_reads), analysis_values(a.analysis_writes)) for (pid, a) in f.accesses.items()}
+        files[key(f)] = (f.filesize, f.total_reads, f.total_read_size, f.total_writes, f.total_write_size, accesses)
+    return tasks, files
+
+
+def native_results(analysis):
+    def key(f):
+        return (analysis['folders'][f['folder']], f['inode'], f['path'])
+    tasks = merge_tasks((t['id'], t['name'], t['workdir'], t['first_log'], t['last_log'], t['pids'], [key(analysis['files'][i]) for i in t['files']]) for t in analysis['tasks'])
+    files = dict()
+    for f in analysis['files']:
+        accesses = {a['pid']: (a['path'], a['opens'], a['closes'], a['reads'], a['writes'], a['deletes'], a['pattern'], time_value(a['first_log']), time_value(a['last_log']),
+                               json_analysis_values(a['analysis_reads']), json_analysis_values(a['analysis_writes'])) for a in f['accesses']}
+        files[key(f)] = (f['filesize'], f['total_reads'], f['total_read_size'], f['total_writes'], f['total_write_size'], accesses)
+    return tasks, files
+
+
+def compare(name, expected, actual):
+    differences = 0
+    for k in expected.keys() | actual.keys():
+        if expected.get(k) != actual.get(k):
+            differences += 1
+            if differences <= 10:
+                print('%s %s differs:\n\tnextflow_eval.py: %s\n\tnative: %s' % (name, k, expected.get(k), actual.get(k)))
+    print('%s: %d of the script, %d native, %d differ' % (name, len(expected), len(actual), differences))
+    return differences
+
+
+if __name__ == '__main__':
+    argv = sys.argv[1:]
+    do_compare = len(argv) > 0 and argv[0] == '--compare'
+    if do_compare:
+        argv = argv[1:]
+    if len(argv) < 3:
+        print('usage: workflow_analysis.py [--compare] <.nextflow.log file path> <global shared space prefix> <folder> [folder [...]]')
+        sys.exit(1)
+
+    start = time.perf_counter()
+    analysis = analyse(argv[0], argv[1], argv[2:])
+    native_time = time.perf_counter() - start
+
+    if not do_compare:
+        list_files_per_task(analysis)
+        print('Analysed in %.3f s' % native_time, file=sys.stderr)
+        sys.exit(0)
+
+    start = time.perf_counter()
+    scope = run_script(argv)
+    script_time = time.perf_counter() - start
+
+    script_tasks, script_files = script_results(scope)
+    native_tasks, native_files = native_results(analysis)
+    differences = compare('Tasks', script_tasks, native_tasks) + compare('Files', script_files, native_files)
+    print('nextflow_eval.py: %.3f s, native: %.3f s (%.1fx)' % (script_time, native_time, script_time / max(native_time, 1e-9)))
+    sys.exit(1 if differences else 0)
@@ -0,0 +1,61 @@
+#ifndef LOGFS_CLOCK_HPP
+#define LOGFS_CLOCK_HPP
+
+#include <cstdint>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace LogFs
+{
+    // Realtime nanosecond timestamps for the log records.
+    // Uses a calibrated invariant TSC if available, otherwise CLOCK_MONOTONIC (vDSO). Both are mapped to realtime once at startup.
+    class Clock
+    {
+    public:
+        static bool Init(); // calibrates and checks the drift, must be called once before any other thread uses Now()
+        static bool UsesTsc() { return TscMult != 0; }
+
+        static uint64_t Now()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            if (TscMult != 0)
+            {
+                return RtBase + static_cast<uint64_t>((static_cast<unsigned __int128>(__rdtsc() - TscBase) * TscMult) >> TscShift);
+            }
+#endif
+            return MonotonicNs() + RtMonDiff;
+        }
+
+        static uint64_t MonotonicNs()
+        {
+            timespec ts;
+            if (::clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+            {
+                return 0;
+            }
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        static constexpr uint32_t TscShift = 32;
+        static constexpr uint64_t CalibrationNs = 50000000; // 50 ms
+        static constexpr uint64_t DriftCheckNs = 20000000; // 20 ms
+        static constexpr uint64_t MaxDriftPpm = 100; // fall back to clock_gettime if the tsc deviates more than this
+
+    private:
+        static bool TscInvariant();
+        static bool CalibrateTsc();
+        static int64_t DriftPpm();
+        static uint64_t GetRtMonDiff();
+
+        static inline uint64_t RtMonDiff = 0; // realtime - monotonic
+        static inline uint64_t RtBase = 0; // realtime at TscBase
+        static inline uint64_t TscBase = 0;
+        static inline uint64_t TscMult = 0; // ns per tick << TscShift, 0 if the tsc is not used
+    };
+}
+
+#endif // guard
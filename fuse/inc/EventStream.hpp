@@ -0,0 +1,274 @@
+#ifndef LOGFS_EVENTSTREAM_HPP
+#define LOGFS_EVENTSTREAM_HPP
+
+#include <LogFormat.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Live event stream of logfs in a POSIX shared memory object (/dev/shm/<name>).
+//
+// Layout:
+//   StreamHeader (StreamHeader::Size bytes)
+//   slotCount slots of slotSize bytes, each a StreamSlot followed by a BinaryRecord (and its path)
+//
+// Writers claim a sequence number from head, slot = sequence & (slotCount - 1). The slot's sequence is set to Busy while the
+// record is written and to sequence + 1 once it is complete. Writers never wait for readers: a reader that falls behind more
+// than slotCount records gets lapped, notices it by the slot sequence and skips ahead (counted in lost).
+// Readers register in one of the consumer entries of the header, which publishes their cursor and lost count.
+namespace LogFs
+{
+    struct StreamSlot
+    {
+        std::atomic<uint64_t> sequence; // sequence + 1 of the record in the slot, 0 if never written, Busy while written
+        uint32_t length;
+        uint32_t reserved;
+
+        static constexpr uint64_t Busy = UINT64_MAX;
+    };
+
+    struct alignas(64) StreamConsumer
+    {
+        std::atomic<int32_t> pid; // 0 if unused
+        std::atomic<uint64_t> cursor; // next sequence the consumer reads
+        std::atomic<uint64_t> lost; // records the consumer missed because it was too slow
+    };
+
+    struct StreamHeader
+    {
+        static constexpr char Magic[8] = { 'L', 'O', 'G', 'F', 'S', 'S', 'H', 'M' };
+        static constexpr uint32_t Version = 2;
+        static constexpr size_t MaxConsumers = 32;
+        static constexpr size_t Size = 4096;
+
+        char magic[8]; // Magic
+        uint32_t version;
+        uint32_t slotSize;
+        uint64_t slotCount; // power of two
+        alignas(64) std::atomic<uint64_t> head; // next sequence to be claimed by a writer
+        alignas(64) std::atomic<uint32_t> notify; // futex, incremented on publish while there are waiters
+        std::atomic<uint32_t> waiters;
+        StreamConsumer consumers[MaxConsumers];
+
+        StreamSlot *slot(uint64_t sequence)
+        {
+            return reinterpret_cast<StreamSlot*>(reinterpret_cast<char*>(this) + Size + (sequence & (slotCount - 1)) * slotSize);
+        }
+        static size_t MappingSize(uint32_t slotSize, uint64_t slotCount) { return Size + slotSize * slotCount; }
+    };
+
+    static_assert(sizeof(StreamHeader) <= StreamHeader::Size, "StreamHeader too big.");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs lock free atomics.");
+
+    // Publisher side, used by logfs.
+    class EventStreamWriter
+    {
+    public:
+        EventStreamWriter() = default;
+        ~EventStreamWriter();
+
+        EventStreamWriter(const EventStreamWriter &) = delete;
+        EventStreamWriter(EventStreamWriter &&) = delete;
+        EventStreamWriter &operator=(const EventStreamWriter &) = delete;
+        EventStreamWriter &operator=(EventStreamWriter &&) = delete;
+
+        int create(const char *name, uint64_t slotCount);
+        void destroy();
+
+        // claims the next slot and returns the space for the record, publish has to follow
+        std::span<char> claim(uint64_t &sequence)
+        {
+            sequence = header->head.fetch_add(1, std::memory_order_relaxed);
+            StreamSlot *slot = header->slot(sequence);
+            slot->sequence.store(StreamSlot::Busy, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            return { reinterpret_cast<char*>(slot + 1), header->slotSize - sizeof(StreamSlot) };
+        }
+        void publish(uint64_t sequence, uint32_t length)
+        {
+            StreamSlot *slot = header->slot(sequence);
+            slot->length = length;
+            slot->sequence.store(sequence + 1, std::memory_order_release);
+            if (header->waiters.load(std::memory_order_relaxed) != 0)
+            {
+                header->notify.fetch_add(1, std::memory_order_release);
+                ::syscall(SYS_futex, &header->notify, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+            }
+        }
+
+        static constexpr uint32_t SlotSize = 512; // StreamSlot + BinaryRecord with the longest path
+
+    private:
+        StreamHeader *header = nullptr;
+        size_t size = 0;
+        char name[NAME_MAX] = {};
+    };
+
+    static_assert(sizeof(StreamSlot) + BinaryRecord::RecordLength(TextRecord::SizePath) <= EventStreamWriter::SlotSize, "Slots too small for a record.");
+
+    // Consumer side, header only so other tools only need to include this file.
+    // next() returns records in place (zero copy). Since writers never wait, a record may be overwritten while it is used by a
+    // slow reader; valid() tells if the last record returned by next() was still intact afterwards.
+    class EventStreamReader
+    {
+    public:
+        EventStreamReader() = default;
+        ~EventStreamReader() { detach(); }
+
+        EventStreamReader(const EventStreamReader &) = delete;
+        EventStreamReader(EventStreamReader &&) = delete;
+        EventStreamReader &operator=(const EventStreamReader &) = delete;
+        EventStreamReader &operator=(EventStreamReader &&) = delete;
+
+        // attaches to the stream, reading starts with the next published record
+        int attach(const char *name)
+        {
+            int fd = ::shm_open(name, O_RDWR, 0);
+            if (fd == -1)
+            {
+                return -errno;
+            }
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < StreamHeader::Size)
+            {
+                ::close(fd);
+                return -EINVAL;
+            }
+            void *mem = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mem == MAP_FAILED)
+            {
+                return -errno;
+            }
+            header = static_cast<StreamHeader*>(mem);
+            size = st.st_size;
+            if (::memcmp(header->magic, StreamHeader::Magic, sizeof(header->magic)) != 0 || header->version != StreamHeader::Version
+                || StreamHeader::MappingSize(header->slotSize, header->slotCount) > size)
+            {
+                detach();
+                return -EINVAL;
+            }
+
+            // take a free entry or one of a consumer that exited without detaching
+            for (auto &cur : header->consumers)
+            {
+                int32_t pid = cur.pid.load();
+                if ((pid == 0 || (::kill(pid, 0) == -1 && errno == ESRCH)) && cur.pid.compare_exchange_strong(pid, ::getpid()))
+                {
+                    consumer = &cur;
+                    break;
+                }
+            }
+            if (consumer == nullptr)
+            {
+                detach();
+                return -EUSERS;
+            }
+            cursor = header->head.load(std::memory_order_acquire);
+            consumer->cursor.store(cursor, std::memory_order_relaxed);
+            consumer->lost.store(0, std::memory_order_relaxed);
+            return 0;
+        }
+        void detach()
+        {
+            if (consumer != nullptr)
+            {
+                consumer->pid.store(0);
+                consumer = nullptr;
+            }
+            if (header != nullptr)
+            {
+                ::munmap(header, size);
+                header = nullptr;
+            }
+        }
+
+        // next record or nullptr if there is none (yet)
+        const BinaryRecord *next()
+        {
+            while (true)
+            {
+                uint64_t head = header->head.load(std::memory_order_acquire);
+                if (head - cursor > header->slotCount) // lapped, skip to the oldest record that can still be intact
+                {
+                    skip(head - header->slotCount);
+                }
+                if (cursor == head)
+                {
+                    return nullptr;
+                }
+                current = header->slot(cursor);
+                uint64_t sequence = current->sequence.load(std::memory_order_acquire);
+                if (sequence == cursor + 1)
+                {
+                    currentSequence = sequence;
+                    cursor++;
+                    consumer->cursor.store(cursor, std::memory_order_relaxed);
+                    return reinterpret_cast<const BinaryRecord*>(current + 1);
+                }
+                else if (sequence != StreamSlot::Busy && sequence > cursor + 1) // already overwritten
+                {
+                    skip(cursor + 1);
+                }
+                else // claimed but not yet published
+                {
+                    return nullptr;
+                }
+            }
+        }
+        bool valid() const
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return current != nullptr && current->sequence.load(std::memory_order_relaxed) == currentSequence;
+        }
+
+        // blocks till new records are published or timeoutMs passed. Also sleeps if the next record is claimed but not published
+        // yet, publish wakes the waiters then, instead of returning at once and letting the caller spin on next().
+        void wait(int timeoutMs)
+        {
+            uint32_t notify = header->notify.load(std::memory_order_acquire);
+            header->waiters.fetch_add(1);
+            uint64_t sequence = header->slot(cursor)->sequence.load(std::memory_order_acquire);
+            bool published = header->head.load(std::memory_order_acquire) != cursor && sequence != StreamSlot::Busy && sequence > cursor;
+            if (!published)
+            {
+                timespec timeout { .tv_sec = timeoutMs / 1000, .tv_nsec = (timeoutMs % 1000) * 1000000L };
+                ::syscall(SYS_futex, &header->notify, FUTEX_WAIT, notify, &timeout, nullptr, 0);
+            }
+            header->waiters.fetch_sub(1);
+        }
+
+        uint64_t lost() const { return consumer->lost.load(std::memory_order_relaxed); }
+        const StreamHeader *stream() const { return header; }
+
+    private:
+        void skip(uint64_t to)
+        {
+            consumer->lost.fetch_add(to - cursor, std::memory_order_relaxed);
+            cursor = to;
+            consumer->cursor.store(cursor, std::memory_order_relaxed);
+        }
+
+        StreamHeader *header = nullptr;
+        size_t size = 0;
+        StreamConsumer *consumer = nullptr;
+        uint64_t cursor = 0;
+        const StreamSlot *current = nullptr;
+        uint64_t currentSequence = 0;
+    };
+}
+
+#endif // guard
@@ -1,6 +1,12 @@
 #ifndef LOGFS_FILESYSTEM_HPP
 #define LOGFS_FILESYSTEM_HPP
 
+#include <Clock.hpp>
+#include <EventStream.hpp>
+#include <LogFormat.hpp>
+#include <LogSink.hpp>
+#include <PidCache.hpp>
+
 #include <fuse3/fuse_lowlevel.h>
 
 #include <atomic>
@@ -8,6 +14,7 @@
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <span>
@@ -32,7 +39,7 @@ namespace LogFs
         std::atomic<uint64_t> lookup = 0;
     };
 
-    class LogEntry
+    class LogEntry : public TextRecord
     {
     public:
         static LogEntry GetOpen(int pid, uint64_t inode, int flags);
@@ -40,46 +47,18 @@ namespace LogFs
         static LogEntry GetRead(int pid, uint64_t inode, uint64_t fh, off_t off, size_t size);
         static LogEntry GetWrite(int pid, uint64_t inode, uint64_t fh, off_t off, size_t size);
         void end(int res);
-        std::span<char> getBuf();
+        std::span<char> getBuf(std::string_view path = {});
+        uint32_t writeBinary(std::span<char> dest, std::string_view path) const; // returns the record length
         bool unknownFh() const;
         
         static void InformNewNode(uint64_t inode, bool created);
 
-        static constexpr auto SizeTimeSec    =  20; // maybe a '-' followed by up to 19 digits, a '.' and 3 digits
-        static constexpr auto SizeTimeNsec   =   3; // 3 digits
-        static constexpr auto SizeTime       =  SizeTimeSec + 1 + SizeTimeNsec; // maybe a '-' followed by up to 19 digits, a '.' and 3 digits
-        static constexpr auto SizePid        =  11; // maybe a '-' followed by up to 10 digits
-        static constexpr auto SizeInode      =  20; // up to 20 digits
-        static constexpr auto SizeEvent      =   1; // 1 byte
-        static constexpr auto SizeResult     =  11; // maybe a '-' followed by up to 10 digits
-        static constexpr auto SizeFilehandle =  20; // maybe a '-' followed by up to 19 digits
-        static constexpr auto SizeOffset     =  20; // maybe a '-' followed by up to 19 digits
-        static constexpr auto SizeSize       =  20; // up to 20 digits
-        static constexpr auto SizeFlags      =  10; // "0x" followed by 8 digits
-        static constexpr auto SizePath       = 240; // up to 240 characters for now
-
-        static constexpr auto OffRTimeStart = 0;
-        static constexpr auto OffRTimeEnd   = OffRTimeStart + SizeTime       + 1;
-        static constexpr auto OffPid        = OffRTimeEnd   + SizeTime       + 1;
-        static constexpr auto OffUTimeStart = OffPid        + SizePid        + 1;
-        static constexpr auto OffUTimeEnd   = OffUTimeStart + SizeTime       + 1;
-        static constexpr auto OffSTimeStart = OffUTimeEnd   + SizeTime       + 1;
-        static constexpr auto OffSTimeEnd   = OffSTimeStart + SizeTime       + 1;
-        static constexpr auto OffInode      = OffSTimeEnd   + SizeTime       + 1;
-        static constexpr auto OffEvent      = OffInode      + SizeInode      + 1;
-        static constexpr auto OffResult     = OffEvent      + SizeEvent      + 1;
-        static constexpr auto OffFilehandle = OffResult     + SizeResult     + 1;
-        static constexpr auto OffOffset     = OffFilehandle + SizeFilehandle + 1;
-        static constexpr auto OffSize       = OffOffset     + SizeOffset     + 1;
-        static constexpr auto OffFlags      = OffSize       + SizeSize       + 1;
-        static constexpr auto OffPath       = OffFlags      + SizeFlags      + 1;
-
-        static constexpr auto SizeEntry = OffPath + SizePath + 1;
+        static_assert(BinaryRecord::RecordLength(SizePath) <= SizeEntry, "Binary records have to fit into the entry buffer.");
 
     private:
         void start(int pid, uint64_t ino, char evt, uint64_t fh);
-        
-        static void GetRTime(timespec *rTime);
+        std::span<char> getTextBuf(std::string_view path);
+
         static void GetPidStatTimes(int pid, timespec *utime, timespec *stime);
 
         static std::unordered_map<uint64_t, uint64_t> Fhs;
@@ -89,27 +68,22 @@ namespace LogFs
         static std::shared_mutex MutexInodes;
         static std::atomic<int64_t> CurInode;
 
-        union
-        {
-            char buffer[SizeEntry];
-            struct
-            {
-                timespec rTimeStart;
-                timespec rTimeEnd;
-                int pid;
-                timespec uTimeStart;
-                timespec uTimeEnd;
-                timespec sTimeStart;
-                timespec sTimeEnd;
-                uint64_t inode;
-                char event;
-                int result;
-                int64_t filehandle;
-                uint64_t offset;
-                uint64_t size;
-                int flags;
-            };
-        };
+        uint64_t rTimeStart; // realtime in ns
+        uint64_t rTimeEnd;
+        int pid;
+        timespec uTimeStart;
+        timespec uTimeEnd;
+        timespec sTimeStart;
+        timespec sTimeEnd;
+        uint64_t inode;
+        char event;
+        int result;
+        int64_t filehandle;
+        uint64_t offset;
+        uint64_t size;
+        int flags;
+
+        char buffer[SizeEntry]; // output of getBuf
     };
 
     struct FileSystem
@@ -126,7 +100,7 @@ namespace LogFs
         int setupPollPipe();
         int killPollThread(bool notifyPollHandles = false);
         int poll(const PollMessage &ph) const;
-        int writeLog(std::span<char> logData);
+        int writeLog(LogEntry &log, std::string_view path = {});
 
         std::unordered_map<ino_t, Node> nodes;
         std::shared_mutex nodesMutex;
@@ -134,6 +108,9 @@ namespace LogFs
         std::unique_ptr<Node> root = nullptr;
         int pollpipeFd = -1;
         int logFd = STDOUT_FILENO;
+        LogFormat logFormat = LogFormat::Text;
+        std::unique_ptr<LogSink> logSink = nullptr; // segmented log files instead of logFd if set
+        std::unique_ptr<EventStreamWriter> eventStream = nullptr; // live binary records for local consumers if set
         
         static fuse_lowlevel_ops GetOps();
 
@@ -0,0 +1,158 @@
+#ifndef LOGFS_LOGFORMAT_HPP
+#define LOGFS_LOGFORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Definitions of the on-disk log formats. Kept free of FUSE dependencies so analysis tools can include it.
+namespace LogFs
+{
+    enum class LogFormat : uint32_t
+    {
+        Text = 0, // fixed width csv, see TextRecord
+        Binary = 1 // BinaryRecord followed by the path
+    };
+
+    enum class Compression : uint32_t
+    {
+        None = 0,
+        Lz4 = 1 // segment data is a sequence of FrameHeader + lz4 block
+    };
+
+    // Layout of the fixed width text records, shared with bpf/fileaccess.py. Record N starts at N * SizeEntry.
+    struct TextRecord
+    {
+        static constexpr auto SizeTimeSec    =  20; // maybe a '-' followed by up to 19 digits, a '.' and 3 digits
+        static constexpr auto SizeTimeNsec   =   3; // 3 digits
+        static constexpr auto SizeTime       =  SizeTimeSec + 1 + SizeTimeNsec; // maybe a '-' followed by up to 19 digits, a '.' and 3 digits
+        static constexpr auto SizePid        =  11; // maybe a '-' followed by up to 10 digits
+        static constexpr auto SizeInode      =  20; // up to 20 digits
+        static constexpr auto SizeEvent      =   1; // 1 byte
+        static constexpr auto SizeResult     =  11; // maybe a '-' followed by up to 10 digits
+        static constexpr auto SizeFilehandle =  20; // maybe a '-' followed by up to 19 digits
+        static constexpr auto SizeOffset     =  20; // maybe a '-' followed by up to 19 digits
+        static constexpr auto SizeSize       =  20; // up to 20 digits
+        static constexpr auto SizeFlags      =  10; // "0x" followed by 8 digits
+        static constexpr auto SizePath       = 240; // up to 240 characters for now
+
+        static constexpr auto OffRTimeStart = 0;
+        static constexpr auto OffRTimeEnd   = OffRTimeStart + SizeTime       + 1;
+        static constexpr auto OffPid        = OffRTimeEnd   + SizeTime       + 1;
+        static constexpr auto OffUTimeStart = OffPid        + SizePid        + 1;
+        static constexpr auto OffUTimeEnd   = OffUTimeStart + SizeTime       + 1;
+        static constexpr auto OffSTimeStart = OffUTimeEnd   + SizeTime       + 1;
+        static constexpr auto OffSTimeEnd   = OffSTimeStart + SizeTime       + 1;
+        static constexpr auto OffInode      = OffSTimeEnd   + SizeTime       + 1;
+        static constexpr auto OffEvent      = OffInode      + SizeInode      + 1;
+        static constexpr auto OffResult     = OffEvent      + SizeEvent      + 1;
+        static constexpr auto OffFilehandle = OffResult     + SizeResult     + 1;
+        static constexpr auto OffOffset     = OffFilehandle + SizeFilehandle + 1;
+        static constexpr auto OffSize       = OffOffset     + SizeOffset     + 1;
+        static constexpr auto OffFlags      = OffSize       + SizeSize       + 1;
+        static constexpr auto OffPath       = OffFlags      + SizeFlags      + 1;
+
+        static constexpr auto SizeEntry = OffPath + SizePath + 1;
+    };
+
+    // Binary log record. All times are in nanoseconds, the r times are realtime.
+    // The record is followed by pathLength bytes of path (not null terminated) and padded to a multiple of 8 bytes.
+    struct BinaryRecord
+    {
+        uint16_t length; // size of the whole record including path and padding
+        uint16_t pathLength;
+        char event;
+        uint8_t reserved[3];
+        int32_t pid;
+        int32_t result;
+        uint64_t flags;
+        uint64_t rTimeStart;
+        uint64_t rTimeEnd;
+        uint64_t uTimeStart;
+        uint64_t uTimeEnd;
+        uint64_t sTimeStart;
+        uint64_t sTimeEnd;
+        uint64_t inode;
+        int64_t filehandle;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t cgroupId; // cgroup v2 id of the process, 0 if unknown
+        char comm[16]; // process name, null terminated
+
+        static constexpr uint16_t Align = 8;
+        static constexpr uint16_t RecordLength(uint16_t pathLength)
+        {
+            return (sizeof(BinaryRecord) + pathLength + Align - 1) & ~(Align - 1);
+        }
+        const char *path() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    static_assert(sizeof(BinaryRecord) == 128, "BinaryRecord layout changed.");
+
+    // Start time of a record in ns (text records only have millisecond resolution).
+    inline uint64_t RecordTime(LogFormat format, const char *record)
+    {
+        if (format == LogFormat::Binary)
+        {
+            uint64_t time;
+            std::memcpy(&time, record + offsetof(BinaryRecord, rTimeStart), sizeof(time));
+            return time;
+        }
+        uint64_t sec = 0, msec = 0;
+        for (const char *cur = record + TextRecord::OffRTimeStart; cur != record + TextRecord::OffRTimeStart + TextRecord::SizeTimeSec; cur++)
+        {
+            sec = (*cur >= '0' && *cur <= '9') ? sec * 10 + (*cur - '0') : sec;
+        }
+        for (const char *cur = record + TextRecord::OffRTimeStart + TextRecord::SizeTimeSec + 1; cur != record + TextRecord::OffRTimeStart + TextRecord::SizeTime; cur++)
+        {
+            msec = msec * 10 + (*cur - '0');
+        }
+        return sec * 1000000000 + msec * 1000000;
+    }
+
+    // Header at the start of every log segment file (segment-<sequence>.log). It occupies the whole first block so the records start aligned.
+    // Records never span segments, so every segment can be processed on its own.
+    // dataSize is only set when the segment is closed; while it is 0 the records end at the first zero byte (text), zero length (binary) or zero magic (compressed).
+    struct SegmentHeader
+    {
+        char magic[8]; // Magic
+        uint32_t version;
+        LogFormat format;
+        uint64_t sequence;
+        uint64_t startTime; // realtime in ns
+        uint64_t dataSize; // bytes of records (or frames) following the header
+        Compression compression;
+
+        static constexpr char Magic[8] = { 'L', 'O', 'G', 'F', 'S', 'S', 'E', 'G' };
+        static constexpr uint32_t Version = 3;
+        static constexpr uint64_t Size = 4096;
+    };
+
+    static_assert(sizeof(SegmentHeader) <= SegmentHeader::Size, "SegmentHeader too big.");
+
+    // Header of an independently compressed block of records.
+    struct FrameHeader
+    {
+        uint32_t magic; // Magic
+        uint32_t rawSize;
+        uint32_t compressedSize; // bytes following this header
+        uint32_t records;
+
+        static constexpr uint32_t Magic = 0x4d52464c; // "LFRM"
+    };
+
+    // Entry of the block index (segment-<sequence>.idx) that is written next to every segment, one per block of records.
+    // For compressed segments a block is one frame. Records are only roughly time ordered, so first/last is the min/max of the block.
+    struct IndexEntry
+    {
+        uint64_t firstTime;
+        uint64_t lastTime;
+        uint64_t offset; // byte offset of the block relative to the end of the segment header
+        uint32_t records;
+        uint32_t size; // bytes in the segment
+    };
+
+    static_assert(sizeof(IndexEntry) == 32, "IndexEntry layout changed.");
+}
+
+#endif // guard
@@ -0,0 +1,106 @@
+#ifndef LOGFS_LOGSINK_HPP
+#define LOGFS_LOGSINK_HPP
+
+#include <LogFormat.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LogFs
+{
+    // Writes the log into a directory of preallocated, fixed size segments.
+    // Records are copied into buffers by the FUSE threads and written by a background thread with aligned (O_DIRECT) writes.
+    // Every buffer is one block of the segment's index and, if compression is enabled, one independently compressed frame.
+    class LogSink
+    {
+    public:
+        struct Config
+        {
+            std::string directory;
+            LogFormat format = LogFormat::Text;
+            Compression compression = Compression::None;
+            uint64_t segmentSize = 256 << 20; // including the header
+            uint64_t rotateNs = 0; // start a new segment after this time, 0 to only rotate by size
+            uint64_t syncNs = 0; // fdatasync interval, 0 to never sync explicitly
+            uint64_t flushNs = 1000000000; // max time records stay in memory
+            size_t bufferSize = 1 << 20;
+            size_t maxBuffers = 64; // records are dropped if this many buffers are waiting to be written
+            bool directIo = true;
+        };
+
+        LogSink() = default;
+        ~LogSink();
+
+        LogSink(const LogSink &) = delete;
+        LogSink(LogSink &&) = delete;
+        LogSink &operator=(const LogSink &) = delete;
+        LogSink &operator=(LogSink &&) = delete;
+
+        int open(const Config &config); // creates the first segment, records are buffered until start
+        void start(); // starts the writer thread, after fuse_daemonize as threads do not survive its fork
+        static bool CompressionSupported(Compression compression);
+        int append(std::span<const char> data); // never blocks on I/O, -errno once the writer failed to open a segment
+        void stop(); // writes everything and closes the current segment
+
+        static constexpr size_t Align = 4096; // alignment of O_DIRECT writes
+
+    private:
+        struct Buffer
+        {
+            char *data = nullptr;
+            size_t size = 0;
+            uint32_t records = 0;
+            uint64_t firstTime = 0;
+            uint64_t lastTime = 0;
+            bool lastOfSegment = false; // rotate after writing this buffer
+        };
+
+        Buffer getBuffer();
+        void queueActive();
+        void run();
+        void writeBuffer(const Buffer &buffer);
+        uint32_t writeRaw(const Buffer &buffer);
+        uint32_t writeFrame(const Buffer &buffer);
+        int openSegment();
+        int closeSegment();
+        int writeHeader();
+        int writeOut(bool all);
+
+        Config config;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        Buffer active;
+        std::deque<Buffer> pending;
+        std::vector<Buffer> freeBuffers;
+        size_t allocatedBuffers = 0;
+        uint64_t segmentUsed = 0; // bytes assigned to the current segment by append
+        uint64_t segmentStart = 0;
+        uint64_t lastFlush = 0;
+        bool stopping = false;
+        int failed = 0; // -errno of the writer, appends are refused then
+        std::atomic<uint64_t> dropped = 0;
+        std::thread thread;
+
+        // only used by the background thread
+        int fd = -1;
+        int indexFd = -1;
+        uint64_t sequence = 0;
+        uint64_t fileStartTime = 0;
+        uint64_t dataSize = 0; // bytes of records in the current segment
+        uint64_t writeOffset = 0; // aligned file offset of out[0]
+        char *out = nullptr; // aligned staging buffer, holds the unwritten tail block and new data
+        size_t outSize = 0;
+        size_t outUsed = 0;
+        uint64_t lastSync = 0;
+    };
+}
+
+#endif // guard
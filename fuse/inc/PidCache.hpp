@@ -0,0 +1,43 @@
+#ifndef LOGFS_PIDCACHE_HPP
+#define LOGFS_PIDCACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace LogFs
+{
+    // Cgroup id and comm of the processes issuing requests, read from /proc/<pid>/cgroup and /proc/<pid>/comm on first sight.
+    // Direct mapped by pid, a colliding pid or an entry older than MaxAgeNs (pid reuse, cgroup migration) is simply overwritten.
+    // Every entry is guarded by a sequence lock, so lookups never take a lock.
+    class PidCache
+    {
+    public:
+        struct Info
+        {
+            uint64_t cgroupId; // id as returned by bpf_get_current_cgroup_id (inode of the cgroup v2 directory), 0 if unknown
+            char comm[16];
+        };
+
+        static Info Get(int pid);
+
+        static constexpr size_t Slots = 4096; // power of two
+        static constexpr uint64_t MaxAgeNs = 10000000000; // 10 s
+
+    private:
+        struct alignas(64) Entry
+        {
+            std::atomic<uint32_t> seq = 0; // odd while the entry is written
+            int pid = 0;
+            uint64_t time = 0;
+            Info info{};
+        };
+
+        static void Read(int pid, Info &info);
+        static const char *CgroupRoot();
+
+        static Entry Entries[Slots];
+    };
+}
+
+#endif // guard
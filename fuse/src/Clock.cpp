@@ -0,0 +1,133 @@
+#include <Clock.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace LogFs
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // monotonic time and tsc read as close together as possible (best of a few tries)
+    static void SampleTsc(uint64_t &ns, uint64_t &tsc)
+    {
+        uint64_t best = std::numeric_limits<uint64_t>::max();
+        for (int i = 0; i < 8; i++)
+        {
+            uint64_t before = __rdtsc();
+            uint64_t mon = Clock::MonotonicNs();
+            uint64_t after = __rdtsc();
+            if (after - before < best)
+            {
+                best = after - before;
+                ns = mon;
+                tsc = before + (after - before) / 2;
+            }
+        }
+    }
+
+    static void SleepNs(uint64_t ns)
+    {
+        timespec ts
+        {
+            .tv_sec = static_cast<time_t>(ns / 1000000000),
+            .tv_nsec = static_cast<long>(ns % 1000000000)
+        };
+        while (::nanosleep(&ts, &ts) != 0);
+    }
+#endif
+
+    bool Clock::Init()
+    {
+        RtMonDiff = GetRtMonDiff();
+        if (!TscInvariant())
+        {
+            std::cerr << "No invariant TSC, using CLOCK_MONOTONIC for timestamps." << std::endl;
+            return false;
+        }
+        if (!CalibrateTsc())
+        {
+            std::cerr << "TSC calibration failed, using CLOCK_MONOTONIC for timestamps." << std::endl;
+            return false;
+        }
+        int64_t drift = DriftPpm();
+        if (drift > static_cast<int64_t>(MaxDriftPpm) || drift < -static_cast<int64_t>(MaxDriftPpm))
+        {
+            std::cerr << "TSC drifts " << drift << " ppm against CLOCK_MONOTONIC, using CLOCK_MONOTONIC for timestamps." << std::endl;
+            TscMult = 0;
+            return false;
+        }
+        std::cerr << "Using invariant TSC for timestamps (" << (static_cast<double>(uint64_t(1) << TscShift) / TscMult) << " GHz, drift " << drift << " ppm)." << std::endl;
+        return true;
+    }
+
+    bool Clock::TscInvariant()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return false;
+        }
+        return (edx & (1 << 8)) != 0; // invariant tsc, ticks with constant rate in all P-, C- and T-states
+#else
+        return false;
+#endif
+    }
+
+    bool Clock::CalibrateTsc()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        uint64_t ns0, tsc0, ns1, tsc1;
+        SampleTsc(ns0, tsc0);
+        SleepNs(CalibrationNs);
+        SampleTsc(ns1, tsc1);
+        if (ns0 == 0 || ns1 <= ns0 || tsc1 <= tsc0)
+        {
+            return false;
+        }
+        TscBase = tsc0;
+        RtBase = ns0 + RtMonDiff;
+        TscMult = ((ns1 - ns0) << TscShift) / (tsc1 - tsc0);
+        return TscMult != 0;
+#else
+        return false;
+#endif
+    }
+
+    int64_t Clock::DriftPpm()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        uint64_t ns0, tsc0, ns1, tsc1;
+        SampleTsc(ns0, tsc0);
+        SleepNs(DriftCheckNs);
+        SampleTsc(ns1, tsc1);
+        int64_t expected = static_cast<int64_t>(ns1 - ns0);
+        int64_t measured = static_cast<int64_t>((static_cast<unsigned __int128>(tsc1 - tsc0) * TscMult) >> TscShift);
+        return (measured - expected) * 1000000 / expected;
+#else
+        return 0;
+#endif
+    }
+
+    uint64_t Clock::GetRtMonDiff()
+    {
+        timespec rt;
+        if (::clock_gettime(CLOCK_REALTIME, &rt) != 0)
+        {
+            std::cerr << "Could not init realtime clock." << std::endl;
+            std::exit(-1);
+        }
+        uint64_t mon = MonotonicNs();
+        if (mon == 0)
+        {
+            std::cerr << "Could not init monotonic clock." << std::endl;
+            std::exit(-1);
+        }
+        // real - mon
+        return static_cast<uint64_t>(rt.tv_sec) * 1000000000 + rt.tv_nsec - mon;
+    }
+}
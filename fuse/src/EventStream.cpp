@@ -0,0 +1,60 @@
+#include <EventStream.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <new>
+
+namespace LogFs
+{
+    EventStreamWriter::~EventStreamWriter()
+    {
+        destroy();
+    }
+
+    int EventStreamWriter::create(const char *streamName, uint64_t slotCount)
+    {
+        slotCount = std::bit_ceil(std::max(slotCount, uint64_t(64)));
+        snprintf(name, sizeof(name), "%s%s", (streamName[0] == '/') ? "" : "/", streamName);
+        ::shm_unlink(name); // left over from a previous run
+
+        int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0660);
+        if (fd == -1)
+        {
+            return -errno;
+        }
+        size = StreamHeader::MappingSize(SlotSize, slotCount);
+        if (::ftruncate(fd, size) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            ::shm_unlink(name);
+            return -err;
+        }
+        void *mem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (mem == MAP_FAILED)
+        {
+            int err = errno;
+            ::shm_unlink(name);
+            return -err;
+        }
+
+        header = new (mem) StreamHeader{}; // the object is zero filled by ftruncate, this only makes the atomics proper objects
+        std::copy_n(StreamHeader::Magic, sizeof(header->magic), header->magic);
+        header->version = StreamHeader::Version;
+        header->slotSize = SlotSize;
+        header->slotCount = slotCount;
+        return 0;
+    }
+
+    void EventStreamWriter::destroy()
+    {
+        if (header != nullptr)
+        {
+            ::munmap(header, size);
+            ::shm_unlink(name);
+            header = nullptr;
+        }
+    }
+}
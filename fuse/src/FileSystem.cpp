@@ -277,8 +277,21 @@ namespace LogFs
         }
         return 0;
     }
-    int FileSystem::writeLog(std::span<char> logData)
+    int FileSystem::writeLog(LogEntry &log, std::string_view path)
     {
+        if (Fs.eventStream != nullptr)
+        {
+            uint64_t sequence;
+            auto slot = Fs.eventStream->claim(sequence);
+            Fs.eventStream->publish(sequence, log.writeBinary(slot, path));
+        }
+
+        auto logData = log.getBuf(path);
+        if (Fs.logSink != nullptr)
+        {
+            return Fs.logSink->append(logData);
+        }
+
         int tries = 0;
         size_t written = 0;
         while (written != logData.size())
@@ -1,7 +1,8 @@
 #include <FileSystem.hpp>
 
+#include <algorithm>
 #include <cstdint>
-
+#include <cstring>
 #include <ctime>
 #include <fcntl.h>
 #include <iostream>
@@ -48,7 +49,7 @@ namespace LogFs
     }
     void LogEntry::end(int res)
     {
-        GetRTime(&rTimeEnd);
+        rTimeEnd = Clock::Now();
         GetPidStatTimes(pid, &uTimeEnd, &sTimeEnd);
         if (event == 'O')
         {
@@ -72,12 +73,20 @@ namespace LogFs
             result = res;
         }
     }
-    std::span<char> LogEntry::getBuf()
+    std::span<char> LogEntry::getBuf(std::string_view path)
+    {
+        if (Fs.logFormat == LogFormat::Binary)
+        {
+            return { buffer, writeBinary(buffer, path) };
+        }
+        return getTextBuf(path);
+    }
+    std::span<char> LogEntry::getTextBuf(std::string_view path)
     {
         snprintf(buffer, sizeof(buffer),
-            "%*ld.%0*ld,%*ld.%0*ld,%*d,%*ld.%0*ld,%*ld.%0*ld,%*ld.%0*ld,%*lu.%0*ld,%*lu,%c,%*d,%*ld,%*lu,%*lu,0x%0*x,%*s",
-            SizeTimeSec, rTimeStart.tv_sec, SizeTimeNsec, rTimeStart.tv_nsec / 1000000,
-            SizeTimeSec, rTimeEnd.tv_sec,   SizeTimeNsec, rTimeEnd.tv_nsec   / 1000000,
+            "%*lu.%0*lu,%*lu.%0*lu,%*d,%*ld.%0*ld,%*ld.%0*ld,%*ld.%0*ld,%*lu.%0*ld,%*lu,%c,%*d,%*ld,%*lu,%*lu,0x%0*x,%*s",
+            SizeTimeSec, rTimeStart / 1000000000, SizeTimeNsec, (rTimeStart % 1000000000) / 1000000,
+            SizeTimeSec, rTimeEnd   / 1000000000, SizeTimeNsec, (rTimeEnd   % 1000000000) / 1000000,
             SizePid, pid,
             SizeTimeSec, uTimeStart.tv_sec, SizeTimeNsec, uTimeStart.tv_nsec / 1000000,
             SizeTimeSec, uTimeEnd.tv_sec  , SizeTimeNsec, uTimeEnd.tv_nsec   / 1000000,
@@ -92,9 +101,46 @@ namespace LogFs
             SizeFlags - 2, flags,
             SizePath, ""
         );
+        std::copy_n(path.data(), std::min(path.size(), size_t(SizePath)), &buffer[OffPath]);
         buffer[SizeEntry-1] = '\n'; // replace null with newline
         return { buffer, SizeEntry };
     }
+    uint32_t LogEntry::writeBinary(std::span<char> dest, std::string_view path) const
+    {
+        auto ToNs = [](const timespec &ts) { return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec; };
+        uint16_t pathLength = static_cast<uint16_t>(std::min(path.size(), size_t(SizePath)));
+        PidCache::Info process = PidCache::Get(pid);
+        BinaryRecord record
+        {
+            .length = BinaryRecord::RecordLength(pathLength),
+            .pathLength = pathLength,
+            .event = event,
+            .reserved = {},
+            .pid = pid,
+            .result = result,
+            .flags = static_cast<uint32_t>(flags),
+            .rTimeStart = rTimeStart,
+            .rTimeEnd = rTimeEnd,
+            .uTimeStart = ToNs(uTimeStart),
+            .uTimeEnd = ToNs(uTimeEnd),
+            .sTimeStart = ToNs(sTimeStart),
+            .sTimeEnd = ToNs(sTimeEnd),
+            .inode = inode,
+            .filehandle = filehandle,
+            .offset = offset,
+            .size = size,
+            .cgroupId = process.cgroupId
+        };
+        std::copy_n(process.comm, sizeof(record.comm), record.comm);
+        if (record.length > dest.size())
+        {
+            return 0;
+        }
+        ::memcpy(dest.data(), &record, sizeof(record));
+        std::copy_n(path.data(), pathLength, &dest[sizeof(record)]);
+        ::memset(&dest[sizeof(record) + pathLength], 0, record.length - sizeof(record) - pathLength);
+        return record.length;
+    }
     bool LogEntry::unknownFh() const
     {
         return (filehandle == -2);
@@ -126,50 +172,10 @@ namespace LogFs
         }
         event = evt;
         this->pid = pid;
-        GetRTime(&rTimeStart);
+        rTimeStart = Clock::Now();
         GetPidStatTimes(pid, &uTimeStart, &sTimeStart);
     }
     
-    timespec GetRtMonDiff()
-    {
-        timespec rt, mon;
-        if (::clock_gettime(CLOCK_REALTIME, &rt))
-        {
-            std::cerr << "Could not init realtime clock." << std::endl;
-            std::exit(-1);
-        }
-        if (::clock_gettime(CLOCK_MONOTONIC_COARSE, &mon))
-        {
-            std::cerr << "Could not init monotonic clock." << std::endl;
-            std::exit(-1);
-        }
-        // real - mon
-        if (rt.tv_nsec < mon.tv_nsec)
-        {
-            rt.tv_nsec += 1000000000;
-            rt.tv_sec -= 1;
-        }
-        rt.tv_sec -= mon.tv_sec;
-        rt.tv_nsec -= mon.tv_nsec;
-        return rt;
-    }
-    void LogEntry::GetRTime(timespec *rTime)
-    {
-        static timespec diff = GetRtMonDiff();
-        if (::clock_gettime(CLOCK_MONOTONIC_COARSE, rTime) != 0)
-        {
-            *rTime = { 0, 0 };
-        }
-        else
-        {
-            rTime->tv_sec += diff.tv_sec;
-            if ((rTime->tv_nsec += diff.tv_nsec) > 1000000000)
-            {
-                rTime->tv_nsec -= 1000000000;
-                rTime->tv_sec += 1;
-            }
-        }
-    }
     void LogEntry::GetPidStatTimes(int pid, timespec *utime, timespec *stime)
     {
         /// @todo: implement
@@ -0,0 +1,470 @@
+#include <LogSink.hpp>
+
+#include <Clock.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef LOGFS_WITH_LZ4
+#include <lz4.h>
+#endif
+
+namespace LogFs
+{
+    LogSink::~LogSink()
+    {
+        stop();
+    }
+
+    bool LogSink::CompressionSupported(Compression compression)
+    {
+#ifdef LOGFS_WITH_LZ4
+        return compression == Compression::None || compression == Compression::Lz4;
+#else
+        return compression == Compression::None;
+#endif
+    }
+
+    int LogSink::open(const Config &cfg)
+    {
+        config = cfg;
+        if (!CompressionSupported(config.compression))
+        {
+            return -ENOTSUP;
+        }
+        config.bufferSize = (std::max(config.bufferSize, size_t(64 << 10)) + Align - 1) & ~(Align - 1);
+        config.segmentSize = std::max((config.segmentSize + Align - 1) & ~(Align - 1), SegmentHeader::Size + config.bufferSize);
+        config.maxBuffers = std::max(config.maxBuffers, size_t(2));
+
+        if (::mkdir(config.directory.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            return -errno;
+        }
+
+        outSize = config.bufferSize;
+#ifdef LOGFS_WITH_LZ4
+        if (config.compression == Compression::Lz4)
+        {
+            outSize = sizeof(FrameHeader) + LZ4_compressBound(config.bufferSize);
+        }
+#endif
+        outSize = ((outSize + Align - 1) & ~(Align - 1)) + Align;
+        if (::posix_memalign(reinterpret_cast<void**>(&out), Align, outSize) != 0)
+        {
+            return -ENOMEM;
+        }
+
+        if (int res = openSegment(); res != 0)
+        {
+            return res;
+        }
+
+        active = getBuffer();
+        segmentStart = lastFlush = lastSync = Clock::Now();
+        return 0;
+    }
+
+    void LogSink::start()
+    {
+        std::unique_lock lock(mutex);
+        if (!thread.joinable() && out != nullptr)
+        {
+            thread = std::thread(&LogSink::run, this);
+        }
+    }
+
+    int LogSink::append(std::span<const char> data)
+    {
+        std::unique_lock lock(mutex);
+        if (failed != 0)
+        {
+            return failed;
+        }
+        if (segmentUsed + data.size() > config.segmentSize - SegmentHeader::Size || (config.rotateNs != 0 && Clock::Now() - segmentStart >= config.rotateNs))
+        {
+            if (segmentUsed != 0)
+            {
+                active.lastOfSegment = true;
+                queueActive();
+                segmentUsed = 0;
+                segmentStart = Clock::Now();
+            }
+        }
+        if (active.data == nullptr || active.size + data.size() > config.bufferSize)
+        {
+            queueActive();
+        }
+        if (active.data == nullptr)
+        {
+            dropped++;
+            return -ENOBUFS;
+        }
+        uint64_t time = RecordTime(config.format, data.data());
+        if (active.records++ == 0)
+        {
+            active.firstTime = active.lastTime = time;
+        }
+        active.firstTime = std::min(active.firstTime, time);
+        active.lastTime = std::max(active.lastTime, time);
+        ::memcpy(active.data + active.size, data.data(), data.size());
+        active.size += data.size();
+        segmentUsed += data.size();
+        return 0;
+    }
+
+    void LogSink::stop()
+    {
+        {
+            std::unique_lock lock(mutex);
+            if (out == nullptr)
+            {
+                return;
+            }
+            if (!thread.joinable())
+            {
+                thread = std::thread(&LogSink::run, this); // never started, writes what was buffered
+            }
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+
+        for (auto &buffer : freeBuffers)
+        {
+            std::free(buffer.data);
+        }
+        freeBuffers.clear();
+        std::free(active.data);
+        active = {};
+        std::free(out);
+        out = nullptr;
+    }
+
+    // must be called with the mutex held
+    LogSink::Buffer LogSink::getBuffer()
+    {
+        if (!freeBuffers.empty())
+        {
+            Buffer buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+            return buffer;
+        }
+        if (allocatedBuffers < config.maxBuffers)
+        {
+            if (char *data = static_cast<char*>(std::malloc(config.bufferSize)); data != nullptr)
+            {
+                allocatedBuffers++;
+                return { .data = data };
+            }
+        }
+        return {};
+    }
+
+    // must be called with the mutex held
+    void LogSink::queueActive()
+    {
+        if (active.size != 0 || active.lastOfSegment) // an empty buffer still has to tell the writer to rotate
+        {
+            pending.push_back(active);
+            active = {};
+            cv.notify_one();
+        }
+        if (active.data == nullptr)
+        {
+            active = getBuffer();
+        }
+    }
+
+    void LogSink::run()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            uint64_t waitNs = (config.syncNs != 0) ? std::min(config.flushNs, config.syncNs) : config.flushNs;
+            cv.wait_for(lock, std::chrono::nanoseconds(waitNs), [this] { return stopping || !pending.empty(); });
+
+            uint64_t now = Clock::Now();
+            bool flush = stopping || now - lastFlush >= config.flushNs;
+            if (flush)
+            {
+                if (active.size != 0)
+                {
+                    queueActive();
+                }
+                lastFlush = now;
+            }
+            bool done = stopping;
+            std::deque<Buffer> work;
+            work.swap(pending);
+            lock.unlock();
+
+            for (const auto &buffer : work)
+            {
+                writeBuffer(buffer);
+            }
+            if (flush)
+            {
+                writeOut(true);
+                if (uint64_t lost = dropped.exchange(0); lost != 0)
+                {
+                    std::cerr << "Log buffers exhausted, dropped " << lost << " log records." << std::endl;
+                }
+            }
+            if (config.syncNs != 0 && now - lastSync >= config.syncNs)
+            {
+                ::fdatasync(fd); // group commit of everything written since the last sync
+                lastSync = now;
+            }
+
+            lock.lock();
+            for (auto &buffer : work)
+            {
+                if (buffer.data != nullptr)
+                {
+                    freeBuffers.push_back({ .data = buffer.data });
+                }
+            }
+            if (done && pending.empty())
+            {
+                break;
+            }
+        }
+        lock.unlock();
+        closeSegment();
+    }
+
+    void LogSink::writeBuffer(const Buffer &buffer)
+    {
+        if (fd == -1)
+        {
+            return; // no segment since a failed rotation, reported then
+        }
+        if (buffer.size != 0)
+        {
+            IndexEntry entry
+            {
+                .firstTime = buffer.firstTime,
+                .lastTime = buffer.lastTime,
+                .offset = dataSize,
+                .records = buffer.records,
+                .size = 0
+            };
+            entry.size = (config.compression == Compression::None) ? writeRaw(buffer) : writeFrame(buffer);
+            if (indexFd != -1 && entry.size != 0 && ::write(indexFd, &entry, sizeof(entry)) != sizeof(entry))
+            {
+                ::close(indexFd);
+                indexFd = -1;
+                std::cerr << "Writing log segment index failed." << std::endl;
+            }
+        }
+        if (buffer.lastOfSegment)
+        {
+            closeSegment();
+            if (int res = openSegment(); res != 0)
+            {
+                std::cerr << "Opening the next log segment failed (" << ::strerror(-res) << "), no more records are logged." << std::endl;
+                std::unique_lock lock(mutex);
+                failed = res;
+            }
+        }
+    }
+
+    uint32_t LogSink::writeRaw(const Buffer &buffer)
+    {
+        for (size_t pos = 0; pos < buffer.size;)
+        {
+            size_t chunk = std::min(buffer.size - pos, outSize - outUsed);
+            ::memcpy(out + outUsed, buffer.data + pos, chunk);
+            outUsed += chunk;
+            pos += chunk;
+            if (outUsed == outSize)
+            {
+                writeOut(false);
+            }
+        }
+        dataSize += buffer.size;
+        return buffer.size;
+    }
+
+    // compresses the buffer directly into out, out is big enough for a worst case frame once the complete blocks are written
+    uint32_t LogSink::writeFrame(const Buffer &buffer)
+    {
+#ifdef LOGFS_WITH_LZ4
+        if (outSize - outUsed < sizeof(FrameHeader) + LZ4_compressBound(buffer.size))
+        {
+            writeOut(false);
+        }
+        int compressed = ::LZ4_compress_default(buffer.data, out + outUsed + sizeof(FrameHeader), buffer.size, outSize - outUsed - sizeof(FrameHeader));
+        if (compressed <= 0)
+        {
+            std::cerr << "Compressing log block failed, " << buffer.records << " records lost." << std::endl;
+            return 0;
+        }
+        FrameHeader header
+        {
+            .magic = FrameHeader::Magic,
+            .rawSize = static_cast<uint32_t>(buffer.size),
+            .compressedSize = static_cast<uint32_t>(compressed),
+            .records = buffer.records
+        };
+        ::memcpy(out + outUsed, &header, sizeof(header));
+        uint32_t size = sizeof(header) + compressed;
+        outUsed += size;
+        dataSize += size;
+        return size;
+#else
+        (void)buffer;
+        return 0;
+#endif
+    }
+
+    // writes all complete blocks of out, with all set the last partial block is written padded as well
+    // the partial block stays in out and is written again together with the following data
+    int LogSink::writeOut(bool all)
+    {
+        if (fd == -1)
+        {
+            return -EBADF;
+        }
+        size_t aligned = outUsed & ~(Align - 1);
+        size_t length = all ? ((outUsed + Align - 1) & ~(Align - 1)) : aligned;
+        ::memset(out + outUsed, 0, length - outUsed);
+
+        int res = 0;
+        for (size_t written = 0; written < length;)
+        {
+            ssize_t cur = ::pwrite(fd, out + written, length - written, writeOffset + written);
+            if (cur == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                res = -errno;
+                constexpr const char ErrMessage[] = "Writing log segment failed.\n";
+                (void)!::write(STDERR_FILENO, ErrMessage, sizeof(ErrMessage) - 1); // best effort, the error is returned anyway
+                break;
+            }
+            written += cur;
+        }
+
+        if (aligned != 0)
+        {
+            ::memmove(out, out + aligned, outUsed - aligned);
+            writeOffset += aligned;
+            outUsed -= aligned;
+        }
+        return res;
+    }
+
+    int LogSink::writeHeader()
+    {
+        char *block = nullptr;
+        if (::posix_memalign(reinterpret_cast<void**>(&block), Align, SegmentHeader::Size) != 0)
+        {
+            return -ENOMEM;
+        }
+        ::memset(block, 0, SegmentHeader::Size);
+        SegmentHeader header
+        {
+            .magic = {},
+            .version = SegmentHeader::Version,
+            .format = config.format,
+            .sequence = sequence,
+            .startTime = fileStartTime,
+            .dataSize = dataSize,
+            .compression = config.compression
+        };
+        std::copy_n(SegmentHeader::Magic, sizeof(header.magic), header.magic);
+        ::memcpy(block, &header, sizeof(header));
+        int res = (::pwrite(fd, block, SegmentHeader::Size, 0) == SegmentHeader::Size) ? 0 : -errno;
+        std::free(block);
+        return res;
+    }
+
+    int LogSink::openSegment()
+    {
+        char path[4096];
+        while (true)
+        {
+            snprintf(path, sizeof(path), "%s/segment-%08lu.log", config.directory.c_str(), sequence);
+            fd = ::open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | (config.directIo ? O_DIRECT : 0), 0644);
+            if (fd != -1)
+            {
+                break;
+            }
+            else if (errno == EEXIST)
+            {
+                sequence++;
+            }
+            else if (errno == EINVAL && config.directIo) // filesystem does not support O_DIRECT (e.g. tmpfs), file got created anyway
+            {
+                std::cerr << "O_DIRECT not supported for " << config.directory << ", using buffered writes." << std::endl;
+                ::unlink(path);
+                config.directIo = false;
+            }
+            else
+            {
+                std::cerr << "Could not create log segment " << path << "." << std::endl;
+                return -errno;
+            }
+        }
+
+        if (::fallocate(fd, 0, 0, config.segmentSize) != 0 && errno != EOPNOTSUPP)
+        {
+            std::cerr << "Could not preallocate log segment " << path << "." << std::endl;
+        }
+
+        snprintf(path, sizeof(path), "%s/segment-%08lu.idx", config.directory.c_str(), sequence);
+        indexFd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (indexFd == -1)
+        {
+            std::cerr << "Could not create log segment index " << path << "." << std::endl;
+        }
+
+        fileStartTime = Clock::Now();
+        dataSize = 0;
+        outUsed = 0;
+        writeOffset = SegmentHeader::Size;
+        return writeHeader();
+    }
+
+    int LogSink::closeSegment()
+    {
+        if (fd == -1)
+        {
+            return 0;
+        }
+        int res = writeOut(true);
+        outUsed = 0;
+        if (int hres = writeHeader(); res == 0)
+        {
+            res = hres;
+        }
+        if (::ftruncate(fd, SegmentHeader::Size + dataSize) != 0 && res == 0) // drop the preallocated but unused space
+        {
+            res = -errno;
+        }
+        if (config.syncNs != 0)
+        {
+            ::fdatasync(fd);
+        }
+        ::close(fd);
+        fd = -1;
+        if (indexFd != -1)
+        {
+            ::close(indexFd);
+            indexFd = -1;
+        }
+        sequence++;
+        return res;
+    }
+}
@@ -0,0 +1,106 @@
+#include <PidCache.hpp>
+
+#include <Clock.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+namespace LogFs
+{
+    PidCache::Info PidCache::Get(int pid)
+    {
+        Entry &entry = Entries[static_cast<uint32_t>(pid) & (Slots - 1)];
+        uint64_t now = Clock::Now();
+
+        if (uint32_t seq = entry.seq.load(std::memory_order_acquire); (seq & 1) == 0)
+        {
+            int cachedPid = entry.pid;
+            uint64_t time = entry.time;
+            Info info = entry.info;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.seq.load(std::memory_order_relaxed) == seq && cachedPid == pid && now - time < MaxAgeNs)
+            {
+                return info;
+            }
+        }
+
+        Info info{};
+        Read(pid, info);
+
+        // if someone else is updating the entry right now, just don't cache
+        if (uint32_t seq = entry.seq.load(std::memory_order_relaxed); (seq & 1) == 0 && entry.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+        {
+            entry.pid = pid;
+            entry.time = now;
+            entry.info = info;
+            entry.seq.store(seq + 2, std::memory_order_release);
+        }
+        return info;
+    }
+
+    void PidCache::Read(int pid, Info &info)
+    {
+        char path[64];
+        char buf[4096];
+
+        snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+        if (int fd = ::open(path, O_RDONLY | O_CLOEXEC); fd != -1)
+        {
+            ssize_t size = ::read(fd, info.comm, sizeof(info.comm) - 1);
+            ::close(fd);
+            if (size > 0 && info.comm[size - 1] == '\n')
+            {
+                size--;
+            }
+            info.comm[(size > 0) ? size : 0] = 0;
+        }
+
+        snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+        if (int fd = ::open(path, O_RDONLY | O_CLOEXEC); fd != -1)
+        {
+            ssize_t size = ::read(fd, buf, sizeof(buf) - 1);
+            ::close(fd);
+            buf[(size > 0) ? size : 0] = 0;
+
+            // the cgroup v2 hierarchy is the line "0::<path>"
+            for (char *line = buf; line != nullptr && *line != 0;)
+            {
+                char *end = ::strchr(line, '\n');
+                if (end != nullptr)
+                {
+                    *end = 0;
+                }
+                if (::strncmp(line, "0::", 3) == 0)
+                {
+                    char dir[sizeof(buf) + 64];
+                    snprintf(dir, sizeof(dir), "%s%s", CgroupRoot(), line + 3);
+                    struct stat st{};
+                    info.cgroupId = (::stat(dir, &st) == 0) ? st.st_ino : 0;
+                    break;
+                }
+                line = (end != nullptr) ? end + 1 : nullptr;
+            }
+        }
+    }
+
+    const char *PidCache::CgroupRoot()
+    {
+        static const char *root = []
+        {
+            struct statfs st{};
+            if (::statfs("/sys/fs/cgroup/unified", &st) == 0 && st.f_type == CGROUP2_SUPER_MAGIC) // hybrid hierarchy
+            {
+                return "/sys/fs/cgroup/unified";
+            }
+            return "/sys/fs/cgroup";
+        }();
+        return root;
+    }
+
+    PidCache::Entry PidCache::Entries[PidCache::Slots];
+}
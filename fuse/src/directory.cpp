@@ -306,16 +306,18 @@ namespace LogFs
             ::fuse_reply_err(req, -res);
         }
 
-        auto data = log.getBuf();
+        char path[LogEntry::SizePath];
         char fdname[12];
         snprintf(fdname, 12, "%d", parentFd);
-        auto size = readlinkat(Fs.ProcFd, fdname, &data.data()[LogEntry::OffPath], LogEntry::SizePath);
+        auto size = readlinkat(Fs.ProcFd, fdname, path, sizeof(path));
         if (size != -1 && size < LogEntry::SizePath)
         {
-            data.data()[LogEntry::OffPath + size++] = '/';
-            ::memcpy(&data.data()[LogEntry::OffPath + size], name, std::min(strlen(name), size_t(LogEntry::SizePath) - size));
+            path[size++] = '/';
+            auto nameSize = std::min(strlen(name), size_t(LogEntry::SizePath) - size);
+            ::memcpy(&path[size], name, nameSize);
+            size += nameSize;
         }
-        Fs.writeLog(data);
+        Fs.writeLog(log, { path, static_cast<size_t>(std::max(size, ssize_t(0))) });
     }
     void Symlink(fuse_req_t req, const char *link, fuse_ino_t parent, const char *name)
     {
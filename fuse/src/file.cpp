@@ -1,5 +1,7 @@
 #include <FileSystem.hpp>
 
+#include <algorithm>
+
 namespace LogFs
 {
     void Open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
@@ -26,9 +28,9 @@ namespace LogFs
             ::fuse_reply_open(req, fi);
         }
 
-        auto data = log.getBuf();
-        auto size = readlinkat(Fs.ProcFd, fdname, &data.data()[LogEntry::OffPath], LogEntry::SizePath);
-        Fs.writeLog(data);
+        char path[LogEntry::SizePath];
+        auto size = readlinkat(Fs.ProcFd, fdname, path, sizeof(path));
+        Fs.writeLog(log, { path, static_cast<size_t>(std::max(size, ssize_t(0))) });
     }
     void Read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, struct fuse_file_info *fi)
     {
@@ -51,7 +53,7 @@ namespace LogFs
         res = (res == 0) ? bv.off : res;
 
         log.end(res);
-        Fs.writeLog(log.getBuf());
+        Fs.writeLog(log);
     }
     void Write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t off, struct fuse_file_info *fi)
     {
@@ -71,7 +73,7 @@ namespace LogFs
             ::fuse_reply_write(req, res);
         }
 
-        Fs.writeLog(log.getBuf());
+        Fs.writeLog(log);
     }
     void WriteBuf(fuse_req_t req, fuse_ino_t ino, struct fuse_bufvec *bufv, off_t off, struct fuse_file_info *fi)
     {
@@ -98,7 +100,7 @@ namespace LogFs
             ::fuse_reply_write(req, res);
         }
         
-        Fs.writeLog(log.getBuf());
+        Fs.writeLog(log);
     }
     void Release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi)
     {
@@ -115,7 +117,7 @@ namespace LogFs
 
         if (!log.unknownFh())
         {
-            Fs.writeLog(log.getBuf());
+            Fs.writeLog(log);
         }
     }
     void Fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info *fi)
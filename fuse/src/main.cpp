@@ -1,22 +1,73 @@
 #include <FileSystem.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <memory>
 #include <sys/stat.h>
 
+struct LogFsOptions
+{
+    char *logFormat = nullptr;
+    char *logDir = nullptr;
+    unsigned long segmentSize = 256; // MiB
+    unsigned long rotateSec = 0;
+    unsigned long syncMs = 0;
+    unsigned long flushMs = 1000;
+    int noDirect = 0;
+    int compress = 0;
+    char *stream = nullptr;
+    unsigned long streamSlots = 65536;
+};
+
+static const fuse_opt LogFsOpts[]
+{
+    { "logformat=%s", offsetof(LogFsOptions, logFormat), 0 },
+    { "logdir=%s", offsetof(LogFsOptions, logDir), 0 },
+    { "segsize=%lu", offsetof(LogFsOptions, segmentSize), 0 },
+    { "rotate=%lu", offsetof(LogFsOptions, rotateSec), 0 },
+    { "sync=%lu", offsetof(LogFsOptions, syncMs), 0 },
+    { "flush=%lu", offsetof(LogFsOptions, flushMs), 0 },
+    { "nodirect", offsetof(LogFsOptions, noDirect), 1 },
+    { "compress", offsetof(LogFsOptions, compress), 1 },
+    { "stream=%s", offsetof(LogFsOptions, stream), 0 },
+    { "streamslots=%lu", offsetof(LogFsOptions, streamSlots), 0 },
+    FUSE_OPT_END
+};
+
+static void LogFsHelp()
+{
+    std::cout <<
+        "LogFs options:\n"
+        "    -o logformat=text|binary   format of the log records (default: text)\n"
+        "    -o logdir=DIR              write the log into segments in DIR instead of stdout\n"
+        "    -o segsize=MIB             size of a log segment (default: 256)\n"
+        "    -o rotate=SEC              start a new segment after SEC seconds (default: 0, only by size)\n"
+        "    -o sync=MS                 fdatasync the log every MS milliseconds (default: 0, never)\n"
+        "    -o flush=MS                max time records are buffered (default: 1000)\n"
+        "    -o nodirect                don't use O_DIRECT for the log segments\n"
+        "    -o compress                lz4 compress the log segments in independent blocks\n"
+        "    -o stream=NAME             publish binary records into the shared memory ring /dev/shm/NAME\n"
+        "    -o streamslots=N           number of records the shared memory ring holds (default: 65536)\n"
+        << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
     fuse_args args = FUSE_ARGS_INIT(argc, argv);
     fuse_cmdline_opts opts;
+    LogFsOptions logFsOpts;
     
-    if (fuse_parse_cmdline(&args, &opts) != 0)
+    if (fuse_opt_parse(&args, &logFsOpts, LogFsOpts, nullptr) != 0 || fuse_parse_cmdline(&args, &opts) != 0)
     {
         return -1;
     }
     if (opts.show_help || opts.mountpoint == nullptr)
     {
         std::cout << "Usage: " << argv[0] << "[options] <mountpoint>\n" << std::endl;
+        LogFsHelp();
         fuse_cmdline_help();
         fuse_lowlevel_help();
         free(opts.mountpoint);
@@ -32,6 +83,57 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    if (logFsOpts.logFormat != nullptr)
+    {
+        if (::strcmp(logFsOpts.logFormat, "binary") == 0)
+        {
+            LogFs::Fs.logFormat = LogFs::LogFormat::Binary;
+        }
+        else if (::strcmp(logFsOpts.logFormat, "text") != 0)
+        {
+            std::cout << "Unknown log format '" << logFsOpts.logFormat << "'." << std::endl;
+            return -1;
+        }
+    }
+
+    LogFs::Clock::Init();
+
+    if (logFsOpts.compress != 0 && logFsOpts.logDir == nullptr)
+    {
+        std::cout << "Compression is only supported together with logdir." << std::endl;
+        return -1;
+    }
+    if (logFsOpts.logDir != nullptr)
+    {
+        LogFs::LogSink::Config config
+        {
+            .directory = logFsOpts.logDir,
+            .format = LogFs::Fs.logFormat,
+            .compression = (logFsOpts.compress != 0) ? LogFs::Compression::Lz4 : LogFs::Compression::None,
+            .segmentSize = logFsOpts.segmentSize << 20,
+            .rotateNs = logFsOpts.rotateSec * 1000000000,
+            .syncNs = logFsOpts.syncMs * 1000000,
+            .flushNs = std::max(logFsOpts.flushMs, 1ul) * 1000000,
+            .directIo = (logFsOpts.noDirect == 0)
+        };
+        LogFs::Fs.logSink = std::make_unique<LogFs::LogSink>();
+        if (int res = LogFs::Fs.logSink->open(config); res != 0)
+        {
+            std::cout << "Error starting log output to " << logFsOpts.logDir << ": " << ((res == -ENOTSUP) ? "logfs was built without lz4" : ::strerror(-res)) << std::endl;
+            return -res;
+        }
+    }
+
+    if (logFsOpts.stream != nullptr)
+    {
+        LogFs::Fs.eventStream = std::make_unique<LogFs::EventStreamWriter>();
+        if (int res = LogFs::Fs.eventStream->create(logFsOpts.stream, logFsOpts.streamSlots); res != 0)
+        {
+            std::cout << "Error creating event stream " << logFsOpts.stream << ": " << ::strerror(-res) << std::endl;
+            return -res;
+        }
+    }
+
     int res = LogFs::Fs.setupPollPipe();
     if (res == -1)
     {
@@ -51,6 +153,10 @@ int main(int argc, char *argv[])
     fuse_session *session = ::fuse_session_new(&args, &ops, sizeof(ops), 0);
     if (session != nullptr && ::fuse_set_signal_handlers(session) == 0 && ::fuse_session_mount(session, opts.mountpoint) == 0 && ::fuse_daemonize(opts.foreground ? 1 : 0) == 0)
     {
+        if (LogFs::Fs.logSink != nullptr)
+        {
+            LogFs::Fs.logSink->start(); // after the fork of fuse_daemonize
+        }
         res = -1;
         {
             /* Block until ctrl+c or fusermount -u */
@@ -70,5 +176,14 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (LogFs::Fs.logSink != nullptr)
+    {
+        LogFs::Fs.logSink->stop();
+    }
+    if (LogFs::Fs.eventStream != nullptr)
+    {
+        LogFs::Fs.eventStream->destroy();
+    }
+
     return res;
 }